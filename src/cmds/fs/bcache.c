@@ -0,0 +1,56 @@
+/**
+ * @file
+ * @brief Prints statistics of buffer cache
+ *
+ * @date 17.10.2026
+ */
+
+#include <errno.h>
+#include <stdio.h>
+#include <unistd.h>
+
+#include <fs/bcache.h>
+
+static void print_usage(void) {
+	printf("Usage: bcache [-hs]\n");
+}
+
+static void print_stats(void) {
+	struct bcache_stat st;
+	unsigned long lookups;
+
+	bcache_get_stat(&st);
+	lookups = st.hits + st.misses;
+
+	printf("%10s %10s %4s %10s %10s %6s\n",
+			"hits", "misses", "hit%", "evictions", "writebacks", "dirty");
+	printf("%10lu %10lu %3lu%% %10lu %10lu %6u\n",
+			st.hits, st.misses, lookups ? st.hits * 100 / lookups : 0,
+			st.evictions, st.writebacks, st.dirty);
+}
+
+int main(int argc, char **argv) {
+	int opt, err;
+
+	getopt_init();
+	while (-1 != (opt = getopt(argc, argv, "hs"))) {
+		switch (opt) {
+		case 'h':
+			print_usage();
+			return 0;
+		case 's':
+			if ((err = bcache_sync(NULL))) {
+				printf("bcache: sync failed: %d\n", err);
+				return err;
+			}
+			break;
+		default:
+			print_usage();
+			return -EINVAL;
+		}
+	}
+
+	print_stats();
+
+	return 0;
+}
@@ -13,9 +13,10 @@
 #include <stdio.h>
 #include <string.h>
 #include <kernel/time/clock_source.h>
+#include <kernel/time/tick_idle.h>
 
 static void print_usage(void) {
-	printf("Usage: clock [-i] [-h]\n");
+	printf("Usage: clock [-i] [-t] [-h]\n");
 }
 
 static int print_info(const struct clock_source *cs, int num) {
@@ -52,7 +53,7 @@ int main(int argc, char **argv) {
 
 	getopt_init();
 
-	while (-1 != (opt = getopt(argc, argv, "hi"))) {
+	while (-1 != (opt = getopt(argc, argv, "hit"))) {
 		printf("\n");
 		switch (opt) {
 		case '?':
@@ -64,6 +65,9 @@ int main(int argc, char **argv) {
 		case 'i':
 			clock_source_info();
 			break;
+		case 't':
+			printf("ticks elided in idle: %lu\n", tick_idle_elided());
+			break;
 		default:
 			break;
 		}
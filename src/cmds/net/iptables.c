@@ -39,14 +39,52 @@ static int clear_rules(int chain) {
 	return 0;
 }
 
-static void print_header(int chain) {
+static void print_header(int chain, int verbose) {
 	printf("Chain %s (policy %s)\n", nf_chain_to_str(chain),
 			nf_target_to_str(nf_get_chain_target(chain)));
+	if (verbose) {
+		printf("      pkts      bytes ");
+	}
 	printf("target    prot opt  source           destination\n");
 }
 
-static void print_rule(const struct nf_rule *r) {
+static void print_ctstate(const struct nf_rule *r) {
+	unsigned int state;
+	const char *sep;
+
+	printf(" state %s", r->not_ctstate ? "!" : "");
+	sep = "";
+	for (state = NF_CT_INVALID; state <= NF_CT_RELATED; state <<= 1) {
+		if (r->ctstate & state) {
+			printf("%s%s", sep, nf_ct_state_to_str(state));
+			sep = ",";
+		}
+	}
+}
+
+static int parse_ctstate(char *str, unsigned int *out_state) {
+	unsigned int state, st;
+	char *name;
+
+	state = 0;
+	for (name = strtok(str, ","); name != NULL; name = strtok(NULL, ",")) {
+		st = nf_ct_state_get_by_name(name);
+		if (st == 0) {
+			return -EINVAL;
+		}
+		state |= st;
+	}
+
+	*out_state = state;
+
+	return state != 0 ? 0 : -EINVAL;
+}
+
+static void print_rule(const struct nf_rule *r, int verbose) {
 	const char *target_str;
+	if (verbose) {
+		printf("%10lu %10lu ", r->pkts, r->bytes);
+	}
 	target_str = nf_target_to_str(r->target);
 	printf("%-8s ", target_str != NULL ? target_str : "");
 	printf("%c%-4s ", r->not_proto ? '!' : ' ',
@@ -77,10 +115,13 @@ static void print_rule(const struct nf_rule *r) {
 			printf("%hu", (unsigned short int)ntohs(r->dport));
 		}
 	}
+	if (r->set_ctstate) {
+		print_ctstate(r);
+	}
 	printf("\n");
 }
 
-static void print_rules(int chain) {
+static void print_rules(int chain, int verbose) {
 	struct dlist_head *rules;
 	struct nf_rule *r;
 
@@ -89,46 +130,46 @@ static void print_rules(int chain) {
 		return;
 	}
 
-	print_header(chain);
+	print_header(chain, verbose);
 	dlist_foreach_entry(r, rules, lnk) {
-		print_rule(r);
+		print_rule(r, verbose);
 	}
 }
 
-static int show_rules(int chain, int rule_num) {
+static int show_rules(int chain, int rule_num, int verbose) {
 	struct nf_rule *r;
 
 	if (chain != NF_CHAIN_UNKNOWN) {
 		if (rule_num == -1) {
-			print_rules(chain);
+			print_rules(chain, verbose);
 		}
 		else {
 			r = nf_get_rule_by_num(chain, rule_num);
 			if (r == NULL) {
 				return -ENOENT;
 			}
-			print_rule(r);
+			print_rule(r, verbose);
 		}
 	}
 	else {
-		print_rules(NF_CHAIN_INPUT);
+		print_rules(NF_CHAIN_INPUT, verbose);
 		printf("\n");
-		print_rules(NF_CHAIN_FORWARD);
+		print_rules(NF_CHAIN_FORWARD, verbose);
 		printf("\n");
-		print_rules(NF_CHAIN_OUTPUT);
+		print_rules(NF_CHAIN_OUTPUT, verbose);
 	}
 
 	return 0;
 }
 
 int main(int argc, char **argv) {
-	int ind, oper, chain, rule_num, not_flag;
-	unsigned int port;
+	int ind, oper, chain, rule_num, not_flag, verbose;
+	unsigned int port, state;
 	struct nf_rule rule;
 
 	oper = rule_num = -1;
 	chain = NF_CHAIN_UNKNOWN;
-	not_flag = 0;
+	not_flag = verbose = 0;
 	nf_rule_init(&rule);
 
 	for (ind = 1; ind != argc; ++ind) {
@@ -140,10 +181,14 @@ int main(int argc, char **argv) {
 			printf("  iptables -R chain rulenum rule-specification\n");
 			printf("  iptables -D chain rulenum\n");
 			printf("  iptables -F [chain]\n");
-			printf("  iptables -L [chain [rulenum]]\n");
+			printf("  iptables -L [-v] [chain [rulenum]]\n");
 			printf("  iptables -P chain target\n");
 			return 0;
 		}
+		else if (!strcmp(argv[ind], "-v")
+				|| !strcmp(argv[ind], "--verbose")) {
+			verbose = 1;
+		}
 		else if (oper == -1) {
 			if ((0 == strcmp(argv[ind], "-A"))
 					|| (0 == strcmp(argv[ind], "--append"))) {
@@ -322,6 +367,31 @@ after_rule_num:
 					htons((unsigned short)port));
 			not_flag = 0;
 		}
+		else if ((0 == strcmp(argv[ind], "-m"))
+				|| (0 == strcmp(argv[ind], "--match"))) {
+			if (++ind == argc) {
+				printf("iptables: no match specified\n");
+				return -EINVAL;
+			}
+			if ((0 != strcmp(argv[ind], "state"))
+					&& (0 != strcmp(argv[ind], "conntrack"))) {
+				printf("iptables: unknown match: `%s'\n", argv[ind]);
+				return -EINVAL;
+			}
+		}
+		else if ((0 == strcmp(argv[ind], "--state"))
+				|| (0 == strcmp(argv[ind], "--ctstate"))) {
+			if (++ind == argc) {
+				printf("iptables: no state specified\n");
+				return -EINVAL;
+			}
+			if (0 != parse_ctstate(argv[ind], &state)) {
+				printf("iptables: invalid state: `%s'\n", argv[ind]);
+				return -EINVAL;
+			}
+			NF_SET_NOT_FIELD(&rule, ctstate, not_flag, state);
+			not_flag = 0;
+		}
 		else {
 			printf("iptables: unknown option: `%s'\n", argv[ind]);
 			return -EINVAL;
@@ -364,5 +434,5 @@ after_rule_num:
 			: oper == 'D' ? nf_del_rule(chain, rule_num)
 			: oper == 'F' ? clear_rules(chain)
 			: oper == 'P' ? nf_set_chain_target(chain, rule.target)
-			: /* oper == 'L' ? */ show_rules(chain, rule_num);
+			: /* oper == 'L' ? */ show_rules(chain, rule_num, verbose);
 }
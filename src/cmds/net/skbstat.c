@@ -0,0 +1,108 @@
+/**
+ * @file
+ * @brief Report per-CPU socket buffer allocation statistics
+ *
+ * @date 17.10.2026
+ */
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <hal/cpu.h>
+#include <net/skbuff.h>
+
+typedef int (*skbstat_get_ft)(unsigned int cpu, struct skb_alloc_stat *stat);
+
+static void print_usage(void) {
+	printf("Usage: skbstat [-h] [-i sec]\n");
+}
+
+static void skbstat_sum(skbstat_get_ft get, struct skb_alloc_stat *sum) {
+	struct skb_alloc_stat st;
+	unsigned int cpu;
+
+	memset(sum, 0, sizeof *sum);
+	for (cpu = 0; cpu < NCPU; ++cpu) {
+		if (0 != get(cpu, &st)) {
+			continue;
+		}
+		sum->alloc += st.alloc;
+		sum->free += st.free;
+		sum->remote_free += st.remote_free;
+		sum->refill += st.refill;
+		sum->flush += st.flush;
+	}
+}
+
+static void skbstat_print(const char *name, skbstat_get_ft get) {
+	struct skb_alloc_stat st;
+	unsigned int cpu;
+
+	printf("%s\n", name);
+	printf("CPU      alloc       free     remote     refill      flush\n");
+	for (cpu = 0; cpu < NCPU; ++cpu) {
+		if (0 != get(cpu, &st)) {
+			continue;
+		}
+		printf("%3u %10lu %10lu %10lu %10lu %10lu\n", cpu, st.alloc,
+				st.free, st.remote_free, st.refill, st.flush);
+	}
+}
+
+static void skbstat_print_rate(const char *name,
+		const struct skb_alloc_stat *before,
+		const struct skb_alloc_stat *after, unsigned int sec) {
+	printf("%-13s %8lu alloc/s %8lu free/s %8lu remote/s\n", name,
+			(after->alloc - before->alloc) / sec,
+			(after->free - before->free) / sec,
+			(after->remote_free - before->remote_free) / sec);
+}
+
+int main(int argc, char **argv) {
+	int opt;
+	unsigned int interval = 0;
+
+	getopt_init();
+
+	while (-1 != (opt = getopt(argc, argv, "hi:"))) {
+		switch (opt) {
+		case 'i':
+			interval = atoi(optarg);
+			if (interval == 0) {
+				print_usage();
+				return -EINVAL;
+			}
+			break;
+		case 'h':
+			print_usage();
+			return ENOERR;
+		default:
+			print_usage();
+			return -EINVAL;
+		}
+	}
+
+	if (interval != 0) {
+		struct skb_alloc_stat skb_before, skb_after;
+		struct skb_alloc_stat data_before, data_after;
+
+		skbstat_sum(skb_alloc_stat_get, &skb_before);
+		skbstat_sum(skb_data_alloc_stat_get, &data_before);
+		sleep(interval);
+		skbstat_sum(skb_alloc_stat_get, &skb_after);
+		skbstat_sum(skb_data_alloc_stat_get, &data_after);
+
+		skbstat_print_rate("sk_buff", &skb_before, &skb_after, interval);
+		skbstat_print_rate("sk_buff_data", &data_before, &data_after,
+				interval);
+		return ENOERR;
+	}
+
+	skbstat_print("sk_buff", skb_alloc_stat_get);
+	skbstat_print("sk_buff_data", skb_data_alloc_stat_get);
+
+	return ENOERR;
+}
@@ -0,0 +1,66 @@
+/**
+ * @file
+ * @brief Prints statistics of slab caches
+ *
+ * @date 17.10.2026
+ */
+
+#include <errno.h>
+#include <stdio.h>
+#include <unistd.h>
+
+#include <mem/misc/slab.h>
+
+#define SLABINFO_MAX_CACHES 64
+
+static struct cache_stats slabinfo_stats[SLABINFO_MAX_CACHES];
+
+static void print_usage(void) {
+	printf("Usage: slabinfo [-h]\n");
+}
+
+static void print_stats(void) {
+	struct cache_stats *st;
+	int i, n;
+
+	n = cache_stats_get(slabinfo_stats, SLABINFO_MAX_CACHES);
+	if (n > SLABINFO_MAX_CACHES) {
+		n = SLABINFO_MAX_CACHES;
+	}
+
+	printf("%-15s %7s %5s %5s %5s %5s %5s %7s %6s %10s %10s %4s\n",
+			"name", "objsize", "objs", "pages", "full", "part", "free",
+			"active", "cached", "allocs", "frees", "hit%");
+
+	for (i = 0; i < n; i++) {
+		st = &slabinfo_stats[i];
+
+		printf("%-15s %7zu %5u %5u %5u %5u %5u %7u %6u %10lu %10lu %3lu%%\n",
+				st->name, st->obj_size, st->obj_per_slab,
+				1U << st->slab_order,
+				st->slabs_full, st->slabs_partial, st->slabs_free,
+				st->objs_active, st->objs_cached,
+				st->allocs, st->frees,
+				st->allocs ? st->hits * 100 / st->allocs : 0);
+	}
+}
+
+int main(int argc, char **argv) {
+	int opt;
+
+	getopt_init();
+	while (-1 != (opt = getopt(argc, argv, "h"))) {
+		switch (opt) {
+		case 'h':
+			print_usage();
+			return 0;
+		default:
+			print_usage();
+			return -EINVAL;
+		}
+	}
+
+	print_stats();
+
+	return 0;
+}
@@ -27,7 +27,7 @@
 #include <kernel/thread/thread_sched_wait.h>
 
 #include <kernel/sched.h>
-#include <mem/sysmalloc.h>
+#include <mem/kmalloc.h>
 
 
 
@@ -96,9 +96,9 @@ static void pipe_close(struct idesc *idesc) {
 	ret = idesc_pipe_close(cur, other);
 	mutex_unlock(&pipe->mutex);
 	if (ret) {
-		sysfree(pipe->buff->storage);
-		sysfree(pipe->buff);
-		sysfree(pipe);
+		kfree(pipe->buff->storage);
+		kfree(pipe->buff);
+		kfree(pipe);
 	}
 }
 
@@ -277,19 +277,19 @@ static struct pipe *pipe_alloc(void) {
 	struct ring_buff *pipe_buff;
 	void *storage;
 
-	storage = sysmalloc(DEFAULT_PIPE_BUFFER_SIZE);
+	storage = kmalloc(DEFAULT_PIPE_BUFFER_SIZE);
 	if (!storage) {
 		return NULL;
 	}
-	pipe = sysmalloc(sizeof(struct pipe));
+	pipe = kmalloc(sizeof(struct pipe));
 	if (!pipe) {
-		sysfree(storage);
+		kfree(storage);
 		return NULL;
 	}
-	pipe_buff = sysmalloc(sizeof(struct ring_buff));
+	pipe_buff = kmalloc(sizeof(struct ring_buff));
 	if (!pipe_buff) {
-		sysfree(storage);
-		sysfree(pipe);
+		kfree(storage);
+		kfree(pipe);
 		return NULL;
 	}
 
@@ -303,9 +303,9 @@ static struct pipe *pipe_alloc(void) {
 }
 
 static void pipe_free(struct pipe *pipe) {
-	sysfree(pipe->buff->storage);
-	sysfree(pipe->buff);
-	sysfree(pipe);
+	kfree(pipe->buff->storage);
+	kfree(pipe->buff);
+	kfree(pipe);
 }
 
 int pipe(int pipefd[2]) {
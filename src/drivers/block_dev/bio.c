@@ -0,0 +1,281 @@
+/**
+ * @file
+ * @brief Asynchronous block I/O requests
+ *
+ * @date 17.10.2026
+ */
+
+#include <assert.h>
+#include <errno.h>
+#include <string.h>
+
+#include <drivers/block_dev.h>
+#include <drivers/block_dev/bio.h>
+#include <kernel/spinlock.h>
+#include <kernel/thread.h>
+#include <kernel/thread/waitq.h>
+#include <mem/sysmalloc.h>
+#include <util/err.h>
+
+#include <embox/unit.h>
+
+EMBOX_UNIT_INIT(bio_init_thread);
+
+/* Requests for drivers without @a submit */
+static DLIST_DEFINE(bio_queue);
+static spinlock_t bio_lock = SPIN_STATIC_UNLOCKED;
+static struct waitq bio_wq = WAITQ_INIT(bio_wq);
+
+void bio_init(struct bio *bio, struct block_dev *bdev, int rw,
+		blkno_t blkno, struct bio_vec *vec, int vcnt,
+		bio_end_io_t end_io, void *priv) {
+	int blksize, i;
+
+	assert(bio && bdev);
+
+	memset(bio, 0, sizeof(*bio));
+	bio->bdev = bdev;
+	bio->rw = rw;
+	bio->blkno = blkno;
+	bio->vec = vec;
+	bio->vcnt = vcnt;
+	bio->end_io = end_io;
+	bio->priv = priv;
+	dlist_head_init(&bio->lnk);
+
+	for (i = 0; i < vcnt; i++) {
+		bio->size += vec[i].len;
+	}
+
+	blksize = block_dev_ioctl(bdev, IOCTL_GETBLKSIZE, NULL, 0);
+	assert(blksize > 0 && bio->size % blksize == 0);
+	bio->nblocks = bio->size / blksize;
+}
+
+void bio_endio(struct bio *bio, int err) {
+	struct bio *next;
+
+	for (; bio; bio = next) {
+		next = bio->next;
+		bio->next = NULL;
+		if (bio->end_io) {
+			bio->end_io(bio, err);
+		}
+	}
+}
+
+static int bio_rw(struct block_dev *bdev, int rw, char *buf, size_t len,
+		blkno_t blkno) {
+	int res;
+
+	if (rw == BIO_READ) {
+		res = bdev->driver->read(bdev, buf, len, blkno);
+	} else {
+		res = bdev->driver->write(bdev, buf, len, blkno);
+	}
+
+	if (res == (int) len) {
+		return 0;
+	}
+	return res < 0 ? res : -EIO;
+}
+
+/**
+ * Executes request @a req with the synchronous driver operations. A
+ * request of several vectors goes to the driver as one transfer through
+ * a bounce buffer if memory allows.
+ */
+static int bio_execute(struct bio *req) {
+	struct block_dev *bdev = req->bdev;
+	size_t blksize = req->size / req->nblocks;
+	struct bio *bio;
+	size_t total = 0;
+	blkno_t blkno;
+	char *bounce = NULL, *p;
+	int nvec = 0;
+	int i, res;
+
+	for (bio = req; bio; bio = bio->next) {
+		total += bio->size;
+		nvec += bio->vcnt;
+	}
+
+	if (nvec > 1) {
+		bounce = sysmalloc(total);
+	}
+
+	if (bounce) {
+		if (req->rw == BIO_WRITE) {
+			for (p = bounce, bio = req; bio; bio = bio->next) {
+				for (i = 0; i < bio->vcnt; p += bio->vec[i++].len) {
+					memcpy(p, bio->vec[i].buf, bio->vec[i].len);
+				}
+			}
+		}
+
+		res = bio_rw(bdev, req->rw, bounce, total, req->blkno);
+
+		if (req->rw == BIO_READ && res == 0) {
+			for (p = bounce, bio = req; bio; bio = bio->next) {
+				for (i = 0; i < bio->vcnt; p += bio->vec[i++].len) {
+					memcpy(bio->vec[i].buf, p, bio->vec[i].len);
+				}
+			}
+		}
+
+		sysfree(bounce);
+		return res;
+	}
+
+	for (bio = req; bio; bio = bio->next) {
+		blkno = bio->blkno;
+		for (i = 0; i < bio->vcnt; i++) {
+			res = bio_rw(bdev, bio->rw, bio->vec[i].buf, bio->vec[i].len, blkno);
+			if (res) {
+				return res;
+			}
+			blkno += bio->vec[i].len / blksize;
+		}
+	}
+
+	return 0;
+}
+
+static void bio_dispatch(struct bio *req) {
+	struct block_dev *bdev = req->bdev;
+	ipl_t ipl;
+	int res;
+
+	assert(bdev->driver);
+
+	if (bdev->driver->submit) {
+		res = bdev->driver->submit(bdev, req);
+		if (res) {
+			bio_endio(req, res);
+		}
+		return;
+	}
+
+	ipl = spin_lock_ipl(&bio_lock);
+	dlist_add_prev(&req->lnk, &bio_queue);
+	spin_unlock_ipl(&bio_lock, ipl);
+
+	waitq_wakeup_all(&bio_wq);
+}
+
+void bio_submit(struct bio *bio, struct bio_plug *plug) {
+	struct bio *req, *tail;
+
+	assert(bio && bio->nblocks);
+
+	bio->next = NULL;
+
+	if (!plug) {
+		bio_dispatch(bio);
+		return;
+	}
+
+	dlist_foreach_entry(req, &plug->list, lnk) {
+		if (req->bdev != bio->bdev || req->rw != bio->rw) {
+			continue;
+		}
+
+		for (tail = req; tail->next; tail = tail->next) {
+		}
+		if (tail->blkno + tail->nblocks == bio->blkno) {
+			tail->next = bio;
+			return;
+		}
+
+		if (bio->blkno + bio->nblocks == req->blkno) {
+			bio->next = req;
+			dlist_add_prev(&bio->lnk, &req->lnk);
+			dlist_del_init(&req->lnk);
+			return;
+		}
+	}
+
+	dlist_add_prev(&bio->lnk, &plug->list);
+}
+
+void bio_plug_init(struct bio_plug *plug) {
+	dlist_init(&plug->list);
+}
+
+void bio_unplug(struct bio_plug *plug) {
+	struct bio *req;
+
+	dlist_foreach_entry(req, &plug->list, lnk) {
+		dlist_del_init(&req->lnk);
+		bio_dispatch(req);
+	}
+}
+
+struct bio_wait {
+	struct waitq wq;
+	int done;
+	int err;
+};
+
+static void bio_wait_end(struct bio *bio, int err) {
+	struct bio_wait *w = bio->priv;
+
+	w->err = err;
+	w->done = 1;
+	waitq_wakeup_all(&w->wq);
+}
+
+int block_dev_io(struct block_dev *bdev, int rw, char *buf,
+		size_t count, blkno_t blkno) {
+	struct bio_vec vec = { .buf = buf, .len = count };
+	struct bio_wait w;
+	struct bio bio;
+
+	bio_init(&bio, bdev, rw, blkno, &vec, 1, bio_wait_end, &w);
+
+	if (!bdev->driver->submit) {
+		/* Nothing to wait for, do it right here */
+		return bio_execute(&bio);
+	}
+
+	waitq_init(&w.wq);
+	w.done = 0;
+
+	bio_submit(&bio, NULL);
+	WAITQ_WAIT(&w.wq, w.done);
+
+	return w.err;
+}
+
+static void *bio_thread_run(void *arg) {
+	struct bio *req;
+	ipl_t ipl;
+
+	while (1) {
+		WAITQ_WAIT(&bio_wq, !dlist_empty(&bio_queue));
+
+		ipl = spin_lock_ipl(&bio_lock);
+		req = dlist_first_entry_or_null(&bio_queue, struct bio, lnk);
+		if (req) {
+			dlist_del_init(&req->lnk);
+		}
+		spin_unlock_ipl(&bio_lock, ipl);
+
+		if (req) {
+			bio_endio(req, bio_execute(req));
+		}
+	}
+
+	return NULL;
+}
+
+static int bio_init_thread(void) {
+	struct thread *t;
+
+	t = thread_create(0, bio_thread_run, NULL);
+	if (err(t)) {
+		return err(t);
+	}
+
+	return 0;
+}
@@ -0,0 +1,87 @@
+/**
+ * @file
+ * @brief Asynchronous block I/O requests
+ *
+ * A bio describes a transfer of whole blocks between a device and a
+ * scatter list. Submitted bios complete through their @a end_io callback,
+ * which may be called from interrupt context. Bios submitted under a
+ * plug are kept back until bio_unplug() and adjacent ones are merged
+ * into one request (a chain linked through @a next).
+ *
+ * Drivers which implement @a submit receive whole requests and report
+ * completion with bio_endio(). Requests for other drivers are executed
+ * by a kernel thread with the synchronous @a read/@a write operations.
+ *
+ * @date 17.10.2026
+ */
+
+#ifndef DRIVERS_BLOCK_DEV_BIO_H_
+#define DRIVERS_BLOCK_DEV_BIO_H_
+
+#include <stddef.h>
+#include <sys/types.h>
+#include <util/dlist.h>
+
+#define BIO_READ  0
+#define BIO_WRITE 1
+
+struct block_dev;
+struct bio;
+
+struct bio_vec {
+	char *buf;
+	size_t len;   /* multiple of device block size */
+};
+
+typedef void (*bio_end_io_t)(struct bio *bio, int err);
+
+struct bio {
+	struct block_dev *bdev;
+	blkno_t blkno;          /* first block of the transfer */
+	int rw;                 /* BIO_READ or BIO_WRITE */
+	struct bio_vec *vec;    /* scatter list */
+	int vcnt;
+	bio_end_io_t end_io;
+	void *priv;             /* owner's data for @a end_io */
+
+	/* Private for block layer and drivers */
+	size_t size;            /* bytes of all vectors */
+	blkno_t nblocks;        /* blocks of all vectors */
+	struct bio *next;       /* next bio of the same request */
+	struct dlist_head lnk;  /* link in plug or in request queue */
+};
+
+struct bio_plug {
+	struct dlist_head list;
+};
+
+extern void bio_init(struct bio *bio, struct block_dev *bdev, int rw,
+		blkno_t blkno, struct bio_vec *vec, int vcnt,
+		bio_end_io_t end_io, void *priv);
+
+/**
+ * @brief Start transfer of @a bio
+ *
+ * @param plug If not NULL, the bio is held in @a plug until bio_unplug()
+ */
+extern void bio_submit(struct bio *bio, struct bio_plug *plug);
+
+/**
+ * @brief Complete request @a bio, i.e. all bios chained to it
+ *
+ * Called by drivers, possibly from interrupt context
+ */
+extern void bio_endio(struct bio *bio, int err);
+
+extern void bio_plug_init(struct bio_plug *plug);
+extern void bio_unplug(struct bio_plug *plug);
+
+/**
+ * @brief Synchronous transfer of @a count bytes at block @a blkno
+ *
+ * @return 0 on success or negative error code
+ */
+extern int block_dev_io(struct block_dev *bdev, int rw, char *buf,
+		size_t count, blkno_t blkno);
+
+#endif /* DRIVERS_BLOCK_DEV_BIO_H_ */
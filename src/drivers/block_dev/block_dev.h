@@ -24,6 +24,7 @@
 #define DEV_TYPE_PACKET         3
 
 struct file_operations;
+struct bio;
 typedef struct block_dev {
 	struct file_operations *dev_ops;
 	dev_t id;
@@ -42,6 +43,10 @@ typedef struct block_dev {
 	/* partitions */
 	size_t start_offset;
 	struct block_dev *parrent_bdev;
+
+	/* read-ahead */
+	blkno_t ra_next;         /* next block of a sequential reader */
+	unsigned int ra_window;  /* blocks to read at once on the next miss */
 } block_dev_t;
 
 typedef struct block_dev_driver {
@@ -52,6 +57,9 @@ typedef struct block_dev_driver {
 	int (*write)(struct block_dev *bdev, char *buffer, size_t count, blkno_t blkno);
 
 	int (*probe)(void *args);
+
+	/* Optional asynchronous interface, see drivers/block_dev/bio.h */
+	int (*submit)(struct block_dev *bdev, struct bio *bio);
 } block_dev_driver_t;
 
 typedef struct block_dev_module {
@@ -11,16 +11,19 @@
 #include <string.h>
 
 #include <drivers/block_dev.h>
+#include <drivers/block_dev/bio.h>
 #include <framework/mod/options.h>
 #include <fs/bcache.h>
 #include <mem/misc/pool.h>
 #include <mem/phymem.h>
+#include <mem/sysmalloc.h>
 #include <util/array.h>
 #include <util/indexator.h>
 #include <util/math.h>
 
 #define DEFAULT_BDEV_BLOCK_SIZE OPTION_GET(NUMBER, default_block_size)
 #define MAX_DEV_QUANTITY OPTION_GET(NUMBER, dev_quantity)
+#define BDEV_RA_MAX OPTION_GET(NUMBER, readahead_max)
 
 ARRAY_SPREAD_DEF(const struct block_dev_module, __block_dev_registry);
 POOL_DEF(cache_pool, struct block_dev_cache, MAX_DEV_QUANTITY);
@@ -86,6 +89,10 @@ struct block_dev *block_dev_create_common(char *path, void *driver, void *privda
 void block_dev_free(struct block_dev *dev) {
 	assert(dev);
 
+	/* Write dirty buffers in clusters before they are dropped one by one */
+	bcache_sync(dev);
+	bcache_invalidate(dev);
+
 	devtab[dev->id] = NULL;
 	index_free(&block_dev_idx, dev->id);
 	pool_free(&blockdev_pool, dev);
@@ -136,9 +143,76 @@ struct block_dev *block_dev(void *dev) {
 	return (struct block_dev *)dev;
 }
 
+/**
+ * Returns amount of blocks to read starting from missed block @a blkno.
+ * The window doubles while the device is read sequentially and drops to
+ * a single block on random access, but it always covers the rest of
+ * the current request (@a want blocks).
+ */
+static int block_dev_ra_window(struct block_dev *bdev, blkno_t blkno, int want) {
+	if (blkno == bdev->ra_next && bdev->ra_window) {
+		bdev->ra_window = min(bdev->ra_window * 2, (unsigned int) BDEV_RA_MAX);
+	} else {
+		bdev->ra_window = 1;
+	}
+
+	return min(max(want, (int) bdev->ra_window), BDEV_RA_MAX);
+}
+
+/**
+ * Fills locked new buffer @a bh and up to @a window - 1 following
+ * uncached blocks with a single driver request
+ */
+static int block_dev_read_ahead(struct block_dev *bdev, struct buffer_head *bh,
+		int blksize, int window) {
+	struct buffer_head *ra[BDEV_RA_MAX];
+	char *buf;
+	int n, i, res;
+
+	window = min(window, (int) (bdev->size / blksize) - bh->block);
+
+	ra[0] = bh;
+	for (n = 1; n < window; n++) {
+		ra[n] = bcache_getblk_locked(bdev, bh->block + n, blksize);
+		if (!buffer_new(ra[n])) {
+			bcache_buffer_unlock(ra[n]);
+			break;
+		}
+	}
+
+	buf = bh->data;
+	if (n > 1 && NULL == (buf = sysmalloc(n * blksize))) {
+		/* Read the requested block only */
+		for (; n > 1; n--) {
+			bcache_buffer_unlock(ra[n - 1]);
+		}
+		buf = bh->data;
+	}
+
+	res = block_dev_io(bdev, BIO_READ, buf, n * blksize, bh->block);
+
+	for (i = 0; i < n; i++) {
+		if (buf != bh->data) {
+			memcpy(ra[i]->data, buf + i * blksize, blksize);
+		}
+		if (0 == res && 0 == (res = buffer_decrypt(ra[i]))) {
+			buffer_clear_flag(ra[i], BH_NEW);
+		}
+		if (i > 0) {
+			bcache_buffer_unlock(ra[i]);
+		}
+	}
+
+	if (buf != bh->data) {
+		sysfree(buf);
+	}
+
+	return res;
+}
+
 int block_dev_read_buffered(struct block_dev *bdev, char *buffer, size_t count, size_t offset) {
 	int blksize, blkno, cplen, cursor;
-	int res, i;
+	int res, i, window;
 	struct buffer_head *bh;
 
 	assert(bdev);
@@ -162,16 +236,17 @@ int block_dev_read_buffered(struct block_dev *bdev, char *buffer, size_t count,
 		bh = bcache_getblk_locked(bdev, blkno + i, blksize);
 		{
 			if (buffer_new(bh)) {
-				if (blksize != (res = bdev->driver->read(bdev, bh->data, blksize, blkno + i))
-						|| 0 != (res = buffer_decrypt(bh))) {
+				window = block_dev_ra_window(bdev, blkno + i,
+						(count - cplen + blksize - 1) / blksize + 1);
+				if (0 != (res = block_dev_read_ahead(bdev, bh, blksize, window))) {
 					bcache_buffer_unlock(bh);
 					return res;
 				}
-				buffer_clear_flag(bh, BH_NEW);
 			}
 			memcpy(buffer + cursor, bh->data + (i == 0 ? offset % blksize : 0), cplen);
 		}
 		bcache_buffer_unlock(bh);
+		bdev->ra_next = blkno + i + 1;
 	}
 
 	return cursor;
@@ -214,18 +289,10 @@ int block_dev_write_buffered(struct block_dev *bdev, const char *buffer, size_t
 				buffer_clear_flag(bh, BH_NEW);
 			}
 			memcpy(bh->data + (i == 0 ? offset % blksize : 0), buffer + cursor, cplen);
-			/**
-			 * Blocks are stored in the buffer cache in a decrypted state.
-			 * Therefore first we encrypt block, then write it onto disk and then decrypt block.
-			 */
-			buffer_encrypt(bh);
-			if (blksize != (res = bdev->driver->write(bdev, bh->data,
-					blksize, blkno + i))) {
-				buffer_decrypt(bh);
+			if (0 != (res = bcache_mark_dirty(bh))) {
 				bcache_buffer_unlock(bh);
 				return res;
 			}
-			buffer_decrypt(bh);
 		}
 		bcache_buffer_unlock(bh);
 	}
@@ -23,6 +23,7 @@
 #include <util/binalign.h>
 
 #include <drivers/block_dev.h>
+#include <drivers/block_dev/bio.h>
 
 #include <drivers/block_dev/ramdisk/ramdisk.h>
 
@@ -35,12 +36,14 @@ INDEX_DEF(ramdisk_idx,0,MAX_DEV_QUANTITY);
 static int read_sectors(struct block_dev *bdev, char *buffer, size_t count, blkno_t blkno);
 static int write_sectors(struct block_dev *bdev, char *buffer, size_t count, blkno_t blkno);
 static int ram_ioctl(struct block_dev *bdev, int cmd, void *args, size_t size);
+static int ram_submit(struct block_dev *bdev, struct bio *bio);
 
 block_dev_driver_t ramdisk_pio_driver = {
-	"ramdisk_drv",
-	ram_ioctl,
-	read_sectors,
-	write_sectors
+	.name   = "ramdisk_drv",
+	.ioctl  = ram_ioctl,
+	.read   = read_sectors,
+	.write  = write_sectors,
+	.submit = ram_submit
 };
 
 static int ramdisk_get_index(char *path) {
@@ -147,8 +150,8 @@ int ramdisk_delete(const char *name) {
 		if (-1 != (idx = ramdisk_get_index((char *)name))) {
 			index_free(&ramdisk_idx, idx);
 		}
-		pool_free(&ramdisk_pool, ramdisk);
 		block_dev_destroy (node_fi->privdata);
+		pool_free(&ramdisk_pool, ramdisk);
 		vfs_del_leaf(ramdisk_node.node);
 	}
 	return 0;
@@ -179,6 +182,30 @@ static int write_sectors(struct block_dev *bdev,
 	return count;
 }
 
+/* Transfers are just memcpy, so requests complete right away */
+static int ram_submit(struct block_dev *bdev, struct bio *bio) {
+	ramdisk_t *ramdisk;
+	struct bio *b;
+	char *addr;
+	int i;
+
+	ramdisk = (ramdisk_t *) bdev->privdata;
+	addr = ramdisk->p_start_addr + (bio->blkno * bdev->block_size);
+
+	for (b = bio; b; b = b->next) {
+		for (i = 0; i < b->vcnt; addr += b->vec[i++].len) {
+			if (b->rw == BIO_READ) {
+				memcpy(b->vec[i].buf, addr, b->vec[i].len);
+			} else {
+				memcpy(addr, b->vec[i].buf, b->vec[i].len);
+			}
+		}
+	}
+
+	bio_endio(bio, 0);
+	return 0;
+}
+
 static int ram_ioctl(struct block_dev *bdev, int cmd, void *args, size_t size) {
 	ramdisk_t *ramd = (ramdisk_t *) bdev->privdata;
 
@@ -24,6 +24,7 @@
 #include <util/binalign.h>
 
 #include <drivers/block_dev.h>
+#include <drivers/block_dev/bio.h>
 #include <drivers/device.h>
 #include <drivers/block_dev/ramdisk/ramdisk.h>
 
@@ -35,11 +36,13 @@ INDEX_DEF(ramdisk_idx, 0, MAX_DEV_QUANTITY);
 
 static int read_sectors(struct block_dev *bdev, char *buffer, size_t count, blkno_t blkno);
 static int write_sectors(struct block_dev *bdev, char *buffer, size_t count, blkno_t blkno);
+static int ram_submit(struct block_dev *bdev, struct bio *bio);
 
 struct block_dev_driver ramdisk_pio_driver = {
-	.name  = "ramdisk_drv",
-	.read  = read_sectors,
-	.write = write_sectors
+	.name   = "ramdisk_drv",
+	.read   = read_sectors,
+	.write  = write_sectors,
+	.submit = ram_submit
 };
 
 struct ramdisk *ramdisk_create(char *path, size_t size) {
@@ -103,14 +106,15 @@ int ramdisk_delete(const char *name) {
 	if (!pool_belong(&ramdisk_pool, ram))
 		return -EINVAL;
 
+	/* Cached blocks are written back on free */
+	block_dev_free(bdev);
+
 	ramsize = ram->blocks * RAMDISK_BLOCK_SIZE + PAGE_SIZE() - 1;
 
 	phymem_free(ram->p_start_addr, ramsize / PAGE_SIZE());
 	index_free(&ramdisk_idx, ram->idx);
 	pool_free(&ramdisk_pool, ram);
 
-	block_dev_free(bdev);
-
 	return 0;
 }
 
@@ -138,3 +142,27 @@ static int write_sectors(struct block_dev *bdev,
 	memcpy(write_addr, buffer, count);
 	return count;
 }
+
+/* Transfers are just memcpy, so requests complete right away */
+static int ram_submit(struct block_dev *bdev, struct bio *bio) {
+	ramdisk_t *ramdisk;
+	struct bio *b;
+	char *addr;
+	int i;
+
+	ramdisk = (ramdisk_t *) bdev->privdata;
+	addr = ramdisk->p_start_addr + (bio->blkno * bdev->block_size);
+
+	for (b = bio; b; b = b->next) {
+		for (i = 0; i < b->vcnt; addr += b->vec[i++].len) {
+			if (b->rw == BIO_READ) {
+				memcpy(b->vec[i].buf, addr, b->vec[i].len);
+			} else {
+				memcpy(addr, b->vec[i].buf, b->vec[i].len);
+			}
+		}
+	}
+
+	bio_endio(bio, 0);
+	return 0;
+}
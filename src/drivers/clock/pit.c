@@ -30,6 +30,9 @@
 #define PIT_LOAD ((INPUT_CLOCK + PIT_HZ / 2) / PIT_HZ)
 static_assert(PIT_LOAD < 0x10000);
 
+/* The longest one-shot event in PIT_HZ periods */
+#define PIT_ONESHOT_MAX (0xffff / PIT_LOAD)
+
 static int pit_clock_setup(struct time_dev_conf * conf);
 static int pit_clock_init(void);
 
@@ -37,6 +40,9 @@ static struct clock_source pit_clock_source;
 static struct time_event_device pit_event_device;
 static struct time_counter_device pit_counter_device;
 
+/* Value loaded into the counter by the last setup */
+static uint16_t pit_load = PIT_LOAD;
+
 //EMBOX_UNIT_INIT(pit_clock_init);
 
 /**
@@ -92,14 +98,31 @@ static struct time_counter_device pit_counter_device;
 #define PIT_16BIT       0x30    /* r/w counter 16 bits, LSB first */
 #define PIT_BCD         0x01    /* count in BCD */
 
-static cycle_t i8253_read(void) {
+static uint16_t i8253_count(void) {
 	unsigned char lsb, msb;
 
 	out8(PIT_SEL0 | PIT_LATCH, MODE_REG);
 	lsb = in8(CHANNEL0);
 	msb = in8(CHANNEL0);
 
-	return PIT_LOAD - ((msb << 8) | lsb);
+	return (msb << 8) | lsb;
+}
+
+static cycle_t i8253_read(void) {
+	return (uint16_t) (pit_load - i8253_count()) % PIT_LOAD;
+}
+
+static int pit_oneshot_elapsed(unsigned int *frac) {
+	uint16_t passed = pit_load - i8253_count();
+
+	/* After terminal count the counter wraps around */
+	if (passed > pit_load) {
+		passed = pit_load;
+	}
+
+	*frac = (passed % PIT_LOAD) * TIME_EVENT_FRAC_ONE / PIT_LOAD;
+
+	return passed / PIT_LOAD;
 }
 
 static irq_return_t clock_handler(unsigned int irq_nr, void *dev_id) {
@@ -111,7 +134,8 @@ static struct time_event_device pit_event_device = {
 	.config = pit_clock_setup,
 	.event_hz = PIT_HZ,
 	.irq_nr = IRQ_NR,
-	.pending = irqctrl_pending
+	.pending = irqctrl_pending,
+	.oneshot_elapsed = pit_oneshot_elapsed,
 };
 
 static struct time_counter_device pit_counter_device = {
@@ -141,12 +165,25 @@ static int pit_clock_init(void) {
 
 static int pit_clock_setup(struct time_dev_conf * conf) {
 	uint16_t divisor = PIT_LOAD;
+	uint8_t mode = PIT_RATEGEN;
 
 	pit_clock_source.flags = 1;
 
-	/* Propose switch by all modes in future */
+	if (conf && conf->period_type == HW_TIMER_ONESHOOT) {
+		if (conf->event_period <= 0) {
+			return -EINVAL;
+		}
+		if (conf->event_period > PIT_ONESHOT_MAX) {
+			conf->event_period = PIT_ONESHOT_MAX;
+		}
+
+		divisor = conf->event_period * PIT_LOAD;
+		mode = PIT_INTTC;
+	}
+	pit_load = divisor;
+
 	/* Set control byte */
-	out8(PIT_SEL0 | PIT_16BIT | PIT_RATEGEN, MODE_REG);
+	out8(PIT_SEL0 | PIT_16BIT | mode, MODE_REG);
 
 	/* Send divisor */
 	out8(divisor & 0xFF, CHANNEL0);
@@ -177,24 +177,23 @@ static void txed_skb_clean(struct net_device *dev) {
 	irq_unlock();
 }
 
-static void e1000_rx(struct net_device *dev) {
+/* Called from poll only, RX interrupt is masked so no locking needed */
+static int e1000_rx(struct net_device *dev, int budget) {
 	/*net_device_stats_t stat = get_eth_stat(dev);*/
 	struct e1000_priv *nic_priv = e1000_get_priv(dev);
 	struct sk_buff *skb, *new_skb;
 	uint16_t head;
 	uint16_t tail;
 	uint16_t cur;
+	int done;
 
-	/* nested irq locked to prevent already handled packets handled once more
-	 * as tail updated at exit
-	 */
-	irq_lock();
+	done = 0;
 	{
 		head = REG_LOAD(e1000_reg(dev, E1000_REG_RDH));
 		tail = REG_LOAD(e1000_reg(dev, E1000_REG_RDT));
 		cur = (1 + tail) % E1000_RXDESC_NR;
 
-		while (cur != head) {
+		while ((cur != head) && (done < budget)) {
 			int len;
 
 			if (!(nic_priv->rx_descs[cur].status)) {
@@ -226,15 +225,32 @@ static void e1000_rx(struct net_device *dev) {
 				goto drop_pack;
 			}
 			skb->dev = dev;
-			netif_rx(skb);
+			netif_receive_skb(skb);
 drop_pack:
+			nic_priv->rx_descs[cur].status = 0;
+			++done;
 			tail = cur;
 
 			cur = (1 + tail) % E1000_RXDESC_NR;
 		}
 		REG_STORE(e1000_reg(dev, E1000_REG_RDT), tail);
 	}
-	irq_unlock();
+
+	return done;
+}
+
+static int e1000_poll(struct net_device *dev, int budget) {
+	int done;
+
+	done = e1000_rx(dev, budget);
+	if (done < budget) {
+		/* ring is drained, packets arrived after that have their cause
+		 * latched in ICR and raise interrupt as soon as it's unmasked */
+		REG_STORE(e1000_reg(dev, E1000_REG_IMS),
+				E1000_REG_IMS_RXO | E1000_REG_IMS_RXT);
+	}
+
+	return done;
 }
 
 static irq_return_t e1000_interrupt(unsigned int irq_num, void *dev_id) {
@@ -243,7 +259,10 @@ static irq_return_t e1000_interrupt(unsigned int irq_num, void *dev_id) {
 	irq_return_t ret = IRQ_NONE;
 
 	if (cause & (E1000_REG_ICR_RXO | E1000_REG_ICR_RXT)) {
-		e1000_rx(dev_id);
+		/* no more RX interrupts until e1000_poll drains the ring */
+		REG_STORE(e1000_reg(dev_id, E1000_REG_IMC),
+				E1000_REG_IMS_RXO | E1000_REG_IMS_RXT);
+		netif_poll_schedule(dev_id);
 		ret = IRQ_HANDLED;
 	}
 
@@ -395,7 +414,8 @@ static const struct net_driver _drv_ops = {
 	.xmit = xmit,
 	.start = e1000_open,
 	.stop = e1000_stop,
-	.set_macaddr = set_mac_address
+	.set_macaddr = set_mac_address,
+	.poll = e1000_poll
 };
 
 static void e1000_enable_bus_mastering(struct pci_slot_dev *pci_dev) {
@@ -84,43 +84,17 @@ static int virtio_xmit(struct net_device *dev, struct sk_buff *skb) {
 	return 0;
 }
 
-static irq_return_t virtio_interrupt(unsigned int irq_num,
-		void *dev_id) {
-	struct net_device *dev;
+static int virtio_rx(struct net_device *dev, int budget) {
 	struct virtqueue *vq;
 	struct vring_used_elem *used_elem;
 	struct sk_buff *skb;
 	struct sk_buff_data *new_data;
 	struct vring_desc *desc, *next;
+	int done;
 
-	dev = dev_id;
-
-	/* it is really? */
-	if (~virtio_net_get_isr_status(dev) & 1) {
-		return IRQ_NONE;
-	}
-
-	/* release outgoing packets */
-	vq = &netdev_priv(dev, struct virtio_priv)->tq;
-	while (vq->last_seen_used != vq->ring.used->idx) {
-		used_elem = &vq->ring.used->ring[vq->last_seen_used % vq->ring.num];
-
-		desc = &vq->ring.desc[used_elem->id];
-		skb_extra_free(skb_extra_cast_out((void *)(uintptr_t)desc->addr));
-		desc->addr = 0;
-		assert(desc->flags & VRING_DESC_F_NEXT);
-
-		next = &vq->ring.desc[desc->next];
-		skb_data_free(skb_data_cast_out((void *)(uintptr_t)next->addr));
-		next->addr = 0;
-		assert(~next->flags & VRING_DESC_F_NEXT);
-
-		++vq->last_seen_used;
-	}
-
-	/* receive incoming packets */
+	done = 0;
 	vq = &netdev_priv(dev, struct virtio_priv)->rq;
-	while (vq->last_seen_used != vq->ring.used->idx) {
+	while ((vq->last_seen_used != vq->ring.used->idx) && (done < budget)) {
 		used_elem = &vq->ring.used->ring[vq->last_seen_used % vq->ring.num];
 
 		desc = &vq->ring.desc[used_elem->id];
@@ -136,7 +110,8 @@ static irq_return_t virtio_interrupt(unsigned int irq_num,
 			break;
 		}
 		skb->dev = dev;
-		netif_rx(skb);
+		netif_receive_skb(skb);
+		++done;
 
 		++vq->last_seen_used;
 
@@ -155,6 +130,68 @@ static irq_return_t virtio_interrupt(unsigned int irq_num,
 		virtio_net_notify_queue(VIRTIO_NET_QUEUE_RX, dev);
 	}
 
+	return done;
+}
+
+static int virtio_poll(struct net_device *dev, int budget) {
+	struct virtqueue *vq;
+	int done;
+
+	vq = &netdev_priv(dev, struct virtio_priv)->rq;
+
+	done = virtio_rx(dev, budget);
+	if (done < budget) {
+		vq->ring.avail->flags &= ~VRING_AVAIL_F_NO_INTERRUPT;
+		__sync_synchronize();
+		/* buffers used before interrupts were enabled don't raise one */
+		if (vq->last_seen_used != vq->ring.used->idx) {
+			vq->ring.avail->flags |= VRING_AVAIL_F_NO_INTERRUPT;
+			netif_poll_schedule(dev);
+		}
+	}
+
+	return done;
+}
+
+static irq_return_t virtio_interrupt(unsigned int irq_num,
+		void *dev_id) {
+	struct net_device *dev;
+	struct virtqueue *vq;
+	struct vring_used_elem *used_elem;
+	struct vring_desc *desc, *next;
+
+	dev = dev_id;
+
+	/* it is really? */
+	if (~virtio_net_get_isr_status(dev) & 1) {
+		return IRQ_NONE;
+	}
+
+	/* release outgoing packets */
+	vq = &netdev_priv(dev, struct virtio_priv)->tq;
+	while (vq->last_seen_used != vq->ring.used->idx) {
+		used_elem = &vq->ring.used->ring[vq->last_seen_used % vq->ring.num];
+
+		desc = &vq->ring.desc[used_elem->id];
+		skb_extra_free(skb_extra_cast_out((void *)(uintptr_t)desc->addr));
+		desc->addr = 0;
+		assert(desc->flags & VRING_DESC_F_NEXT);
+
+		next = &vq->ring.desc[desc->next];
+		skb_data_free(skb_data_cast_out((void *)(uintptr_t)next->addr));
+		next->addr = 0;
+		assert(~next->flags & VRING_DESC_F_NEXT);
+
+		++vq->last_seen_used;
+	}
+
+	/* incoming packets are received by virtio_poll with interrupts off */
+	vq = &netdev_priv(dev, struct virtio_priv)->rq;
+	if (vq->last_seen_used != vq->ring.used->idx) {
+		vq->ring.avail->flags |= VRING_AVAIL_F_NO_INTERRUPT;
+		netif_poll_schedule(dev);
+	}
+
 	return IRQ_HANDLED;
 }
 
@@ -185,7 +222,8 @@ static const struct net_driver virtio_drv_ops = {
 	.xmit = virtio_xmit,
 	.start = virtio_open,
 	.stop = virtio_stop,
-	.set_macaddr = virtio_set_macaddr
+	.set_macaddr = virtio_set_macaddr,
+	.poll = virtio_poll
 };
 
 static void virtio_config(struct net_device *dev) {
@@ -2,161 +2,589 @@
  * @file
  * @brief Buffer cache
  *
+ * Buffers are looked up through a hash table split into stripes with
+ * separate mutexes, so lookups of different blocks don't serialize.
+ * Unlocked buffers are reclaimed one by one in LRU order (clean ones
+ * first) when a new buffer is needed. Dirty buffers are written by the
+ * writeback thread when they become old enough or when there are too
+ * many of them. Adjacent dirty blocks are merged into one request.
+ *
+ * Lock order: stripe mutex, then bcache_lock. Buffer mutex is never
+ * taken while holding any of them.
+ *
  * @author  Alexander Kalmuk
  * @date    22.07.2013
  */
 
+#include <errno.h>
 #include <string.h>
 #include <stdbool.h>
+#include <stdint.h>
 #include <stdlib.h>
 
-#include <util/hashtable.h>
+#include <hal/clock.h>
+#include <kernel/spinlock.h>
+#include <kernel/thread.h>
+#include <kernel/thread/waitq.h>
+#include <kernel/time/time.h>
+#include <util/err.h>
 
+#include <mem/kmalloc.h>
 #include <mem/misc/pool.h>
 #include <mem/sysmalloc.h>
 
+#include <drivers/block_dev/bio.h>
 #include <fs/bcache.h>
 
 
 #include <embox/unit.h>
 EMBOX_UNIT_INIT(bcache_init);
 
-#define BCACHE_SIZE OPTION_GET(NUMBER, bcache_size)
+#define BCACHE_SIZE     OPTION_GET(NUMBER, bcache_size)
+#define BCACHE_HASH_SZ  OPTION_GET(NUMBER, hash_size)
+#define BCACHE_STRIPES  OPTION_GET(NUMBER, hash_stripes)
+#define BCACHE_WB_DELAY OPTION_GET(NUMBER, writeback_delay)
+#define BCACHE_WB_MAX   OPTION_GET(NUMBER, dirty_max)
+#define BCACHE_WC_MAX   OPTION_GET(NUMBER, write_cluster_max)
+
+#define BCACHE_STRIPE_BUCKETS \
+	((BCACHE_HASH_SZ + BCACHE_STRIPES - 1) / BCACHE_STRIPES)
+
+struct bcache_stripe {
+	struct mutex mutex;
+	struct dlist_head bucket[BCACHE_STRIPE_BUCKETS];
+};
 
 POOL_DEF(buffer_head_pool, struct buffer_head, BCACHE_SIZE);
-static DLIST_DEFINE(bh_list);
 
+static struct bcache_stripe bcache_stripes[BCACHE_STRIPES];
 
-static size_t bh_hash(void *key);
-static int bh_cmp(void *key1, void *key2);
-HASHTABLE_DEF(bcache_ht, BCACHE_SIZE / 10, bh_hash, bh_cmp);
-POOL_DEF(bcach_ht_item_pool, struct hashtable_item, BCACHE_SIZE);
+/* Protects LRU and dirty lists, buffer_head_pool, users and statistics */
+static spinlock_t bcache_lock = SPIN_STATIC_UNLOCKED;
+static DLIST_DEFINE(bh_lru);
+static DLIST_DEFINE(bh_dirty);
+static struct bcache_stat bcache_stat;
 
-static struct hashtable *bcache = &bcache_ht;
-static struct mutex bcache_mutex;
-static int graw_buffers(struct block_dev *bdev, int block, size_t size);
-static void free_more_memory(size_t size);
+static struct waitq bcache_wb_wq = WAITQ_INIT(bcache_wb_wq);
 
-struct buffer_head *bcache_getblk_locked(struct block_dev *bdev, int block, size_t size) {
-	struct buffer_head key = { .bdev = bdev, .block = block };
-	struct buffer_head *bh;
+static size_t bh_hash(struct block_dev *bdev, int block) {
+	return (((uintptr_t)bdev >> 4) * 31 + (unsigned int)block);
+}
 
-	assert(bdev);
+static struct bcache_stripe *bh_stripe(struct block_dev *bdev, int block) {
+	return &bcache_stripes[bh_hash(bdev, block) % BCACHE_STRIPES];
+}
 
-	mutex_lock(&bcache_mutex);
-	while (1) {
-		bh = (struct buffer_head *)hashtable_get(bcache, &key);
+static struct dlist_head *bh_bucket(struct block_dev *bdev, int block) {
+	return &bh_stripe(bdev, block)->bucket[
+		(bh_hash(bdev, block) / BCACHE_STRIPES) % BCACHE_STRIPE_BUCKETS];
+}
 
-		if (bh) {
-			assert(size == bh->blocksize);
-			bcache_buffer_lock(bh);
-			mutex_unlock(&bcache_mutex);
+static struct buffer_head *bh_lookup(struct block_dev *bdev, int block) {
+	struct buffer_head *bh;
+
+	dlist_foreach_entry(bh, bh_bucket(bdev, block), hash_lnk) {
+		if ((bh->bdev == bdev) && (bh->block == block)) {
 			return bh;
 		}
+	}
+
+	return NULL;
+}
+
+static void bh_lock(struct buffer_head *bh) {
+	mutex_lock(&bh->mutex);
+	bh->lock_count++;
+}
+
+void bcache_buffer_lock(struct buffer_head *bh) {
+	ipl_t ipl;
+
+	ipl = spin_lock_ipl(&bcache_lock);
+	bh->users++;
+	spin_unlock_ipl(&bcache_lock, ipl);
 
-		while (-1 == graw_buffers(bdev, block, size)) {
-			free_more_memory(size);
+	bh_lock(bh);
+}
+
+void bcache_buffer_unlock(struct buffer_head *bh) {
+	ipl_t ipl;
+
+	bh->lock_count--;
+	mutex_unlock(&bh->mutex);
+
+	ipl = spin_lock_ipl(&bcache_lock);
+	bh->users--;
+	spin_unlock_ipl(&bcache_lock, ipl);
+}
+
+static void bh_clean(struct buffer_head *bh) {
+	ipl_t ipl;
+
+	ipl = spin_lock_ipl(&bcache_lock);
+	{
+		if (!dlist_empty(&bh->dirty_lnk)) {
+			dlist_del_init(&bh->dirty_lnk);
+			bcache_stat.dirty--;
 		}
+		buffer_clear_flag(bh, BH_DIRTY);
+		bcache_stat.writebacks++;
 	}
-	mutex_unlock(&bcache_mutex);
+	spin_unlock_ipl(&bcache_lock, ipl);
+}
 
-	assert(0); /* UNREACHABLE */
-	return NULL;
+/* Must be called with @a bh locked or unreachable */
+static int bh_write(struct buffer_head *bh) {
+	int res;
+
+	assert(bh->bdev && bh->bdev->driver);
+	assert(bh->bdev->driver->write);
+
+	/**
+	 * Blocks are stored in the buffer cache in a decrypted state.
+	 * Therefore first we encrypt block, then write it onto disk and then decrypt block.
+	 */
+	buffer_encrypt(bh);
+	res = block_dev_io(bh->bdev, BIO_WRITE, bh->data, bh->blocksize, bh->block);
+	buffer_decrypt(bh);
+	if (res) {
+		return res;
+	}
+
+	bh_clean(bh);
+
+	return 0;
 }
 
-static void free_more_memory(size_t size) {
+/**
+ * Returns locked dirty buffer of the block if it's cached and can be
+ * locked without waiting
+ */
+static struct buffer_head *bh_get_dirty(struct block_dev *bdev, int block,
+		size_t size) {
+	struct bcache_stripe *st;
 	struct buffer_head *bh;
-	struct hashtable_item *ht_item;
+	ipl_t ipl;
+
+	st = bh_stripe(bdev, block);
 
-	/* Free everything that we can free */
-	dlist_foreach_entry(bh, &bh_list, bh_next) {
-		if (buffer_locked(bh)) {
+	mutex_lock(&st->mutex);
+	bh = bh_lookup(bdev, block);
+	if (bh) {
+		ipl = spin_lock_ipl(&bcache_lock);
+		bh->users++;
+		spin_unlock_ipl(&bcache_lock, ipl);
+	}
+	mutex_unlock(&st->mutex);
+
+	if (!bh) {
+		return NULL;
+	}
+
+	if (0 != mutex_trylock(&bh->mutex)) {
+		ipl = spin_lock_ipl(&bcache_lock);
+		bh->users--;
+		spin_unlock_ipl(&bcache_lock, ipl);
+		return NULL;
+	}
+	bh->lock_count++;
+
+	if (!buffer_dirty(bh) || buffer_journal(bh) || (bh->blocksize != size)) {
+		bcache_buffer_unlock(bh);
+		return NULL;
+	}
+
+	return bh;
+}
+
+/**
+ * Writes locked dirty @a bh together with the following dirty blocks of
+ * the same device with a single block request
+ */
+static int bh_write_cluster(struct buffer_head *bh) {
+	struct buffer_head *wc[BCACHE_WC_MAX];
+	size_t size = bh->blocksize;
+	char *buf = NULL;
+	int n, i, res;
+
+	wc[0] = bh;
+	for (n = 1; n < BCACHE_WC_MAX; n++) {
+		wc[n] = bh_get_dirty(bh->bdev, bh->block + n, size);
+		if (!wc[n]) {
+			break;
+		}
+	}
+
+	if (n > 1) {
+		buf = sysmalloc(n * size);
+	}
+	if (!buf) {
+		for (i = 1; i < n; i++) {
+			bcache_buffer_unlock(wc[i]);
+		}
+		return bh_write(bh);
+	}
+
+	for (i = 0; i < n; i++) {
+		buffer_encrypt(wc[i]);
+		memcpy(buf + i * size, wc[i]->data, size);
+		buffer_decrypt(wc[i]);
+	}
+
+	res = block_dev_io(bh->bdev, BIO_WRITE, buf, n * size, bh->block);
+	sysfree(buf);
+
+	for (i = 0; i < n; i++) {
+		if (0 == res) {
+			bh_clean(wc[i]);
+		}
+		if (i > 0) {
+			bcache_buffer_unlock(wc[i]);
+		}
+	}
+
+	return res;
+}
+
+/* Must be called under bcache_lock */
+static struct buffer_head *bh_victim(struct block_dev *bdev) {
+	struct buffer_head *bh, *dirty = NULL;
+
+	dlist_foreach_entry(bh, &bh_lru, bh_next) {
+		if (bh->users || buffer_journal(bh)
+				|| (bdev && (bh->bdev != bdev))) {
 			continue;
 		}
+		if (!buffer_dirty(bh)) {
+			return bh;
+		}
+		if (!dirty) {
+			dirty = bh;
+		}
+	}
+
+	return dirty;
+}
 
-		bcache_buffer_lock(bh);
+/**
+ * Takes the least recently used unlocked buffer (of @a bdev if it's not
+ * NULL) out of the cache. A dirty buffer is written back while it's still
+ * cached, so it stays dirty in the cache if the write fails and another
+ * buffer is taken instead.
+ */
+static struct buffer_head *bh_evict(struct block_dev *bdev) {
+	struct buffer_head *bh;
+	struct bcache_stripe *st;
+	int failed = 0;
+	int res;
+	ipl_t ipl;
+
+	while (1) {
+		ipl = spin_lock_ipl(&bcache_lock);
 		{
-			if (buffer_journal(bh)) {
-				bcache_buffer_unlock(bh);
-				continue;
+			bh = bh_victim(bdev);
+			if (bh && buffer_dirty(bh)) {
+				bh->users++;
+			} else if (bh) {
+				dlist_del_init(&bh->bh_next);
 			}
+		}
+		spin_unlock_ipl(&bcache_lock, ipl);
 
-			if (buffer_dirty(bh)) {
-				assert(bh->bdev && bh->bdev->driver);
-				assert(bh->bdev->driver->write);
-				/* Write directly to disk */
-				bh->bdev->driver->write(bh->bdev, bh->data, bh->blocksize, bh->block);
-			}
+		if (!bh) {
+			return NULL;
+		}
 
-			dlist_del(&bh->bh_next);
-			ht_item = hashtable_del(bcache, bh);
+		if (buffer_dirty(bh)) {
+			/* Caller may hold other buffers, so never wait here */
+			if (0 != mutex_trylock(&bh->mutex)) {
+				ipl = spin_lock_ipl(&bcache_lock);
+				bh->users--;
+				spin_unlock_ipl(&bcache_lock, ipl);
+				continue;
+			}
+			bh->lock_count++;
+
+			res = buffer_dirty(bh) ? bh_write(bh) : 0;
+			bcache_buffer_unlock(bh);
+
+			if (res != 0) {
+				if (++failed >= BCACHE_SIZE) {
+					return NULL;
+				}
+				/* Move it out of the way of the next victim lookup */
+				ipl = spin_lock_ipl(&bcache_lock);
+				dlist_del_init(&bh->bh_next);
+				dlist_add_prev(&bh->bh_next, &bh_lru);
+				spin_unlock_ipl(&bcache_lock, ipl);
+			}
+			continue;
 		}
-		bcache_buffer_unlock(bh);
 
-		sysfree(bh->data);
-		pool_free(&bcach_ht_item_pool, ht_item);
-		pool_free(&buffer_head_pool, bh);
+		st = bh_stripe(bh->bdev, bh->block);
+		mutex_lock(&st->mutex);
+		ipl = spin_lock_ipl(&bcache_lock);
+		if (!bh->users && !buffer_dirty(bh)) {
+			break;
+		}
+		/* Buffer was used meanwhile. Only a lookup puts it back to LRU,
+		 * other users just hold it, so keep it evictable later. */
+		if (dlist_empty(&bh->bh_next)) {
+			dlist_add_prev(&bh->bh_next, &bh_lru);
+		}
+		spin_unlock_ipl(&bcache_lock, ipl);
+		mutex_unlock(&st->mutex);
 	}
+	bcache_stat.evictions++;
+	spin_unlock_ipl(&bcache_lock, ipl);
+
+	dlist_del_init(&bh->hash_lnk);
+	mutex_unlock(&st->mutex);
+
+	return bh;
 }
 
-static int graw_buffers(struct block_dev *bdev, int block, size_t size) {
-	struct buffer_head *bh;
-	struct hashtable_item *ht_item;
+static void bh_free(struct buffer_head *bh) {
+	ipl_t ipl;
 
-	bh = pool_alloc(&buffer_head_pool);
+	kfree(bh->data);
 
-	if (!bh) {
-		return -1;
-	}
+	ipl = spin_lock_ipl(&bcache_lock);
+	pool_free(&buffer_head_pool, bh);
+	spin_unlock_ipl(&bcache_lock, ipl);
+}
 
+static void bh_init(struct buffer_head *bh, struct block_dev *bdev,
+		int block, size_t size, char *data) {
 	memset(bh, 0, sizeof(struct buffer_head));
 
 	buffer_set_flag(bh, BH_NEW);
 	mutex_init(&bh->mutex);
 	dlist_head_init(&bh->bh_next);
+	dlist_head_init(&bh->hash_lnk);
+	dlist_head_init(&bh->dirty_lnk);
 	bh->bdev = bdev;
 	bh->block = block;
 	bh->blocksize = size;
-	bh->data = sysmalloc(size); /* TODO kmalloc */
+	bh->data = data;
+}
+
+static struct buffer_head *bh_alloc(struct block_dev *bdev, int block, size_t size) {
+	struct buffer_head *bh;
+	char *data;
+	ipl_t ipl;
+
+	while (1) {
+		ipl = spin_lock_ipl(&bcache_lock);
+		bh = pool_alloc(&buffer_head_pool);
+		spin_unlock_ipl(&bcache_lock, ipl);
+
+		if (bh) {
+			data = kmalloc(size);
+			if (data) {
+				bh_init(bh, bdev, block, size, data);
+				return bh;
+			}
+
+			ipl = spin_lock_ipl(&bcache_lock);
+			pool_free(&buffer_head_pool, bh);
+			spin_unlock_ipl(&bcache_lock, ipl);
+		}
+
+		/* Reclaim only as much as needed */
+		bh = bh_evict(NULL);
+		if (!bh) {
+			continue;
+		}
+		if (bh->blocksize == size) {
+			bh_init(bh, bdev, block, size, bh->data);
+			return bh;
+		}
+		bh_free(bh);
+	}
+}
+
+struct buffer_head *bcache_getblk_locked(struct block_dev *bdev, int block, size_t size) {
+	struct bcache_stripe *st;
+	struct buffer_head *bh, *new_bh = NULL;
+	bool miss = false;
+	ipl_t ipl;
+
+	assert(bdev);
+
+	st = bh_stripe(bdev, block);
+
+	mutex_lock(&st->mutex);
+	bh = bh_lookup(bdev, block);
+	if (!bh) {
+		/* Eviction takes other stripes' mutexes */
+		mutex_unlock(&st->mutex);
+		new_bh = bh_alloc(bdev, block, size);
+		mutex_lock(&st->mutex);
+
+		bh = bh_lookup(bdev, block);
+		if (!bh) {
+			bh = new_bh;
+			new_bh = NULL;
+			miss = true;
+			dlist_add_prev(&bh->hash_lnk, bh_bucket(bdev, block));
+		}
+	}
+
+	ipl = spin_lock_ipl(&bcache_lock);
+	{
+		if (miss) {
+			bcache_stat.misses++;
+		} else {
+			bcache_stat.hits++;
+		}
+		bh->users++;
+		dlist_del_init(&bh->bh_next);
+		dlist_add_prev(&bh->bh_next, &bh_lru);
+	}
+	spin_unlock_ipl(&bcache_lock, ipl);
+	mutex_unlock(&st->mutex);
+
+	if (new_bh) {
+		/* Somebody else has cached the block meanwhile */
+		bh_free(new_bh);
+	}
+
+	bh_lock(bh);
+	assert(size == bh->blocksize);
 
-	if (!bh->data) {
-		pool_free(&buffer_head_pool, bh);
-		return -1;
+	return bh;
+}
+
+int bcache_mark_dirty(struct buffer_head *bh) {
+	bool wakeup = false;
+	ipl_t ipl;
+
+	if (BCACHE_WB_DELAY == 0) {
+		return bh_write(bh);
 	}
-	ht_item = pool_alloc(&bcach_ht_item_pool);
-	if (!ht_item) {
-		sysfree(bh->data);
-		pool_free(&buffer_head_pool, bh);
-		return -1;
+
+	ipl = spin_lock_ipl(&bcache_lock);
+	if (!buffer_dirty(bh)) {
+		buffer_set_flag(bh, BH_DIRTY);
+		bh->dirty_time = clock_sys_ticks();
+		dlist_add_prev(&bh->dirty_lnk, &bh_dirty);
+		wakeup = (++bcache_stat.dirty > BCACHE_WB_MAX);
 	}
-	ht_item = hashtable_item_init(ht_item, bh, bh);
-	hashtable_put(bcache, ht_item);
+	spin_unlock_ipl(&bcache_lock, ipl);
 
-	dlist_add_next(&bh->bh_next, &bh_list);
+	if (wakeup) {
+		waitq_wakeup_all(&bcache_wb_wq);
+	}
 
 	return 0;
 }
 
-static size_t bh_hash(void *key) {
-	return ((struct buffer_head *)key)->block;
+/**
+ * Writes dirty buffers of @a bdev (of all devices if NULL) in the order
+ * they became dirty. If @a all is not set, stops at the first buffer
+ * which is young enough while there are not too many dirty buffers.
+ */
+static int bh_flush(struct block_dev *bdev, bool all) {
+	struct buffer_head *bh, *tmp;
+	clock_t now, expire;
+	int res = 0;
+	ipl_t ipl;
+
+	now = clock_sys_ticks();
+	expire = ms2jiffies(BCACHE_WB_DELAY);
+
+	while (res == 0) {
+		bh = NULL;
+
+		ipl = spin_lock_ipl(&bcache_lock);
+		dlist_foreach_entry(tmp, &bh_dirty, dirty_lnk) {
+			if (bdev && (tmp->bdev != bdev)) {
+				continue;
+			}
+			if (!all && (bcache_stat.dirty <= BCACHE_WB_MAX)
+					&& (now - tmp->dirty_time < expire)) {
+				break;
+			}
+			bh = tmp;
+			bh->users++;
+			break;
+		}
+		spin_unlock_ipl(&bcache_lock, ipl);
+
+		if (!bh) {
+			break;
+		}
+
+		bh_lock(bh);
+		{
+			if (buffer_journal(bh)) {
+				/* Journal writes the block itself */
+				ipl = spin_lock_ipl(&bcache_lock);
+				dlist_del_init(&bh->dirty_lnk);
+				bcache_stat.dirty--;
+				spin_unlock_ipl(&bcache_lock, ipl);
+			} else if (buffer_dirty(bh)) {
+				res = bh_write_cluster(bh);
+			}
+		}
+		bcache_buffer_unlock(bh);
+	}
+
+	return res;
+}
+
+int bcache_sync(struct block_dev *bdev) {
+	return bh_flush(bdev, true);
 }
 
-static int bh_cmp(void *key1, void *key2) {
-	struct buffer_head *bh1 = (struct buffer_head *)key1;
-	struct buffer_head *bh2 = (struct buffer_head *)key2;
-	int cmp_bdev;
+void bcache_invalidate(struct block_dev *bdev) {
+	struct buffer_head *bh;
 
-	cmp_bdev = bh1->bdev < bh2->bdev ? -1 : bh1->bdev > bh2->bdev;
-	if (!cmp_bdev) {
-		return (bh1->block < bh2->block ? -1 : bh1->block > bh2->block);
+	assert(bdev);
+
+	while (NULL != (bh = bh_evict(bdev))) {
+		bh_free(bh);
 	}
+}
+
+void bcache_get_stat(struct bcache_stat *stat) {
+	ipl_t ipl;
 
-	return cmp_bdev;
+	ipl = spin_lock_ipl(&bcache_lock);
+	memcpy(stat, &bcache_stat, sizeof(*stat));
+	spin_unlock_ipl(&bcache_lock, ipl);
+}
+
+static void *bcache_writeback_run(void *arg) {
+	while (1) {
+		WAITQ_WAIT_TIMEOUT(&bcache_wb_wq, bcache_stat.dirty > BCACHE_WB_MAX,
+				BCACHE_WB_DELAY / 2 + 1);
+		bh_flush(NULL, false);
+	}
+
+	return NULL;
 }
 
 static int bcache_init(void) {
+	struct thread *t;
+	int i, j;
+
+	for (i = 0; i < BCACHE_STRIPES; i++) {
+		mutex_init(&bcache_stripes[i].mutex);
+		for (j = 0; j < BCACHE_STRIPE_BUCKETS; j++) {
+			dlist_init(&bcache_stripes[i].bucket[j]);
+		}
+	}
 
-	mutex_init(&bcache_mutex);
+	if (BCACHE_WB_DELAY == 0) {
+		return 0;
+	}
+
+	t = thread_create(0, bcache_writeback_run, NULL);
+	if (err(t)) {
+		return err(t);
+	}
 
 	return 0;
 }
@@ -254,6 +254,7 @@ static int devfs_fill_sb(struct super_block *sb, struct file *bdev_file) {
 
 static struct dumb_fs_driver devfs_dumb_driver = {
 	.name      = "devfs",
+	.flags     = DVFS_DRV_NO_NEGATIVE,
 	.fill_sb   = devfs_fill_sb,
 	.mount_end = devfs_mount_end,
 };
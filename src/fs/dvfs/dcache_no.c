@@ -9,25 +9,31 @@
 #include <string.h>
 #include <fs/dvfs.h>
 
-struct dentry *dvfs_cache_lookup(const char *path, struct dentry *base) {
-	return NULL;
-}
-
-struct dentry *dvfs_cache_get(char *path, struct lookup *lookup) {
+struct dentry *dvfs_cache_get(struct dentry *parent, const char *name) {
 	struct dentry *d;
 	struct dlist_head *l;
-	dlist_foreach(l, &lookup->parent->children) {
-		if (l == &lookup->parent->children)
+	dlist_foreach(l, &parent->children) {
+		if (l == &parent->children)
 			continue;
 		d = mcast_out(l, struct dentry, children_lnk);
 
-		if (d != lookup->item && !strcmp(d->name, lookup->item->name))
+		if (!strcmp(d->name, name))
 			return d;
 	}
 
 	return NULL;
 }
 
+int dvfs_cache_negative(struct dentry *parent, const char *name) {
+	return 0;
+}
+
+void dvfs_cache_add_negative(struct dentry *parent, const char *name) {
+}
+
+void dvfs_cache_drop_negative(struct dentry *parent) {
+}
+
 int dvfs_cache_del(struct dentry *dentry) {
 	return 0;
 }
@@ -1,62 +1,134 @@
 /**
  * @file
  * @brief Cache strategy using polynomial hashes to retrive dentries
+ *
+ * Dentries are hashed by (parent dentry, name), so each path component
+ * is resolved with a single bucket lookup. Names which the file system
+ * driver failed to find are remembered as negative entries, so repeated
+ * lookups of missing files don't reach the driver. Drivers flagged with
+ * DVFS_DRV_NO_NEGATIVE (devfs) are always asked.
+ *
  * @author Denis Deryugin <deryugin.denis@gmail.com>
  * @version 0.1
  * @date 2015-06-09
  */
 
+#include <stdint.h>
 #include <string.h>
 
+#include <embox/unit.h>
+#include <framework/mod/options.h>
 #include <fs/dvfs.h>
-#include <kernel/printk.h>
 #include <mem/misc/pool.h>
-#include <util/hashtable.h>
+#include <util/dlist.h>
 
-/* TODO remove this */
-#define DENTRY_POOL_SIZE 64
+#define DCACHE_HASH_SIZE OPTION_GET(NUMBER, hash_size)
+#define DCACHE_NEG_SIZE  OPTION_GET(NUMBER, negative_size)
 
-static const unsigned long long prime = 19, module = 1023;
-static unsigned long long pows[DVFS_MAX_PATH_LEN];
+#define DCACHE_PRIME 31
 
-static void hash_init(void) {
-	/* TODO precount in runtime or even in compiletime */
-	int i;
-	pows[0] = 1;
-	for (i = 1; i < DVFS_MAX_PATH_LEN; i++)
-		pows[i] = (pows[i - 1] * prime) % module;
-}
+EMBOX_UNIT_INIT(dcache_init);
 
-static unsigned long long poly_hash(const char *str) {
-	unsigned long long res = 0;
-	const char *pos = str;
+struct dcache_neg {
+	struct dlist_head lnk;      /* Link in bucket */
+	struct dlist_head lru_lnk;
+	struct dentry *parent;
+	unsigned int hash;
+	char name[DENTRY_NAME_LEN];
+};
 
-	hash_init();
+static struct dlist_head dentry_ht[DCACHE_HASH_SIZE];
+static struct dlist_head neg_ht[DCACHE_HASH_SIZE];
 
-	while (*pos) {
-		res += ((int) *str) * pows[pos - str];
-		res %= module;
-		pos++;
+POOL_DEF(neg_pool, struct dcache_neg, DCACHE_NEG_SIZE);
+static DLIST_DEFINE(neg_lru);
+
+static unsigned int poly_hash(const char *str) {
+	unsigned int res = 0;
+
+	while (*str) {
+		res = res * DCACHE_PRIME + (unsigned char) *str++;
 	}
+
 	return res;
 }
 
-static size_t get_dentry_hash(void *key) {
-	return (size_t) key;
+static size_t dcache_bucket(struct dentry *parent, unsigned int hash) {
+	return (hash ^ ((uintptr_t) parent >> 4)) % DCACHE_HASH_SIZE;
 }
 
-static int cmp_dentries(void *key1, void *key2) {
-	return !(key1 == key2);
+struct dentry *dvfs_cache_get(struct dentry *parent, const char *name) {
+	unsigned int hash = poly_hash(name);
+	struct dentry *d;
+
+	dlist_foreach_entry(d, &dentry_ht[dcache_bucket(parent, hash)], d_hash_lnk) {
+		if (d->parent == parent && d->d_hash == hash && !strcmp(d->name, name)) {
+			return d;
+		}
+	}
+
+	return NULL;
 }
 
-HASHTABLE_DEF(dentry_ht,
-		DENTRY_POOL_SIZE * sizeof(struct dentry *),
-		get_dentry_hash,
-		cmp_dentries);
+static struct dcache_neg *dcache_neg_find(struct dentry *parent,
+		const char *name, unsigned int hash) {
+	struct dcache_neg *neg;
+
+	dlist_foreach_entry(neg, &neg_ht[dcache_bucket(parent, hash)], lnk) {
+		if (neg->parent == parent && neg->hash == hash && !strcmp(neg->name, name)) {
+			return neg;
+		}
+	}
+
+	return NULL;
+}
 
-POOL_DEF(dentry_ht_pool, struct hashtable_item, DENTRY_POOL_SIZE);
+static void dcache_neg_free(struct dcache_neg *neg) {
+	dlist_del(&neg->lnk);
+	dlist_del(&neg->lru_lnk);
+	pool_free(&neg_pool, neg);
+}
+
+int dvfs_cache_negative(struct dentry *parent, const char *name) {
+	struct dcache_neg *neg;
+
+	neg = dcache_neg_find(parent, name, poly_hash(name));
+	if (neg) {
+		dlist_move(&neg->lru_lnk, &neg_lru);
+	}
+
+	return neg != NULL;
+}
+
+void dvfs_cache_add_negative(struct dentry *parent, const char *name) {
+	struct dcache_neg *neg;
+	unsigned int hash;
+
+	if (strlen(name) >= DENTRY_NAME_LEN) {
+		return;
+	}
+
+	hash = poly_hash(name);
+	if (dcache_neg_find(parent, name, hash)) {
+		return;
+	}
+
+	neg = pool_alloc(&neg_pool);
+	if (!neg) {
+		/* Reuse the least recently used entry, list head is the newest */
+		neg = dlist_entry(neg_lru.prev, struct dcache_neg, lru_lnk);
+		dlist_del(&neg->lnk);
+		dlist_del(&neg->lru_lnk);
+	}
 
-extern int dentry_full_path(struct dentry *dentry, char *buf);
+	neg->parent = parent;
+	neg->hash = hash;
+	strcpy(neg->name, name);
+	dlist_head_init(&neg->lnk);
+	dlist_head_init(&neg->lru_lnk);
+	dlist_add_next(&neg->lnk, &neg_ht[dcache_bucket(parent, hash)]);
+	dlist_add_next(&neg->lru_lnk, &neg_lru);
+}
 
 /**
  * @brief Add dentry to cache
@@ -65,14 +137,25 @@ extern int dentry_full_path(struct dentry *dentry, char *buf);
  * @return Negative error code
  */
 int dvfs_cache_add(struct dentry *dentry) {
-	char pathname[DVFS_MAX_PATH_LEN];
-	unsigned long long hash;
-	struct hashtable_item *ht_item = pool_alloc(&dentry_ht_pool);
-	assert(ht_item);
-	dentry_full_path(dentry, pathname);
-	hash = poly_hash(pathname);
-	ht_item = hashtable_item_init(ht_item, (void *) *((size_t *) &hash), dentry);
-	hashtable_put(&dentry_ht, ht_item);
+	struct dcache_neg *neg;
+
+	if (dentry->name[0] == '\0' || !dentry->parent || dentry->parent == dentry) {
+		return -1;
+	}
+
+	if (!dlist_empty(&dentry->d_hash_lnk)) {
+		return 0;
+	}
+
+	dentry->d_hash = poly_hash(dentry->name);
+	dlist_add_next(&dentry->d_hash_lnk,
+			&dentry_ht[dcache_bucket(dentry->parent, dentry->d_hash)]);
+
+	neg = dcache_neg_find(dentry->parent, dentry->name, dentry->d_hash);
+	if (neg) {
+		dcache_neg_free(neg);
+	}
+
 	return 0;
 }
 
@@ -84,43 +167,34 @@ int dvfs_cache_add(struct dentry *dentry) {
  *
  * @return Negative error code
  */
-int dvfs_cache_del(struct dentry *dentry) {
-	char pathname[DVFS_MAX_PATH_LEN];
-	unsigned long long hash;
-	struct hashtable_item *ht_item;
-	if (dentry->name[0] == '\0')
-		return -1;
-	dentry_full_path(dentry, pathname);
-	hash = poly_hash(pathname);
-	if (!(ht_item = hashtable_del(&dentry_ht, (void *) *((size_t *) &hash)))) {
-		printk("Remove empty dentry\n");
+void dvfs_cache_drop_negative(struct dentry *parent) {
+	struct dcache_neg *neg;
+
+	dlist_foreach_entry(neg, &neg_lru, lru_lnk) {
+		if (neg->parent == parent) {
+			dcache_neg_free(neg);
+		}
 	}
-	pool_free(&dentry_ht_pool, ht_item);
-	return 0;
 }
 
-/**
- * @brief Try to get dentry with given path from cache
- *
- * @param path
- *
- * @return
- */
-struct dentry *dvfs_cache_get(char *path, struct lookup *lookup) {
-	unsigned long long hash = poly_hash(path);
-	struct dentry *res;
-	/* TODO local path hash offset */
-	res = hashtable_get(&dentry_ht, (void *) *((size_t *) &hash));
-	return res;
+int dvfs_cache_del(struct dentry *dentry) {
+	if (!dlist_empty(&dentry->d_hash_lnk)) {
+		dlist_del_init(&dentry->d_hash_lnk);
+	}
+
+	/* Dentry memory may be reused for another directory */
+	dvfs_cache_drop_negative(dentry);
+
+	return 0;
 }
 
-struct dentry *dvfs_cache_lookup(const char *path,
-	struct dentry *base) {
-	char full_path[DVFS_MAX_PATH_LEN];
-	dentry_full_path(base, full_path);
-	strncat(full_path, path, DVFS_MAX_PATH_LEN - strlen(path));
+static int dcache_init(void) {
+	int i;
 
-	/* TODO check path from root */
+	for (i = 0; i < DCACHE_HASH_SIZE; i++) {
+		dlist_init(&dentry_ht[i]);
+		dlist_init(&neg_ht[i]);
+	}
 
-	return dvfs_cache_get(full_path, NULL);
+	return 0;
 }
@@ -14,6 +14,7 @@
 #include <util/err.h>
 
 #include <drivers/block_dev.h>
+#include <fs/bcache.h>
 #include <fs/dvfs.h>
 #include <fs/hlpr_path.h>
 #include <kernel/task/resource/vfs.h>
@@ -90,6 +91,7 @@ int dvfs_create_new(const char *name, struct lookup *lookup, int flags) {
 	dentry_fill(sb, new_inode, lookup->item, lookup->parent);
 	strncpy(lookup->item->name, name, DENTRY_NAME_LEN);
 	inode_fill(sb, new_inode, lookup->item);
+	dvfs_cache_add(lookup->item);
 
 	lookup->item->flags |= flags;
 	new_inode->flags |= flags;
@@ -387,6 +389,7 @@ int dvfs_mount(const char *dev, const char *dest, const char *fstype, int flags)
 	if (!strcmp(dest, "/")) {
 		set_rootfs_sb(sb);
 		dvfs_update_root();
+		dvfs_cache_drop_negative(dvfs_root());
 	} else {
 		dvfs_lookup(dest, &lookup);
 
@@ -404,8 +407,11 @@ int dvfs_mount(const char *dev, const char *dest, const char *fstype, int flags)
 
 			dentry_fill(sb, NULL, d, lookup.parent);
 			strcpy(d->name, lookup.item->name);
+			dvfs_cache_add(d);
 		} else {
 			d = lookup.item;
+			/* Names missing in the directory may exist on the new fs */
+			dvfs_cache_drop_negative(d);
 			/* TODO free related inode */
 		}
 		d->flags |= S_IFDIR | DVFS_MOUNT_POINT;
@@ -469,6 +475,7 @@ static int _dentry_destroy(struct dentry *parent, int self_destroy) {
  */
 int dvfs_umount(struct dentry *mpoint) {
 	int err;
+	int virtual;
 	struct super_block *sb;
 
 	sb = mpoint->d_sb;
@@ -480,11 +487,22 @@ int dvfs_umount(struct dentry *mpoint) {
 
 	dentry_ref_dec(mpoint);
 
-	if ((err = _dentry_destroy(mpoint,
-	                           !(mpoint->flags & DVFS_DIR_VIRTUAL))))
+	virtual = mpoint->flags & DVFS_DIR_VIRTUAL;
+
+	if ((err = _dentry_destroy(mpoint, !virtual)))
 		return err;
 
-	return dvfs_destroy_sb(sb);
+	/* Virtual directory stays, names missing on the fs may exist in it */
+	if (virtual)
+		dvfs_cache_drop_negative(mpoint);
+
+	/* Delayed writes of the file system must reach the device */
+	if (sb->bdev)
+		err = bcache_sync(sb->bdev);
+
+	dvfs_destroy_sb(sb);
+
+	return err;
 }
 
 static struct dentry *iterate_virtual(struct lookup *lookup, struct dir_ctx *ctx) {
@@ -512,10 +530,8 @@ static struct dentry *iterate_virtual(struct lookup *lookup, struct dir_ctx *ctx
 
 static int iterate_cached(struct super_block *sb,
 		struct lookup *lookup, struct inode *next_inode) {
-	char full_path[DVFS_MAX_PATH_LEN];
 	struct dentry *cached;
 	struct dentry *next_dentry;
-	int path_end;
 
 	next_dentry = dvfs_alloc_dentry();
 	if (!next_dentry) {
@@ -526,21 +542,14 @@ static int iterate_cached(struct super_block *sb,
 	inode_fill(sb, next_inode, next_dentry);
 	dentry_upd_flags(next_dentry);
 
-	dentry_full_path(lookup->parent, full_path);
-	path_end = strlen(full_path);
-	if (full_path[path_end - 1] != '/') {
-		strcat(full_path, "/");
-		path_end++;
-	}
-	dvfs_pathname(next_inode, full_path + path_end, 0);
-	strncpy(next_dentry->name, full_path + path_end, DENTRY_NAME_LEN);
+	dvfs_pathname(next_inode, next_dentry->name, 0);
 	lookup->item = next_dentry;
 
-	if ((cached = dvfs_cache_get(full_path, lookup))) {
+	cached = dvfs_cache_get(lookup->parent, next_dentry->name);
+	if (cached && cached != next_dentry) {
 		dvfs_destroy_dentry(next_dentry);
 		lookup->item = cached;
 	} else {
-		dvfs_pathname(next_inode, next_dentry->name, 0);
 		dvfs_cache_add(next_dentry);
 	}
 	return 0;
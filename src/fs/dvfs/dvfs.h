@@ -107,6 +107,9 @@ struct dentry {
 
 	struct dlist_head d_lnk;   /* List for all dentries in system */
 
+	struct dlist_head d_hash_lnk; /* Link in dentry cache bucket */
+	unsigned int d_hash;          /* Hash of @a name */
+
 	struct dentry_operations *d_ops;
 };
 
@@ -141,8 +144,13 @@ struct file_operations {
 	int    (*ioctl)(struct file *desc, int request, void *data);
 };
 
+/* Names of the file system appear without going through dvfs (devfs nodes
+ * are registered by drivers), so failed lookups must not be cached */
+#define DVFS_DRV_NO_NEGATIVE 0x1
+
 struct dumb_fs_driver {
 	const char name[FS_NAME_LEN];
+	int flags;
 	int (*format)(void *dev, void *priv);
 	int (*fill_sb)(struct super_block *sb, struct file *dev);
 	int (*mount_end)(struct super_block *sb);
@@ -202,8 +210,13 @@ extern int dvfs_create_new(const char *name, struct lookup *lookup, int flags);
 extern int dvfs_rename(struct dentry *from, struct dentry *to);
 
 /* dcache-related stuff */
-extern struct dentry *dvfs_cache_lookup(const char *path, struct dentry *base);
-extern struct dentry *dvfs_cache_get(char *path, struct lookup *lookup);
+/* Child of @a parent with given name if it's in memory, NULL otherwise */
+extern struct dentry *dvfs_cache_get(struct dentry *parent, const char *name);
+/* Non-zero if @a parent is known to have no child with given name */
+extern int dvfs_cache_negative(struct dentry *parent, const char *name);
+extern void dvfs_cache_add_negative(struct dentry *parent, const char *name);
+/* Forget names known to be missing in @a parent, e.g. when it is mounted on */
+extern void dvfs_cache_drop_negative(struct dentry *parent);
 extern int dvfs_cache_del(struct dentry *dentry);
 extern int dvfs_cache_add(struct dentry *dentry);
 
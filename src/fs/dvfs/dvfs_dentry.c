@@ -58,7 +58,6 @@ int dentry_full_path(struct dentry *dentry, char *buf) {
 
 extern int dentry_fill(struct super_block *, struct inode *,
                        struct dentry *, struct dentry *);
-extern struct dentry *local_lookup(struct dentry *parent, char *name);
 
 /**
  * @brief Get the length of next element int the path
@@ -112,7 +111,7 @@ int dvfs_path_walk(const char *path, struct dentry *parent, struct lookup *looku
 	if (!FILE_TYPE(parent->flags, S_IFDIR))
 		return -ENOTDIR;
 
-	if ((d = local_lookup(parent, buff)))
+	if ((d = dvfs_cache_get(parent, buff)))
 		return dvfs_path_walk(path + strlen(buff), d, lookup);
 
 	if (strlen(buff) > 1 && path_is_double_dot(buff))
@@ -121,12 +120,18 @@ int dvfs_path_walk(const char *path, struct dentry *parent, struct lookup *looku
 	if (strlen(buff) > 1 && path_is_single_dot(buff))
 		return dvfs_path_walk(path + 2, parent, lookup);
 
-	/* TODO use cache instead */
 	assert(parent->d_sb);
 	assert(parent->d_sb->sb_iops);
 	assert(parent->d_sb->sb_iops->lookup);
 
-	if (!(in = parent->d_sb->sb_iops->lookup(buff, parent))) {
+	if (dvfs_cache_negative(parent, buff)) {
+		in = NULL;
+	} else if (!(in = parent->d_sb->sb_iops->lookup(buff, parent))) {
+		if (!(parent->d_sb->fs_drv->flags & DVFS_DRV_NO_NEGATIVE))
+			dvfs_cache_add_negative(parent, buff);
+	}
+
+	if (!in) {
 		*lookup = (struct lookup) {
 			.item   = NULL,
 			.parent = parent,
@@ -139,6 +144,7 @@ int dvfs_path_walk(const char *path, struct dentry *parent, struct lookup *looku
 		dentry_fill(parent->d_sb, in, d, parent);
 		strcpy(d->name, buff);
 		d->flags = in->flags;
+		dvfs_cache_add(d);
 	}
 
 	return dvfs_path_walk(path + strlen(buff), in->i_dentry, lookup);
@@ -157,8 +163,6 @@ int dvfs_path_walk(const char *path, struct dentry *parent, struct lookup *looku
  */
 int dvfs_lookup(const char *path, struct lookup *lookup) {
 	struct dentry *dentry;
-	struct dentry *res;
-	int errcode;
 
 	if (*path == '/') {
 		dentry = task_fs()->root;
@@ -181,17 +185,5 @@ int dvfs_lookup(const char *path, struct lookup *lookup) {
 
 	/* TODO preprocess path ? Delete "/../" */
 
-	if ((res = dvfs_cache_lookup(path, dentry))) {
-		*lookup = (struct lookup) {
-			.item = res,
-			.parent = res->parent,
-		};
-		return 0;
-	}
-
-	errcode = dvfs_path_walk(path, dentry, lookup);
-	if (!errcode)
-		dvfs_cache_add(lookup->item);
-
-	return errcode;
+	return dvfs_path_walk(path, dentry, lookup);
 }
@@ -149,6 +149,7 @@ struct dentry *dvfs_alloc_dentry(void) {
 	memset(dentry, 0, sizeof(struct dentry));
 	dlist_add_next(&dentry->d_lnk, &dentry_dlist);
 	dlist_init(&dentry->children);
+	dlist_head_init(&dentry->d_hash_lnk);
 	return dentry;
 }
 
@@ -227,7 +228,8 @@ int dentry_fill(struct super_block *sb, struct inode *inode,
 		.d_sb    = sb,
 		.d_ops   = sb ? sb->sb_dops : NULL,
 		.parent  = parent,
-		.d_lnk   = dentry->d_lnk
+		.d_lnk   = dentry->d_lnk,
+		.d_hash_lnk = dentry->d_hash_lnk
 	};
 
 	inode->i_dentry = dentry;
@@ -276,7 +278,8 @@ int dvfs_update_root(void) {
 		.name        = "/",
 		.flags       = S_IFDIR | DVFS_DIR_VIRTUAL | DVFS_MOUNT_POINT,
 		.usage_count = 1,
-		.d_lnk       = global_root->d_lnk
+		.d_lnk       = global_root->d_lnk,
+		.d_hash_lnk  = global_root->d_hash_lnk
 	};
 
 	if (global_root->d_inode)
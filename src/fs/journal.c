@@ -12,7 +12,7 @@
 #include <string.h>
 #include <arpa/inet.h>
 #include <mem/misc/slab.h>
-#include <mem/sysmalloc.h>
+#include <mem/kmalloc.h>
 #include <fs/journal.h>
 #include <fs/bcache.h>
 
@@ -227,8 +227,7 @@ journal_block_t *journal_new_block(journal_t *jp, block_t nr) {
     	return NULL;
     }
 
-    /* TODO use kmalloc instead */
-    if (!(jb->data = sysmalloc(jp->j_blocksize))) {
+    if (!(jb->data = kmalloc(jp->j_blocksize))) {
     	cache_free(&journal_block_cache, jb);
 		return NULL;
     }
@@ -241,7 +240,7 @@ journal_block_t *journal_new_block(journal_t *jp, block_t nr) {
 void journal_free_block(journal_t *jp, journal_block_t *jb) {
 	assert(jp && jb);
 
-	sysfree(jb->data);
+	kfree(jb->data);
 	cache_free(&journal_block_cache, jb);
 }
 
@@ -11,15 +11,19 @@
 
 #include <fs/buffer_head.h>
 
-static inline void bcache_buffer_lock(struct buffer_head *bh) {
-	mutex_lock(&bh->mutex);
-	bh->lock_count++;
-}
+/**
+ * Buffer cache statistics
+ */
+struct bcache_stat {
+	unsigned long hits;       /* Block was found in the cache */
+	unsigned long misses;     /* Block was not cached and buffer was allocated */
+	unsigned long evictions;  /* Buffer was reclaimed for another block */
+	unsigned long writebacks; /* Dirty buffer was written to the device */
+	unsigned int dirty;       /* Amount of buffers waiting for writeback */
+};
 
-static inline void bcache_buffer_unlock(struct buffer_head *bh) {
-	bh->lock_count--;
-	mutex_unlock(&bh->mutex);
-}
+extern void bcache_buffer_lock(struct buffer_head *bh);
+extern void bcache_buffer_unlock(struct buffer_head *bh);
 
 /**
  * @return
@@ -28,4 +32,28 @@ static inline void bcache_buffer_unlock(struct buffer_head *bh) {
  */
 extern struct buffer_head *bcache_getblk_locked(struct block_dev *bdev, int block, size_t size);
 
+/**
+ * @brief Mark locked buffer as modified
+ *
+ * The buffer is written to the device later by the writeback thread (or
+ * immediately if writeback is disabled).
+ *
+ * @return 0 on success or negative error code of write-through
+ */
+extern int bcache_mark_dirty(struct buffer_head *bh);
+
+/**
+ * @brief Write all dirty buffers of @a bdev (of all devices if NULL)
+ *
+ * @return 0 on success or negative error code of the first failed write
+ */
+extern int bcache_sync(struct block_dev *bdev);
+
+/**
+ * @brief Write back and drop all unlocked buffers of @a bdev
+ */
+extern void bcache_invalidate(struct block_dev *bdev);
+
+extern void bcache_get_stat(struct bcache_stat *stat);
+
 #endif /* FS_BCACHE_H_ */
@@ -9,6 +9,7 @@
 #ifndef FS_BUFFER_HEAD_H_
 #define FS_BUFFER_HEAD_H_
 
+#include <time.h>
 #include <util/dlist.h>
 #include <kernel/thread/sync/mutex.h>
 #include <drivers/block_dev.h>
@@ -35,9 +36,13 @@ struct buffer_head {
 	size_t blocksize;               /* size of mapping */
 	int flags;                      /* buffer state bitmap */
 	struct mutex mutex;             /* synchronizes concurrent access to block */
-	struct dlist_head bh_next;      /* link to global list of buffer_heads */
+	struct dlist_head bh_next;      /* link to global LRU list of buffer_heads */
+	struct dlist_head hash_lnk;     /* link to bucket of buffer cache hash table */
+	struct dlist_head dirty_lnk;    /* link to list of dirty buffers waiting for writeback */
 	char *data;                     /* pointer to block's data */
 	int lock_count;			/* lock count to support multiplie locks */
+	int users;                      /* holders and waiters of buffer lock, buffer can't be evicted if nonzero */
+	clock_t dirty_time;             /* the time when buffer became dirty */
 	/*
 	 * XXX Seems it is not better solution to have back reference to journal.
 	 */
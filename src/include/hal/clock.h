@@ -34,6 +34,12 @@ extern void clock_setup(useconds_t useconds);
 
 extern void clock_tick_handler(int irq_num, void *dev_id);
 
+/**
+ * Accounts ticks which passed without tick interrupts, e.g. while the event
+ * device of jiffies was stopped in idle. Called with interrupts disabled.
+ */
+extern void clock_tick_catch_up(clock_t ticks);
+
 extern clock_t clock_sys_ticks(void);
 extern uint32_t clock_freq(void);
 extern clock_t clock_sys_sec(void);
@@ -36,6 +36,13 @@ __BEGIN_DECLS
  */
 extern unsigned int cpu_get_id(void);
 
+#ifdef SMP
+/**
+ * Make CPU @a cpu_id reschedule (inter-processor interrupt)
+ */
+extern void smp_send_resched(int cpu_id);
+#endif /* SMP */
+
 __END_DECLS
 
 #endif /* !__ASSEMBLER__ */
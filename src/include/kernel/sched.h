@@ -45,6 +45,7 @@
  *                others can set it to a non-zero during wake up
  *   s->waiting - current can change it from zero to a non-zero with no locks,
  *                others access it with s->lock held and interrupts off
+ *   s->cpu     - changed only with the runq of the previous value locked
  */
 struct schedee {
 	runq_item_t       runq_link;
@@ -67,6 +68,8 @@ struct schedee {
 	unsigned int ready;   /**< Managed by the scheduler. */
 	unsigned int waiting; /**< Waiting for an event. */
 
+	unsigned int cpu;     /**< Last CPU, its runq protects 'ready'. */
+
 	struct affinity         affinity;
 	struct sched_timing     sched_timing;
 	struct schedee_priority priority;
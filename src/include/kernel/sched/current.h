@@ -33,4 +33,7 @@
 #define schedee_set_current(schedee) \
 	__schedee_set_current(schedee)
 
+#define schedee_get_cpu_current(cpu_id) \
+	__schedee_get_cpu_current(cpu_id)
+
 #endif /* KERNEL_SCHEDEE_CURRENT_H_ */
@@ -16,6 +16,7 @@ struct schedee;
 extern void runq_init(runq_t *queue);
 extern void runq_insert(runq_t *queue, struct schedee *schedee);
 extern void runq_remove(runq_t *queue, struct schedee *schedee);
+/* Returns NULL if there is no schedee which can run on the current CPU. */
 extern struct schedee *runq_extract(runq_t *queue);
 
 extern void runq_item_init(runq_item_t *runq_link);
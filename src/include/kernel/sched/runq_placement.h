@@ -0,0 +1,25 @@
+/**
+ * @file
+ * @brief Placement of schedees among scheduler runqs.
+ *
+ * @date 17.10.2026
+ */
+
+#ifndef SCHED_RUNQ_PLACEMENT_H_
+#define SCHED_RUNQ_PLACEMENT_H_
+
+#include <module/embox/kernel/sched/strategy/placement/api.h>
+
+struct schedee;
+
+/**
+ * Chooses a CPU which runq the woken up @p s is queued to.
+ */
+extern unsigned int sched_rq_select(struct schedee *s);
+
+/**
+ * Checks whether queued @p s can preempt the current schedee of @p cpu.
+ */
+extern int sched_rq_may_run(struct schedee *s, unsigned int cpu);
+
+#endif /* SCHED_RUNQ_PLACEMENT_H_ */
@@ -221,6 +221,12 @@ extern int thread_launch(struct thread *thread);
 
 extern void thread_delete(struct thread *t);
 
+/**
+ * Returns objects cached by malloc() for @a t to the heap of its task.
+ * Called on thread deletion, does nothing if malloc() has no thread caches.
+ */
+extern void thread_malloc_cache_free(struct thread *t);
+
 extern void thread_set_run_arg(struct thread *t, void *run_arg);
 
 /**
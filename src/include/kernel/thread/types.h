@@ -25,6 +25,7 @@
 #include <util/dlist.h>
 
 struct task;
+struct malloc_cache;
 
 /* Resource mgmt flags. */
 #define TS_INIT         (0x0)
@@ -63,6 +64,7 @@ struct thread {
 	struct sigstate    sigstate;     /**< Pending signal(s). */
 
 	thread_local_t     local;
+	struct malloc_cache *malloc_cache; /**< Small objects cache of malloc() */
 	thread_cancel_t    cleanups;
 
 	struct thread_wait thread_wait;
@@ -0,0 +1,29 @@
+/**
+ * @file
+ * @brief Stopping of periodic tick while CPU is idle.
+ *
+ * @date 17.10.2026
+ */
+
+#ifndef KERNEL_TIME_TICK_IDLE_H_
+#define KERNEL_TIME_TICK_IDLE_H_
+
+#include <module/embox/kernel/time/tick_idle.h>
+
+/**
+ * Reprograms jiffies event device to fire at the nearest timer deadline.
+ * Called by idle right before CPU is halted.
+ */
+extern void tick_idle_enter(void);
+
+/**
+ * Accounts ticks passed in idle and restores periodic tick. Also called when
+ * a timer is started, as its deadline may be nearer than the programmed one,
+ * and when the scheduler switches away from idle.
+ */
+extern void tick_idle_exit(void);
+
+/** @return total number of tick interrupts avoided in idle */
+extern unsigned long tick_idle_elided(void);
+
+#endif /* KERNEL_TIME_TICK_IDLE_H_ */
@@ -12,6 +12,9 @@
 #include <stdint.h>
 #include <kernel/time/time.h>
 
+/** Whole event period for time_event_device.oneshot_elapsed() */
+#define TIME_EVENT_FRAC_ONE 0x10000
+
 struct time_dev_conf {
 	enum {
 		HW_TIMER_PERIOD,
@@ -35,6 +38,12 @@ struct time_dev_conf {
  * @param set_mode - set mode function.
  * @resolution - number of events per second.
  * @name - name of device
+ * @param oneshot_elapsed - optional, number of events periods passed since
+ *   the device was configured as HW_TIMER_ONESHOOT. Part of the next period
+ *   which has passed as well is stored in @a frac, in units of
+ *   1 / TIME_EVENT_FRAC_ONE of a period. For such mode config() takes the
+ *   number of periods to wait in event_period and stores there the value it
+ *   has really programmed.
  */
 struct time_event_device {
 	void (*event_handler)(void);
@@ -42,6 +51,7 @@ struct time_event_device {
 	uint32_t event_hz;
 	uint32_t irq_nr;
 	int (*pending) (unsigned int nr);
+	int (*oneshot_elapsed)(unsigned int *frac);
 	const char *name;
 };
 
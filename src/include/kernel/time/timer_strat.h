@@ -9,9 +9,15 @@
 
 #ifndef TIMER_STRAT_H_
 #define TIMER_STRAT_H_
+
+#include <sys/types.h>
+
 struct sys_timer;
 #include <module/embox/kernel/timer/strategy/api.h>
 
+/** Returned by timer_strat_get_next_event() when no timer is armed. */
+#define TIMER_STRAT_NO_EVENT ((clock_t) -1)
+
 /********
  * timer_strat
  */
@@ -21,4 +27,10 @@ extern void timer_strat_stop(struct sys_timer *ptimer);
 
 extern void timer_strat_start(struct sys_timer *ptimer);
 
+/**
+ * @return number of timer_strat_sched() calls after which the nearest timer
+ * expires (the strategy may underestimate it), or #TIMER_STRAT_NO_EVENT
+ */
+extern clock_t timer_strat_get_next_event(void);
+
 #endif /* TIMER_STRAT_H_ */
@@ -14,5 +14,9 @@
 extern void bm_init(void *segment, size_t size);
 extern void *bm_memalign(void *segment, size_t boundary, size_t size);
 extern void bm_free(void *segment, void *ptr);
+/* Size of memory available in allocated block @a ptr */
+extern size_t bm_usable_size(void *ptr);
+/* Appends memory following @a segment of @a size bytes up to @a new_size */
+extern int bm_extend(void *segment, size_t size, size_t new_size);
 
 #endif /* MEM_HEAP_BM_H_ */
@@ -0,0 +1,25 @@
+/**
+ * @file
+ * @brief Two-level segregated fit (TLSF) memory allocation algorithm
+ *
+ * @details Allocation and free take bounded time which doesn't depend on
+ * heap fragmentation. Interface is the same as of boundary markers.
+ *
+ * @date 17.10.2026
+ */
+
+#ifndef MEM_HEAP_TLSF_H_
+#define MEM_HEAP_TLSF_H_
+
+#include <sys/types.h>
+
+extern void tlsf_init(void *segment, size_t size);
+extern void *tlsf_memalign(void *segment, size_t boundary, size_t size);
+extern void tlsf_free(void *segment, void *ptr);
+/* Size of memory available in allocated block @a ptr */
+extern size_t tlsf_usable_size(void *ptr);
+/* Appends memory following @a segment of @a size bytes up to @a new_size.
+ * Returns -1 if the segment can't grow so much. */
+extern int tlsf_extend(void *segment, size_t size, size_t new_size);
+
+#endif /* MEM_HEAP_TLSF_H_ */
@@ -0,0 +1,29 @@
+/**
+ * @file
+ * @brief Kernel allocator of small blocks
+ *
+ * @details Implementation is selected with embox.mem.kmalloc_api. It may
+ * serve blocks from power of two slab caches, in this case blocks are
+ * allocated without fragmentation of the heap.
+ *
+ * @date 17.10.2026
+ */
+
+#ifndef MEM_KMALLOC_H_
+#define MEM_KMALLOC_H_
+
+#include <stddef.h>
+
+/**
+ * Allocate block of at least @a size bytes
+ * @return pointer to the block or NULL if there is no memory
+ */
+extern void *kmalloc(size_t size);
+
+/**
+ * Free block allocated with kmalloc()
+ * @param ptr is pointer to the block, may be NULL
+ */
+extern void kfree(void *ptr);
+
+#endif /* MEM_KMALLOC_H_ */
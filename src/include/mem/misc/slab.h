@@ -73,8 +73,16 @@ extern void *cache_alloc(cache_t *cachep);
  */
 extern void cache_free(cache_t *cachep, void* objp);
 
+/**
+ * Find cache which object was allocated from
+ * @param objp is pointer to object
+ * @return cache or NULL if @a objp is not slab memory
+ */
+extern cache_t *cache_of(void *objp);
+
 /**
  * Remove all free slabs from cache
+ * Objects in magazines of other CPUs are not returned to slabs
  * will be used in feature
  * @param cachep is pointer to cache which need to shrink
  * @return number of removed slabs
@@ -95,4 +103,31 @@ static inline void cache_growing_off(cache_t *cache) {
 	cache->growing = false;
 }
 
+/** Statistics of cache */
+struct cache_stats {
+	char name[__CACHE_NAMELEN];
+	size_t obj_size;
+	unsigned int obj_per_slab;
+	unsigned int slab_order;
+	unsigned int slabs_full;
+	unsigned int slabs_partial;
+	unsigned int slabs_free;
+	/** objects given out to users */
+	unsigned int objs_active;
+	/** objects kept in per-CPU magazines */
+	unsigned int objs_cached;
+	unsigned long allocs;
+	unsigned long frees;
+	/** allocations served from per-CPU magazines */
+	unsigned long hits;
+};
+
+/**
+ * Get statistics of all caches
+ * @param stats is array to fill
+ * @param n is length of @a stats
+ * @return number of caches, may be greater than @a n
+ */
+extern int cache_stats_get(struct cache_stats *stats, int n);
+
 #endif /* MEM_MISC_SLAB_H_ */
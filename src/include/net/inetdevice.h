@@ -85,6 +85,12 @@ extern int inetdev_set_bcast(struct in_device *in_dev, in_addr_t bcast);
  */
 extern in_addr_t inetdev_get_addr(struct in_device *in_dev);
 
+/**
+ * Get counter which changes with IP address of any interface, so values
+ * derived from addresses can be cached
+ */
+extern unsigned int inetdev_get_addr_gen(void);
+
 /* iterator functions */
 extern struct in_device * inetdev_get_first(void);
 extern struct in_device * inetdev_get_next(struct in_device *in_dev);
@@ -17,4 +17,19 @@
  */
 extern int netif_rx(void *pack);
 
+struct net_device;
+struct sk_buff;
+
+/**
+ * Schedule @a dev for polling, called from interrupt handler of driver
+ * which implements net_driver::poll with RX interrupt masked
+ */
+extern void netif_poll_schedule(struct net_device *dev);
+
+/**
+ * Pass packet to the stack from net_driver::poll, packets are handled
+ * in one batch after poll returns
+ */
+extern int netif_receive_skb(struct sk_buff *skb);
+
 #endif /* NET_L0_NET_ENTRY_ */
@@ -17,4 +17,12 @@
  */
 extern int net_rx(struct sk_buff *skb);
 
+/**
+ * Handle all packages of @a skbs (the queue is emptied). L3 handler lookup
+ * is shared by consecutive packages of one type and sockets are notified
+ * once per call
+ * @return amount of handled packages
+ */
+extern int net_rx_list(struct sk_buff_head *skbs);
+
 #endif /* NET_L0_NET_RX_ */
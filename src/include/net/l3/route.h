@@ -17,6 +17,9 @@
 #include <net/netdevice.h>
 
 struct net_device;
+struct in_device;
+struct sock;
+struct neighbour_cache;
 
 /**
  * Routing table entry.
@@ -86,6 +89,13 @@ extern int ip_route(sk_buff_t *skb, struct net_device *wanna_dev,
  */
 extern int rt_fib_route_ip(in_addr_t source_addr, in_addr_t *new_addr);
 
+/**
+ * Same as rt_fib_route_ip() but also gives the neighbour cache of the
+ * gateway when the next machine is a gateway (NULL otherwise)
+ */
+extern int rt_fib_route_ip_cached(in_addr_t dst_ip, in_addr_t *next_ip,
+		struct neighbour_cache **out_nc);
+
 /**
  * Get IP address of local interface from which packet would be sent
  * After this new_addr will be equal to interface address
@@ -107,6 +117,28 @@ extern int rt_fib_out_dev(in_addr_t dst, const struct sock *sk,
  */
 extern struct rt_entry* rt_fib_get_best(in_addr_t dst, struct net_device *out_dev);
 
+/**
+ * Output route remembered by a socket for its peer. It is valid while the
+ * routing table, interface addresses, destination and SO_BINDTODEVICE are
+ * the same.
+ */
+struct rt_cache {
+	unsigned int gen;
+	unsigned int addr_gen;
+	in_addr_t dst;
+	struct net_device *wanna_dev;
+	struct net_device *dev;
+	in_addr_t src;
+};
+
+/**
+ * Same as rt_fib_out_dev() followed by rt_fib_source_ip() but looks up the
+ * table only if @a rtc doesn't hold the answer already.
+ */
+extern int rt_fib_out_cached(struct rt_cache *rtc, in_addr_t dst,
+		const struct sock *sk, struct net_device **out_dev,
+		in_addr_t *out_src);
+
 /**
  * Get first element from route from table.
  * @return pointer to first entity
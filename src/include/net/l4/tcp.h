@@ -17,6 +17,7 @@
 
 #include <linux/types.h>
 #include <linux/list.h>
+#include <kernel/time/timer.h>
 #include <net/socket/inet_sock.h>
 #include <net/socket/inet6_sock.h>
 
@@ -102,8 +103,12 @@ typedef struct tcp_sock {
 	unsigned int free_wait_queue_max; /* Maximum @a conn_wait length plus @a conn_free length */
 	unsigned int lock;          /* Tool for synchronization */
 	struct timeval syn_time;    /* The time when synchronization started */
-	struct timeval ack_time;    /* The time when message was ACKed */
-	struct timeval rcv_time;    /* The time when last message was received (ONLY FOR TCP_TIMEWAIT) */
+	struct sys_timer tmr;       /* Retransmission or TIME-WAIT timer */
+	uint32_t srtt;              /* Smoothed round-trip time (msec << 3) */
+	uint32_t rttvar;            /* Round-trip time variation (msec << 2) */
+	uint32_t rto;               /* Retransmission timeout in msec */
+	uint32_t rtt_seq;           /* Sequence number which ACK ends RTT measurement */
+	struct timeval rtt_time;    /* The time when RTT measurement started (clear if none) */
 	unsigned int dup_ack;       /* Amount of duplicated packets */
 	unsigned int rexmit_mode;   /* Socket in rexmit mode */
 } tcp_sock_t;
@@ -122,10 +127,11 @@ enum {
 };
 
 /* Delays in milliseconds */
-#define TCP_TIMER_FREQUENCY   1000  /* Frequency for tcp_tmr_default */
 #define TCP_TIMEWAIT_DELAY    2000  /* Delay for TIME-WAIT state */
-#define TCP_REXMIT_DELAY      2000  /* Delay between rexmitting */
 #define TCP_SYNC_TIMEOUT      5000  /* Synchronization timeout */
+#define TCP_RTO_INIT          1000  /* Retransmission timeout before first RTT sample */
+#define TCP_RTO_MIN            200  /* Lower bound of retransmission timeout */
+#define TCP_RTO_MAX          60000  /* Upper bound of retransmission timeout */
 
 #define TCP_REXMIT_DUP_ACK       5  /* Rexmit after n duplicate ack */
 
@@ -153,6 +159,7 @@ extern const struct sock_proto_ops *const tcp_sock_ops __attribute__((weak));
 
 /* Others functionality */
 extern void tcp_sock_release(struct tcp_sock *tcp_sk);
+extern void tcp_timer_init(struct tcp_sock *tcp_sk);
 extern void tcp_sock_set_state(struct tcp_sock *tcp_sk,
 		enum tcp_sock_state new_state);
 extern void tcp_seq_state_set_wind_value(struct tcp_seq_state *tcp_seq_st,
@@ -11,13 +11,16 @@
 
 #include <net/netdevice.h>
 #include <time.h>
+#include <kernel/time/timer.h>
 #include <util/dlist.h>
 
 /**
  * Neighbour entity
  */
 struct neighbour {
-	struct dlist_head lnk;             /* lnk */
+	struct dlist_head lnk;             /* lnk in LRU order */
+	struct dlist_head p_lnk;           /* lnk in hash by protocol address */
+	struct dlist_head h_lnk;           /* lnk in hash by hw address */
 	unsigned short ptype;              /* protocol */
 	unsigned char paddr[MAX_ADDR_LEN]; /* protocol address */
 	unsigned char plen;                /* protocol address len  */
@@ -28,11 +31,21 @@ struct neighbour {
 	unsigned char hlen;                /* hw address len */
 	unsigned int flags;                /* flags */
 	struct sk_buff_head w_queue;       /* waiting queue */
-	unsigned long expire;              /* lifetime */
-	unsigned long resend;              /* resend timeout */
+	unsigned int w_queue_len;          /* waiting queue length */
+	struct sys_timer tmr;              /* expiration or resend timer */
+	unsigned int gen;                  /* changes when entity is freed */
 	unsigned int sent_times;           /* how much times request was sent */
 };
 
+/**
+ * Neighbour remembered by a route or a socket. It is valid while the
+ * entity is not freed, so the lookup is skipped on the hot path.
+ */
+struct neighbour_cache {
+	struct neighbour *nbr;
+	unsigned int gen;
+};
+
 /**
  * Neighbour flags
  */
@@ -52,6 +65,15 @@ extern int neighbour_get_haddr(unsigned short ptype,
 		unsigned short htype, unsigned char hlen_max,
 		void *out_haddr);
 
+/**
+ * Same as neighbour_get_haddr() but looks up the table only if @a nc
+ * doesn't hold the answer already. @a nc is updated on success.
+ */
+extern int neighbour_get_haddr_cached(struct neighbour_cache *nc,
+		unsigned short ptype, const void *paddr, struct net_device *dev,
+		unsigned short htype, unsigned char hlen_max,
+		void *out_haddr);
+
 extern int neighbour_get_paddr(unsigned short htype,
 		const void *haddr, struct net_device *dev,
 		unsigned short ptype, unsigned char plen_max,
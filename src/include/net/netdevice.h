@@ -75,6 +75,10 @@ typedef struct net_driver {
 	int (*stop)(struct net_device *dev);
 	int (*xmit)(struct net_device *dev, struct sk_buff *skb);
 	int (*set_macaddr)(struct net_device *dev, const void *addr);
+	/* Receive up to @a budget packets with netif_receive_skb(). Drivers
+	 * with poll mask RX interrupt and call netif_poll_schedule() from
+	 * handler, poll unmasks it when returns less than @a budget */
+	int (*poll)(struct net_device *dev, int budget);
 } net_driver_t;
 
 
@@ -92,6 +96,8 @@ struct net_header_info {
 							used for discovering of the
 							hw address in case dst_hw is null */
 	unsigned char p_len; /* length of dst_p */
+	struct neighbour_cache *nbr_cache; /* optional cache for
+							resolving of dst_p */
 };
 
 /**
@@ -10,6 +10,7 @@
 #define NET_NETFILTER_H_
 
 #include <net/l2/ethernet.h>
+#include <net/nf_conntrack.h>
 #include <net/skbuff.h>
 #include <netinet/in.h>
 #include <util/dlist.h>
@@ -77,8 +78,11 @@ struct nf_rule {
 	NF_DECL_NOT_FIELD(proto, enum nf_proto);
 	NF_DECL_NOT_FIELD(sport, in_port_t);
 	NF_DECL_NOT_FIELD(dport, in_port_t);
+	NF_DECL_NOT_FIELD(ctstate, unsigned int); /* Mask of NF_CT_* */
 	nf_test_hnd test_hnd;
 	void *test_hnd_data;
+	unsigned long pkts;  /* Packets matched by the rule */
+	unsigned long bytes; /* Bytes matched by the rule */
 };
 
 /**
@@ -145,6 +149,20 @@ extern int nf_set_rule(int chain, const struct nf_rule *r,
 		size_t r_num);
 extern int nf_del_rule(int chain, size_t r_num);
 extern int nf_clear(int chain);
+
+/**
+ * @brief Look up the first rule of @a chain matching @a test_r
+ *
+ * Rules are not walked one by one: every change of a chain compiles it
+ * into a classifier hashed on destination port, destination and source
+ * address, and the compiled set replaces the previous one atomically.
+ * Counters of the matched rule are updated. If the chain starts with
+ * a rule matching connection state only, packets of that state are
+ * decided without the lookup.
+ *
+ * @return 0 if the verdict is @a test_r->target
+ * @return not zero otherwise, -EINVAL on invalid arguments
+ */
 extern int nf_test_rule(int chain, const struct nf_rule *test_r);
 extern int nf_test_skb(int chain, enum nf_target target,
 		const struct sk_buff *test_skb);
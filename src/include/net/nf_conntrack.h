@@ -0,0 +1,42 @@
+/**
+ * @file
+ * @brief Connection tracking for netfilter
+ *
+ * @date 17.10.2026
+ */
+
+#ifndef NET_NF_CONNTRACK_H_
+#define NET_NF_CONNTRACK_H_
+
+struct sk_buff;
+
+/**
+ * Connection states of a packet (may be combined into a mask)
+ */
+enum {
+	NF_CT_INVALID     = 0x1, /* Packet belongs to no known connection */
+	NF_CT_NEW         = 0x2, /* Packet starts a connection */
+	NF_CT_ESTABLISHED = 0x4, /* Connection has seen packets in both directions */
+	NF_CT_RELATED     = 0x8  /* ICMP error about a known connection */
+};
+
+/**
+ * Convertion between connection state and string
+ */
+extern unsigned int nf_ct_state_get_by_name(const char *state_name);
+extern const char *nf_ct_state_to_str(unsigned int state);
+
+/**
+ * @brief Track IPv4 packet
+ *
+ * Finds (or creates for the first packet) the connection of @a skb,
+ * advances its protocol state and refreshes its timeout. Repeated calls
+ * for the same packet (e.g. for INPUT and FORWARD chains) are harmless.
+ * Fragmented datagrams must be reassembled first, a fragment with non-zero
+ * offset is #NF_CT_INVALID.
+ *
+ * @return connection state of the packet, one of NF_CT_*
+ */
+extern unsigned int nf_conntrack_in(const struct sk_buff *skb);
+
+#endif /* NET_NF_CONNTRACK_H_ */
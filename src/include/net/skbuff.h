@@ -29,6 +29,15 @@ struct arphdr;
 struct ethhdr;
 struct iovec;
 
+/* Counters of a per-CPU allocation cache */
+struct skb_alloc_stat {
+	unsigned long alloc;        /* Objects taken from the cache */
+	unsigned long free;         /* Objects returned to the cache */
+	unsigned long remote_free;  /* ...of them allocated on another CPU */
+	unsigned long refill;       /* Batches taken from the shared pool */
+	unsigned long flush;        /* Batches returned to the shared pool */
+};
+
 typedef struct sk_buff_head {
 	struct sk_buff *next;       /* Next buffer in list */
 	struct sk_buff *prev;       /* Previous buffer in list */
@@ -41,6 +50,7 @@ typedef struct sk_buff {        /* Socket buffer */
 	struct net_device *dev;     /* Device we arrived on/are leaving by */
 	struct pool *pl;	/* Local net driver pool pointer. Zero if default.
 				   Probably, should be joined with *dev field */
+	unsigned int cpu;           /* CPU the skb was allocated on */
 
 		/* Control buffer (used to store layer-specific info e.g. ip options)
 		 * Nowdays it's used only in ip options, so it's a good idea to
@@ -91,10 +101,11 @@ typedef struct sk_buff {        /* Socket buffer */
 	unsigned char *p_data;
 	unsigned char *p_data_end;
 
-	struct timeval tstamp;
+	struct timeval tstamp;      /* Set lazily, see skb_timestamp() */
 } sk_buff_t;
 
 extern size_t skb_max_size(void);
+extern size_t skb_data_size(const struct sk_buff_data *skb_data);
 extern size_t skb_extra_max_size(void);
 
 extern void * skb_data_cast_in(struct sk_buff_data *skb_data);
@@ -130,6 +141,11 @@ extern struct sk_buff * skb_wrap_local(size_t size,
 extern struct sk_buff * skb_alloc(size_t size);
 extern struct sk_buff * skb_alloc_local(size_t size, struct pool *pl);
 extern struct sk_buff * skb_alloc_dynamic(size_t size);
+/**
+ * Reuses @a skb for a packet of @a size bytes, allocates a new one if @a skb
+ * is NULL. On failure @a skb is freed, so callers may overwrite their only
+ * reference with the result.
+ */
 extern struct sk_buff * skb_realloc(size_t size, struct sk_buff *skb);
 
 /**
@@ -137,6 +153,21 @@ extern struct sk_buff * skb_realloc(size_t size, struct sk_buff *skb);
  */
 extern void skb_free(struct sk_buff *skb);
 
+/**
+ * Set receive time of @a skb if it isn't set yet. Packets aren't stamped
+ * on allocation, consumers of the time must call this.
+ */
+extern void skb_timestamp(struct sk_buff *skb);
+
+/**
+ * Get counters of per-CPU sk_buff (and sk_buff_data) caches
+ *
+ * @return 0 on success, -EINVAL if @a cpu is out of range
+ */
+extern int skb_alloc_stat_get(unsigned int cpu, struct skb_alloc_stat *stat);
+extern int skb_data_alloc_stat_get(unsigned int cpu,
+		struct skb_alloc_stat *stat);
+
 /**
  * Perform right shift on skb data
  * @skb: buffer to process
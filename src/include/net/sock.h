@@ -30,6 +30,7 @@ struct sock_family_ops;
 struct sock_proto_ops;
 struct net_pack_out_ops;
 struct pool;
+struct sock_hashtable;
 
 enum sock_state {
 	SS_UNKNOWN,
@@ -74,6 +75,9 @@ struct sock {
 	struct idesc idesc;
 	struct sock_xattr sock_xattr;
 	struct dlist_head lnk;
+	struct dlist_head hash_lnk;
+	struct dlist_head notify_lnk; /* Link in list of pending notifications */
+	int notify_flags;             /* Events accumulated during batch */
 	enum sock_state state;
 	struct sock_opt opt;
 	struct sk_buff_head rx_queue;
@@ -146,6 +150,7 @@ struct sock_proto_ops {
 	int (*shutdown)(struct sock *sk, int how);
 	struct pool *sock_pool;
 	struct dlist_head *sock_list;
+	struct sock_hashtable *sock_table; /* optional, see sock_hash.h */
 };
 
 /* Base class for protocol sockets */
@@ -169,6 +174,8 @@ extern void sock_release(struct sock *sk);
 
 extern void sock_hash(struct sock *sk);
 extern void sock_unhash(struct sock *sk);
+/* Must be called after addresses of a hashed socket have been changed */
+extern void sock_rehash(struct sock *sk);
 
 
 extern void sock_rcv(struct sock *sk, struct sk_buff *skb,
@@ -18,4 +18,16 @@ extern void sock_wait_unlock(void);
 
 extern void sock_notify(struct sock *sk, int flags);
 
+/**
+ * Between these calls sock_notify() only accumulates events, each socket
+ * is notified once by sock_notify_batch_end(). Calls may be nested.
+ */
+extern void sock_notify_batch_begin(void);
+extern void sock_notify_batch_end(void);
+
+/**
+ * Drop events accumulated for @a sk, must be called before it's freed
+ */
+extern void sock_notify_cancel(struct sock *sk);
+
 #endif /* SOCK_WAIT_H_ */
@@ -11,6 +11,7 @@
 #define NET_SOCKET_INET_SOCK_H_
 
 #include <net/sock.h>
+#include <net/l3/route.h>
 #include <netinet/in.h>
 #include <arpa/inet.h> /* TODO remove this */
 #include <stdint.h>
@@ -46,6 +47,7 @@ typedef struct inet_sock {
 	int16_t uc_ttl;
 	uint16_t id;
 	struct inet_sock_opt opt;
+	struct rt_cache rt_cache; /* route to dst_in */
 } inet_sock_t;
 
 static inline struct inet_sock * to_inet_sock(struct sock *sk) {
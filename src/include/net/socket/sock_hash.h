@@ -0,0 +1,73 @@
+/**
+ * @file
+ * @brief Hash tables for receive demultiplexing of inet sockets.
+ *
+ * @date 17.10.2026
+ */
+
+#ifndef NET_SOCKET_SOCK_HASH_H_
+#define NET_SOCKET_SOCK_HASH_H_
+
+#include <stdint.h>
+#include <string.h>
+#include <netinet/in.h>
+
+#include <util/dlist.h>
+#include <framework/mod/options.h>
+#include <module/embox/net/sock.h>
+
+#include <net/sock.h>
+
+#define SOCK_HASH_SIZE \
+	OPTION_MODULE_GET(embox__net__sock, NUMBER, hash_size)
+
+/**
+ * Sockets of a protocol with both ends known are kept in @a established
+ * by local port and remote end, the rest (listening, bound, not bound yet)
+ * in @a bound by local port. Local address is left out of the key as it may
+ * be still unspecified for a connected socket.
+ */
+struct sock_hashtable {
+	int inited;
+	struct dlist_head established[SOCK_HASH_SIZE];
+	struct dlist_head bound[SOCK_HASH_SIZE];
+};
+
+/* IPv6 address is folded to 32 bits before hashing */
+static inline uint32_t sock_hash_in6_addr(const void *addr) {
+	struct in6_addr a;
+
+	memcpy(&a, addr, sizeof a); /* may be unaligned in a header */
+
+	return a.s6_addr32[0] ^ a.s6_addr32[1] ^ a.s6_addr32[2] ^ a.s6_addr32[3];
+}
+
+/* Address and ports are in network byte order */
+static inline unsigned int sock_hash_tuple(in_port_t lport,
+		uint32_t faddr, in_port_t fport) {
+	uint32_t h;
+
+	h = (faddr * 0x9e3779b1) ^ (((uint32_t)lport << 16) | fport);
+	h ^= h >> 16;
+	h *= 0x85ebca6b;
+	h ^= h >> 13;
+
+	return h & (SOCK_HASH_SIZE - 1);
+}
+
+static inline unsigned int sock_hash_port(in_port_t lport) {
+	return (lport ^ (lport >> 8)) & (SOCK_HASH_SIZE - 1);
+}
+
+/**
+ * Return the first socket of the bucket @a hash accepted by @a tester.
+ */
+extern struct sock * sock_lookup_established(
+		const struct sock_proto_ops *p_ops,
+		sock_lookup_tester_ft tester, const struct sk_buff *skb,
+		unsigned int hash);
+extern struct sock * sock_lookup_bound(const struct sock_proto_ops *p_ops,
+		sock_lookup_tester_ft tester, const struct sk_buff *skb,
+		unsigned int hash);
+
+#endif /* NET_SOCKET_SOCK_HASH_H_ */
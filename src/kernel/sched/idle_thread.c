@@ -13,10 +13,13 @@
 #include <kernel/task/kernel_task.h>
 #include <kernel/task.h>
 #include <kernel/thread.h>
+#include <kernel/time/tick_idle.h>
 
 static void * idle_run(void *arg) {
 	while (1) {
+		tick_idle_enter();
 		arch_idle();
+		tick_idle_exit();
 	}
 
 	return NULL;
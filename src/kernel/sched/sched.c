@@ -31,7 +31,9 @@
 #include <kernel/critical.h>
 #include <kernel/spinlock.h>
 #include <kernel/sched/sched_strategy.h>
+#include <kernel/sched/runq_placement.h>
 #include <kernel/sched/current.h>
+#include <kernel/time/tick_idle.h>
 
 // XXX
 #ifndef __barrier
@@ -47,7 +49,60 @@ static void sched_preempt(void);
 CRITICAL_DISPATCHER_DEF(sched_critical, sched_preempt, CRITICAL_SCHED_LOCK);
 
 //TODO these variable for scheduler (may be create object scheduler?)
-static struct runq rq;
+static struct runq rq[SCHED_RQ_QUANTITY];
+
+static inline struct runq *sched_rq(unsigned int cpu) {
+	return &rq[SCHED_RQ_IDX(cpu)];
+}
+
+/** Runq which protects the 'ready' state of the schedee. */
+static inline struct runq *sched_rq_of(struct schedee *s) {
+	return sched_rq(s->cpu);
+}
+
+/** Locks: IPL. */
+static struct runq *sched_rq_lock(struct schedee *s) {
+	struct runq *r;
+
+	while (1) {
+		r = sched_rq_of(s);
+		spin_lock(&r->lock);
+		if (r == sched_rq_of(s))
+			return r;
+		/* Moved to another runq meanwhile, retry. */
+		spin_unlock(&r->lock);
+	}
+}
+
+/**
+ * Locks: IPL, thread, runq of s. Moves waiting s to the runq of @a cpu which
+ * is returned locked together with the old one, so s is never seen on a
+ * runq it isn't queued to. Both are released by sched_rq_move_unlock().
+ */
+static struct runq *sched_rq_move(struct runq *r, struct schedee *s,
+		unsigned int cpu) {
+	struct runq *to = sched_rq(cpu);
+
+	if (to < r) {
+		/* Runqs are locked in the order of CPU ids. Nobody else moves
+		 * a waiting schedee while its lock is held by us. */
+		spin_unlock(&r->lock);
+		spin_lock(&to->lock);
+		spin_lock(&r->lock);
+	} else if (to > r) {
+		spin_lock(&to->lock);
+	}
+
+	s->cpu = cpu;
+
+	return to;
+}
+
+static void sched_rq_move_unlock(struct runq *r, struct runq *to) {
+	if (to != r)
+		spin_unlock(&r->lock);
+	spin_unlock(&to->lock);
+}
 
 void sched_post_switch(void) {
 	critical_request_dispatch(&sched_critical);
@@ -58,9 +113,12 @@ static inline int sched_in_interrupt(void) {
 }
 
 int sched_init(struct schedee *current) {
+	int i;
 
-	runq_init(&rq.queue);
-	rq.lock = SPIN_UNLOCKED;
+	for (i = 0; i < SCHED_RQ_QUANTITY; i++) {
+		runq_init(&rq[i].queue);
+		rq[i].lock = SPIN_UNLOCKED;
+	}
 
 	sched_set_current(current);
 
@@ -80,6 +138,8 @@ int schedee_init(struct schedee *schedee, int priority,
 	schedee->active = false;
 	schedee->waiting = true;
 
+	schedee->cpu = cpu_get_id();
+
 	schedee_priority_init(schedee, priority);
 	sched_affinity_init(&schedee->affinity);
 	sched_timing_init(schedee);
@@ -94,23 +154,71 @@ void sched_set_current(struct schedee *schedee) {
 	schedee->ready = true;
 	schedee->active = true;
 	schedee->waiting = false;
+
+	schedee->cpu = cpu_get_id();
+}
+
+#ifdef SMP
+
+/** Locks: IPL, runq of s. */
+static void sched_check_preempt(struct schedee *s) {
+	const unsigned int self = cpu_get_id();
+	int lowest = schedee_priority_get(s);
+	int target = -1;
+	unsigned int i, cpu;
+
+	if (s->active)
+		return;  /* already running somewhere */
+
+	/* Look for a CPU running the lowest priority schedee which could be
+	 * replaced by s, starting from this one to avoid an IPI on a tie. */
+	for (i = 0; i < NCPU; i++) {
+		struct schedee *curr;
+		int prio;
+
+		cpu = (self + i) % NCPU;
+		if (!sched_rq_may_run(s, cpu))
+			continue;
+
+		curr = schedee_get_cpu_current(cpu);
+		if (!curr)
+			continue;  /* CPU is not started yet */
+
+		prio = schedee_priority_get(curr);
+		if (prio < lowest) {
+			lowest = prio;
+			target = cpu;
+		}
+	}
+
+	if (target < 0)
+		return;
+
+	if (target == self)
+		sched_post_switch();
+	else
+		smp_send_resched(target);
 }
 
-static void sched_check_preempt(struct schedee *t) {
+#else /* !SMP */
+
+static void sched_check_preempt(struct schedee *s) {
 	// TODO ask runq
 	if (schedee_priority_get(schedee_get_current()) <
-			schedee_priority_get(t))
-		sched_post_switch(); // TODO SMP
+			schedee_priority_get(s))
+		sched_post_switch();
 }
 
+#endif /* SMP */
+
 /** Locks: IPL, thread, runq. */
 static void __sched_enqueue(struct schedee *s) {
-	runq_insert(&rq.queue, s);
+	runq_insert(&sched_rq_of(s)->queue, s);
 }
 
 /** Locks: IPL, thread, runq. */
 static void __sched_dequeue(struct schedee *s) {
-	runq_remove(&rq.queue, s);
+	runq_remove(&sched_rq_of(s)->queue, s);
 }
 
 /** Locks: IPL, thread, runq. */
@@ -131,12 +239,14 @@ int sched_active(struct schedee *s) {
 
 int sched_change_priority(struct schedee *s, int prior,
 		int (*set_priority)(struct schedee_priority *, int)) {
+	struct runq *r;
 	ipl_t ipl;
 	int in_rq;
 
 	assert(s);
 
-	ipl = spin_lock_ipl(&rq.lock);
+	ipl = ipl_save();
+	r = sched_rq_lock(s);
 	in_rq = s->ready && !sched_active(s);
 
 	if (in_rq)
@@ -147,17 +257,18 @@ int sched_change_priority(struct schedee *s, int prior,
 
 	sched_check_preempt(s);
 
-	spin_unlock_ipl(&rq.lock, ipl);
+	spin_unlock_ipl(&r->lock, ipl);
 
 	return 0;
 }
 
 static void __sched_freeze(struct schedee *s) {
+	struct runq *r;
 	int in_rq;
 
 	assert(s);
 
-	spin_lock(&rq.lock);
+	r = sched_rq_lock(s);
 	{
 		in_rq = s->ready && !sched_active(s);
 
@@ -170,7 +281,7 @@ static void __sched_freeze(struct schedee *s) {
 		s->active = false;
 		s->waiting = false;
 	}
-	spin_unlock(&rq.lock);
+	spin_unlock(&r->lock);
 }
 
 void sched_freeze(struct schedee *s) {
@@ -268,18 +379,28 @@ void sched_freeze(struct schedee *s) {
 
 /** Locks: IPL, thread. */
 static int __sched_wakeup_ready(struct schedee *s) {
+	struct runq *r;
 	int ready;
 
 	/* This doesn't necessarily spin until the lock is acquired.
 	 * SMP 'schedule' could outrun us getting the lock, but it will
 	 * clear t->ready state as soon as possible thus letting us to go. */
-	spin_protected_if (&rq.lock, (ready = s->ready))
-		/* Event has arrived before the thread reached 'schedule' and
-		 * went asleep (it could be even preempted after setting its
-		 * t->waiting state).
-		 * Just clear t->waiting state so that only a preemption check
-		 * is done by the thread when it finally invokes the scheduler. */
-		s->waiting = false;
+	do {
+		r = sched_rq_of(s);
+		spin_protected_if (&r->lock, (ready = s->ready)) {
+			if (r == sched_rq_of(s))
+				/* Event has arrived before the thread reached 'schedule'
+				 * and went asleep (it could be even preempted after
+				 * setting its t->waiting state).
+				 * Just clear t->waiting state so that only a preemption
+				 * check is done by the thread when it finally invokes
+				 * the scheduler. */
+				s->waiting = false;
+			else
+				/* Stolen by another CPU meanwhile, retry. */
+				r = NULL;
+		}
+	} while (!r);
 
 	return ready;
 }
@@ -287,12 +408,15 @@ static int __sched_wakeup_ready(struct schedee *s) {
 
 /** Locks: IPL, thread. */
 static void __sched_wakeup_waiting(struct schedee *s) {
+	struct runq *r, *to;
+
 	assert(s && s->waiting);
 
-	spin_lock(&rq.lock);
+	r = sched_rq_lock(s);
+	to = sched_rq_move(r, s, sched_rq_select(s));
 	__sched_enqueue_set_ready(s);
 	__sched_wokenup_clear_waiting(s);
-	spin_unlock(&rq.lock);
+	sched_rq_move_unlock(r, to);
 }
 
 #ifdef SMP
@@ -365,16 +489,93 @@ void sched_start_switch(struct schedee *next) {
 	__sched_activate(next);
 }
 
+#if SCHED_RQ_QUANTITY > 1
+
+/**
+ * Takes a schedee allowed to run on this CPU from a runq of another one.
+ * Busy runqs are skipped, so that two idle CPUs never wait for each other.
+ *
+ * Locks: IPL, local runq.
+ */
+static struct schedee *sched_steal(void) {
+	const unsigned int self = cpu_get_id();
+	unsigned int i;
+
+	for (i = 1; i < SCHED_RQ_QUANTITY; i++) {
+		struct runq *r = sched_rq((self + i) % SCHED_RQ_QUANTITY);
+		struct schedee *s;
+
+		if (!spin_trylock(&r->lock))
+			continue;
+
+		s = runq_extract(&r->queue);
+		if (s && (s->active
+				|| schedee_priority_get(s) == SCHED_PRIORITY_MIN
+				|| !sched_affinity_check(&s->affinity, 1 << self))) {
+			/* Still switching out on its CPU, idle or bound elsewhere. */
+			runq_insert(&r->queue, s);
+			s = NULL;
+		}
+
+		if (s)
+			s->cpu = self;
+
+		spin_unlock(&r->lock);
+
+		if (s)
+			return s;
+	}
+
+	return NULL;
+}
+
+/** Locks: IPL, local runq. */
+static struct schedee *sched_extract(struct runq *r) {
+	struct schedee *next, *stolen;
+
+	next = runq_extract(&r->queue);
+
+	if (next && schedee_priority_get(next) > SCHED_PRIORITY_MIN)
+		return next;
+
+	/* Nothing but idle is ready here, so help the other CPUs. */
+	stolen = sched_steal();
+	if (!stolen)
+		return next;
+
+	if (next)
+		runq_insert(&r->queue, next);
+
+	return stolen;
+}
+
+#else /* SCHED_RQ_QUANTITY == 1 */
+
+static inline struct schedee *sched_extract(struct runq *r) {
+	return runq_extract(&r->queue);
+}
+
+#endif /* SCHED_RQ_QUANTITY > 1 */
+
 /** locks: sched */
 static void __schedule(int preempt) {
 	ipl_t ipl;
+	struct runq *r;
 	struct schedee *prev;
 	struct schedee *next;
 
 	prev = schedee_get_current();
+	r = sched_rq(cpu_get_id());
 
 	assert(!sched_in_interrupt());
-	ipl = spin_lock_ipl(&rq.lock);
+
+	/* An interrupt which ended the halt may have woken a thread, it must
+	 * not run with tick stopped until idle gets the CPU back. */
+	if (schedee_priority_get(prev) == SCHED_PRIORITY_MIN)
+		tick_idle_exit();
+
+	assert(sched_rq_of(prev) == r);
+	ipl = spin_lock_ipl(&r->lock);
 
 	if (!preempt && prev->waiting)
 		prev->ready = false;
@@ -389,11 +590,12 @@ static void __schedule(int preempt) {
 	sched_timing_stop(prev);
 
 	while (1) {
-		next = runq_extract(&rq.queue);
+		next = sched_extract(r);
+		next->cpu = cpu_get_id();
 
 		/* Runq is unlocked as soon as possible, but interrupts remain disabled
 		 * during the 'sched_switch' (if any). */
-		spin_unlock(&rq.lock);
+		spin_unlock(&r->lock);
 
 		schedee_set_current(next);
 		log_debug("prev: %#x, next: %#x", prev, next);
@@ -406,7 +608,7 @@ static void __schedule(int preempt) {
 		}
 
 		/* ipl is enabled, no need to save it. */
-		spin_lock_ipl_disable(&rq.lock);
+		spin_lock_ipl_disable(&r->lock);
 	}
 
 	sched_timing_start(next);
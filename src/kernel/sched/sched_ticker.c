@@ -31,7 +31,6 @@ static void sched_tick(sys_timer_t *timer, void *param) {
 
 #ifdef SMP
 	for (int i = 0; i < NCPU; i++) {
-		extern void smp_send_resched(int cpu_id);
 		smp_send_resched(i);
 	}
 #endif /* SMP */
@@ -0,0 +1,19 @@
+/**
+ * @file
+ * @brief The only runq shared by all CPUs.
+ *
+ * @date 17.10.2026
+ */
+
+#include <kernel/sched.h>
+#include <kernel/sched/affinity.h>
+#include <kernel/sched/runq_placement.h>
+
+unsigned int sched_rq_select(struct schedee *s) {
+	/* Any CPU extracts from the same runq, nothing to select. */
+	return s->cpu;
+}
+
+int sched_rq_may_run(struct schedee *s, unsigned int cpu) {
+	return sched_affinity_check(&s->affinity, 1 << cpu);
+}
@@ -0,0 +1,15 @@
+/**
+ * @file
+ * @brief The only runq shared by all CPUs.
+ *
+ * @date 17.10.2026
+ */
+
+#ifndef KERNEL_SCHED_PLACEMENT_GLOBAL_H_
+#define KERNEL_SCHED_PLACEMENT_GLOBAL_H_
+
+#define SCHED_RQ_QUANTITY 1
+
+#define SCHED_RQ_IDX(cpu) 0
+
+#endif /* KERNEL_SCHED_PLACEMENT_GLOBAL_H_ */
@@ -0,0 +1,42 @@
+/**
+ * @file
+ * @brief Runq per CPU.
+ *
+ * @details A woken up schedee is queued on the CPU it has last run on, so
+ * its cache is likely to be still warm. If affinity doesn't allow that CPU
+ * any more, the waker's CPU is used. Balancing is done by idle CPUs which
+ * steal schedees from the others (see sched.c).
+ *
+ * @date 17.10.2026
+ */
+
+#include <hal/cpu.h>
+#include <kernel/sched.h>
+#include <kernel/sched/affinity.h>
+#include <kernel/sched/runq_placement.h>
+
+unsigned int sched_rq_select(struct schedee *s) {
+	unsigned int cpu;
+
+	if (sched_affinity_check(&s->affinity, 1 << s->cpu)) {
+		return s->cpu;
+	}
+
+	cpu = cpu_get_id();
+	if (sched_affinity_check(&s->affinity, 1 << cpu)) {
+		return cpu;
+	}
+
+	for (cpu = 0; cpu < NCPU; cpu++) {
+		if (sched_affinity_check(&s->affinity, 1 << cpu)) {
+			return cpu;
+		}
+	}
+
+	return s->cpu;
+}
+
+int sched_rq_may_run(struct schedee *s, unsigned int cpu) {
+	/* Only the CPU owning the runq can pick the schedee up at once. */
+	return s->cpu == cpu;
+}
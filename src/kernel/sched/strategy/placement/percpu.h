@@ -0,0 +1,17 @@
+/**
+ * @file
+ * @brief Runq per CPU.
+ *
+ * @date 17.10.2026
+ */
+
+#ifndef KERNEL_SCHED_PLACEMENT_PERCPU_H_
+#define KERNEL_SCHED_PLACEMENT_PERCPU_H_
+
+#include <hal/cpu.h>
+
+#define SCHED_RQ_QUANTITY NCPU
+
+#define SCHED_RQ_IDX(cpu) (cpu)
+
+#endif /* KERNEL_SCHED_PLACEMENT_PERCPU_H_ */
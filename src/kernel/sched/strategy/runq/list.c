@@ -31,6 +31,10 @@ void runq_remove(runq_t *queue, struct schedee *schedee) {
 struct schedee *runq_extract(runq_t *queue) {
 	struct schedee *schedee;
 
+	if (dlist_empty(queue)) {
+		return NULL;
+	}
+
 	schedee = dlist_entry(queue->next, struct schedee, runq_link);
 	runq_remove(queue, schedee);
 
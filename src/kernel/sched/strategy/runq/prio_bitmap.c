@@ -0,0 +1,146 @@
+/**
+ * @file
+ * @brief Run queue with O(1) lookup of the highest ready priority.
+ *
+ * @details Each priority level has its own list. Every CPU owns a two-level
+ * occupancy bitmap (with counters) of levels which contain at least one
+ * schedee allowed to run on that CPU, so the level to extract from is found
+ * with a couple of find-last-set operations regardless of how many levels
+ * and schedees are queued. Affinity is accounted on insertion, that is why
+ * in the common case the head of the found level is the one to run.
+ *
+ * @date 17.10.2026
+ */
+
+#include <assert.h>
+#include <limits.h>
+#include <string.h>
+
+#include <util/bit.h>
+#include <util/bitmap.h>
+#include <util/dlist.h>
+
+#include <hal/cpu.h>
+#include <kernel/sched.h>
+#include <kernel/sched/affinity.h>
+#include <kernel/sched/schedee_priority.h>
+#include <kernel/sched/sched_strategy.h>
+
+#define RUNQ_PRIO_IDX(prio) ((prio) - SCHED_PRIORITY_MIN)
+
+static_assert(RUNQ_PRIO_WORDS <= LONG_BIT);
+static_assert(NCPU <= sizeof(unsigned int) * CHAR_BIT);
+
+static inline void runq_map_inc(struct runq_cpu_map *map, int idx) {
+	if (map->count[idx]++ == 0) {
+		bitmap_set_bit(map->prio, idx);
+		map->group |= 0x1ul << BITMAP_OFFSET(idx);
+	}
+}
+
+static inline void runq_map_dec(struct runq_cpu_map *map, int idx) {
+	assert(map->count[idx] > 0);
+
+	if (--map->count[idx] == 0) {
+		bitmap_clear_bit(map->prio, idx);
+		if (!map->prio[BITMAP_OFFSET(idx)]) {
+			map->group &= ~(0x1ul << BITMAP_OFFSET(idx));
+		}
+	}
+}
+
+/** @return the highest non-empty level index, or -1 if there is none. */
+static inline int runq_map_highest(struct runq_cpu_map *map) {
+	int word;
+
+	if (!map->group) {
+		return -1;
+	}
+
+	word = bit_fls(map->group) - 1;
+
+	return word * LONG_BIT + bit_fls(map->prio[word]) - 1;
+}
+
+static unsigned int runq_cpu_mask(struct schedee *schedee) {
+	unsigned int mask = 0;
+	int cpu;
+
+	for (cpu = 0; cpu < NCPU; cpu++) {
+		if (sched_affinity_check(&schedee->affinity, 1 << cpu)) {
+			mask |= 1 << cpu;
+		}
+	}
+
+	return mask;
+}
+
+void runq_item_init(runq_item_t *runq_link) {
+	dlist_head_init(&runq_link->link);
+	runq_link->prio = 0;
+	runq_link->cpu_mask = 0;
+}
+
+void runq_init(runq_t *queue) {
+	int i;
+
+	for (i = 0; i < SCHED_PRIORITY_TOTAL; i++) {
+		dlist_init(&queue->list[i]);
+	}
+
+	memset(queue->map, 0, sizeof(queue->map));
+}
+
+void runq_insert(runq_t *queue, struct schedee *schedee) {
+	runq_item_t *rl = &schedee->runq_link;
+	int idx, cpu;
+
+	rl->prio = schedee_priority_get(schedee);
+	rl->cpu_mask = runq_cpu_mask(schedee);
+
+	idx = RUNQ_PRIO_IDX(rl->prio);
+	dlist_add_prev(&rl->link, &queue->list[idx]);
+
+	for (cpu = 0; cpu < NCPU; cpu++) {
+		if (rl->cpu_mask & (1 << cpu)) {
+			runq_map_inc(&queue->map[cpu], idx);
+		}
+	}
+}
+
+void runq_remove(runq_t *queue, struct schedee *schedee) {
+	runq_item_t *rl = &schedee->runq_link;
+	int idx, cpu;
+
+	idx = RUNQ_PRIO_IDX(rl->prio);
+	dlist_del(&rl->link);
+
+	for (cpu = 0; cpu < NCPU; cpu++) {
+		if (rl->cpu_mask & (1 << cpu)) {
+			runq_map_dec(&queue->map[cpu], idx);
+		}
+	}
+}
+
+struct schedee *runq_extract(runq_t *queue) {
+	const unsigned int mask = 1 << cpu_get_id();
+	struct schedee *schedee;
+	int idx;
+
+	idx = runq_map_highest(&queue->map[cpu_get_id()]);
+	if (idx < 0) {
+		return NULL;
+	}
+
+	/* Unless there are schedees bound to other CPUs on this level,
+	 * the very first one is taken. */
+	dlist_foreach_entry(schedee, &queue->list[idx], runq_link.link) {
+		if (schedee->runq_link.cpu_mask & mask) {
+			runq_remove(queue, schedee);
+			return schedee;
+		}
+	}
+
+	assertf(0, "runq bitmap is inconsistent with level %d", idx);
+	return NULL;
+}
@@ -0,0 +1,46 @@
+/**
+ * @file
+ * @brief Run queue with per-priority occupancy bitmaps.
+ *
+ * @date 17.10.2026
+ */
+
+#ifndef KERNEL_THREAD_QUEUE_PRIO_BITMAP_H_
+#define KERNEL_THREAD_QUEUE_PRIO_BITMAP_H_
+
+#include <stdint.h>
+
+#include <util/bitmap.h>
+#include <util/dlist.h>
+
+#include <hal/cpu.h>
+#include <kernel/sched/schedee_priority.h>
+
+#define RUNQ_PRIO_WORDS BITMAP_SIZE(SCHED_PRIORITY_TOTAL)
+
+/**
+ * Priorities containing at least one schedee that may run on a given CPU.
+ * Two levels: @a group has a bit per non-zero word of @a prio.
+ */
+struct runq_cpu_map {
+	unsigned long group;
+	unsigned long prio[RUNQ_PRIO_WORDS];
+	uint16_t      count[SCHED_PRIORITY_TOTAL];
+};
+
+struct runq_queue {
+	struct dlist_head   list[SCHED_PRIORITY_TOTAL];
+	struct runq_cpu_map map[NCPU];
+};
+
+struct runq_link {
+	struct dlist_head link;
+	int               prio;     /**< Priority the schedee was queued with. */
+	unsigned int      cpu_mask; /**< CPUs the schedee was accounted for. */
+};
+
+typedef struct runq_link runq_item_t;
+
+typedef struct runq_queue runq_t;
+
+#endif /* KERNEL_THREAD_QUEUE_PRIO_BITMAP_H_ */
@@ -30,9 +30,14 @@ void runq_remove(runq_t *queue, struct schedee *s) {
 }
 
 struct schedee *runq_extract(runq_t *queue) {
-	runq_item_t *first = priolist_first(queue);
+	runq_item_t *first;
 	struct schedee *result;
 
+	if (priolist_empty(queue)) {
+		return NULL;
+	}
+
+	first = priolist_first(queue);
 	priolist_del(first, queue);
 	result = mcast_out(first, struct schedee, runq_link);
 
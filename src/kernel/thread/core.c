@@ -207,6 +207,8 @@ void thread_init(struct thread *t, int priority,
 		panic("can't initialize thread_local");
 	}
 
+	t->malloc_cache = NULL;
+
 	t->joining = NULL;
 
 	t->run = run;
@@ -247,12 +249,17 @@ struct thread *thread_init_stack(void *stack, size_t stack_sz,
 	return thread;
 
 }
+void __attribute__((weak)) thread_malloc_cache_free(struct thread *t) {
+
+}
+
 void thread_delete(struct thread *t) {
 	static struct thread *zombie = NULL;
 
 	assert(t);
 	assert(t->state & TS_EXITED);
 
+	thread_malloc_cache_free(t);
 	task_thread_unregister(t->task, t);
 	thread_local_free(t);
 
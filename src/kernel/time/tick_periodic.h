@@ -0,0 +1,21 @@
+/**
+ * @file
+ * @brief Tick is never stopped.
+ *
+ * @date 17.10.2026
+ */
+
+#ifndef KERNEL_TIME_TICK_PERIODIC_H_
+#define KERNEL_TIME_TICK_PERIODIC_H_
+
+static inline void tick_idle_enter(void) {
+}
+
+static inline void tick_idle_exit(void) {
+}
+
+static inline unsigned long tick_idle_elided(void) {
+	return 0;
+}
+
+#endif /* KERNEL_TIME_TICK_PERIODIC_H_ */
@@ -0,0 +1,118 @@
+/**
+ * @file
+ * @brief Tickless idle.
+ *
+ * @details Before halting, idle programs the event device of jiffies in
+ * one-shot mode to fire at the nearest timer deadline. On wake up the number
+ * of periods really passed is added to jiffies at once and periodic mode is
+ * restored. The device must provide oneshot_elapsed(), otherwise tick is
+ * left periodic.
+ *
+ * Periodic mode restarts with a whole period, so the part of the period
+ * passed before a wake up by other interrupt is kept and added to the next
+ * ones. Jiffies get one more tick once such parts sum up to a period.
+ *
+ * A timer started while the tick is stopped (e.g. by an interrupt that came
+ * between tick_idle_enter() and the halt) restores periodic tick at once,
+ * so it never waits for the previously programmed deadline.
+ *
+ * The scheduler restores periodic tick as well when it switches away from
+ * idle, so a thread woken by the interrupt which ended the halt always runs
+ * with jiffies going.
+ *
+ * @date 17.10.2026
+ */
+
+#include <limits.h>
+
+#include <hal/clock.h>
+#include <kernel/spinlock.h>
+#include <kernel/time/clock_source.h>
+#include <kernel/time/timer_strat.h>
+#include <kernel/time/tick_idle.h>
+
+#include <module/embox/kernel/time/slowdown.h>
+
+#define SLOWDOWN_SHIFT OPTION_MODULE_GET(embox__kernel__time__slowdown, NUMBER, shift)
+
+extern struct clock_source *cs_jiffies;
+
+/* Periods the device is armed for, zero if tick is periodic. */
+static int tick_idle_armed;
+static clock_t tick_idle_jiffies;
+/* Parts of a period passed in idle and not accounted yet */
+static unsigned int tick_idle_frac;
+static unsigned long tick_idle_elided_cnt;
+static spinlock_t tick_idle_lock = SPIN_STATIC_UNLOCKED;
+
+void tick_idle_enter(void) {
+	struct time_event_device *ed;
+	struct time_dev_conf conf = {
+		.period_type = HW_TIMER_ONESHOOT,
+	};
+	clock_t next;
+	ipl_t ipl;
+
+	/* Periods are not ticks with slowdown, don't bother. */
+	if (SLOWDOWN_SHIFT || !cs_jiffies || !(ed = cs_jiffies->event_device)
+			|| !ed->oneshot_elapsed) {
+		return;
+	}
+
+	ipl = spin_lock_ipl(&tick_idle_lock);
+	{
+		next = timer_strat_get_next_event();
+		/* Nothing to gain if a timer expires on the very next tick. */
+		if (!tick_idle_armed && next > 1) {
+			conf.event_period = next > INT_MAX ? INT_MAX : next;
+			if (!ed->config(&conf)) {
+				tick_idle_armed = conf.event_period;
+				tick_idle_jiffies = cs_jiffies->jiffies;
+			}
+		}
+	}
+	spin_unlock_ipl(&tick_idle_lock, ipl);
+}
+
+void tick_idle_exit(void) {
+	struct time_event_device *ed;
+	struct time_dev_conf conf = {
+		.period_type = HW_TIMER_PERIOD,
+	};
+	unsigned int frac;
+	int elapsed, carry;
+	ipl_t ipl;
+
+	if (!tick_idle_armed) {
+		return;
+	}
+
+	ed = cs_jiffies->event_device;
+
+	ipl = spin_lock_ipl(&tick_idle_lock);
+	if (tick_idle_armed) {
+		if (cs_jiffies->jiffies != tick_idle_jiffies
+				|| (ed->pending && ed->pending(ed->irq_nr))) {
+			/* The event has come, its own tick is accounted by interrupt. */
+			elapsed = tick_idle_armed - 1;
+			frac = 0;
+		} else {
+			elapsed = ed->oneshot_elapsed(&frac);
+		}
+		tick_idle_armed = 0;
+
+		ed->config(&conf);
+
+		tick_idle_frac += frac;
+		carry = tick_idle_frac / TIME_EVENT_FRAC_ONE;
+		tick_idle_frac %= TIME_EVENT_FRAC_ONE;
+
+		tick_idle_elided_cnt += elapsed;
+		clock_tick_catch_up(elapsed + carry);
+	}
+	spin_unlock_ipl(&tick_idle_lock, ipl);
+}
+
+unsigned long tick_idle_elided(void) {
+	return tick_idle_elided_cnt;
+}
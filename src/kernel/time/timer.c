@@ -20,6 +20,8 @@
 EMBOX_UNIT_INIT(init);
 
 static int inited = 0;
+/* Jiffies already passed to timers, lags behind if handler was delayed. */
+static clock_t handled_jiffies;
 
 static struct lthread clock_handler_lt;
 extern struct clock_source *cs_jiffies;
@@ -44,8 +46,23 @@ void clock_tick_handler(int irq_num, void *dev_id) {
 	}
 }
 
+void clock_tick_catch_up(clock_t ticks) {
+	if (!ticks) {
+		return;
+	}
+
+	cs_jiffies->jiffies += ticks;
+
+	if (inited) {
+		lthread_launch(&clock_handler_lt);
+	}
+}
+
 static int clock_handler(struct lthread *self) {
-	timer_strat_sched();
+	while (handled_jiffies != cs_jiffies->jiffies) {
+		handled_jiffies++;
+		timer_strat_sched();
+	}
 	return 0;
 }
 
@@ -53,6 +70,8 @@ static int init(void) {
 	lthread_init(&clock_handler_lt, &clock_handler);
 	schedee_priority_set(&clock_handler_lt.schedee, CLOCK_HND_PRIORITY);
 
+	handled_jiffies = cs_jiffies->jiffies;
+
 	inited = 1;
 
 	return 0;
@@ -66,7 +66,10 @@ static inline bool timers_need_schedule(void) {
 static inline void timers_schedule(void) {
 	struct sys_timer *timer;
 
-	dlist_foreach_entry(timer, &sys_timers_list, lnk) {
+	/* Handlers may stop other timers (e.g. when releasing sockets),
+	 * so always take the head instead of a cached next element. */
+	while (!dlist_empty(&sys_timers_list)) {
+		timer = (struct sys_timer *) sys_timers_list.next;
 		if (0 != timer->cnt) {
 			break;
 		}
@@ -80,6 +83,14 @@ static inline void timers_schedule(void) {
 	}
 }
 
+clock_t timer_strat_get_next_event(void) {
+	if (dlist_empty(&sys_timers_list)) {
+		return TIMER_STRAT_NO_EVENT;
+	}
+
+	return ((sys_timer_t *) sys_timers_list.next)->cnt;
+}
+
 /**
  * For each timer in the timers array do the following: if the timer is enable
  * and the counter of this timer is the zero then its initial value is assigned
@@ -37,21 +37,51 @@ void timer_strat_start(struct sys_timer *tmr) {
  * to the counter and the function is executed.
  */
 void timer_strat_sched(void) {
+	DLIST_DEFINE(expired);
 	sys_timer_t *tmr;
+	ipl_t ipl;
 
+	/* Handlers may stop, free or restart any timer, so expired ones are
+	 * collected first and then always taken from the head. A timer stopped
+	 * by a handler leaves this list as well. */
+	ipl = ipl_save();
 	dlist_foreach_entry(tmr, &sys_timers_list, lnk) {
 		if (0 == tmr->cnt--) {
-			if (timer_is_periodic(tmr)) {
-				tmr->cnt = tmr->load;
-			} else {
-				timer_strat_stop(tmr);
-			}
+			dlist_del(&tmr->lnk);
+			dlist_add_prev(&tmr->lnk, &expired);
+		}
+	}
+	ipl_restore(ipl);
+
+	while (!dlist_empty(&expired)) {
+		tmr = dlist_first_entry(&expired, sys_timer_t, lnk);
 
-			tmr->handle(tmr, tmr->param);
+		if (timer_is_periodic(tmr)) {
+			tmr->cnt = tmr->load;
+			ipl = ipl_save();
+			dlist_move(&tmr->lnk, &sys_timers_list);
+			ipl_restore(ipl);
+		} else {
+			timer_strat_stop(tmr);
 		}
+
+		tmr->handle(tmr, tmr->param);
 	}
 }
 
+clock_t timer_strat_get_next_event(void) {
+	sys_timer_t *tmr;
+	clock_t next = TIMER_STRAT_NO_EVENT;
+
+	dlist_foreach_entry(tmr, &sys_timers_list, lnk) {
+		if ((clock_t) tmr->cnt + 1 < next) {
+			next = tmr->cnt + 1;
+		}
+	}
+
+	return next;
+}
+
 void timer_strat_stop(struct sys_timer *tmr) {
 	ipl_t ipl;
 
@@ -0,0 +1,191 @@
+/**
+ * @file
+ * @brief Hierarchical timer wheel.
+ *
+ * @details Timers are hashed by their expiration tick into slots of five
+ * wheels: the root one with a slot per tick for the nearest 256 ticks, and
+ * four coarser ones with 64 slots each covering the rest of 32-bit range.
+ * Each time the root wheel wraps around, the next slot of an upper level is
+ * cascaded down. So start, stop and expiration of a timer take O(1) time
+ * regardless of how many timers are armed.
+ *
+ * @date 17.10.2026
+ */
+
+#include <stdint.h>
+
+#include <embox/unit.h>
+#include <util/dlist.h>
+
+#include <kernel/time/timer.h>
+
+#define TW_ROOT_BITS 8
+#define TW_LVL_BITS  6
+#define TW_LVL_NR    4
+
+#define TW_ROOT_SIZE (1 << TW_ROOT_BITS)
+#define TW_LVL_SIZE  (1 << TW_LVL_BITS)
+#define TW_ROOT_MASK (TW_ROOT_SIZE - 1)
+#define TW_LVL_MASK  (TW_LVL_SIZE - 1)
+
+#define TW_LVL_SHIFT(lvl) (TW_ROOT_BITS + (lvl) * TW_LVL_BITS)
+#define TW_LVL_IDX(tick, lvl) (((tick) >> TW_LVL_SHIFT(lvl)) & TW_LVL_MASK)
+
+EMBOX_UNIT_INIT(timer_wheel_init);
+
+static struct dlist_head tw_root[TW_ROOT_SIZE];
+static struct dlist_head tw_lvl[TW_LVL_NR][TW_LVL_SIZE];
+
+/* The tick to be processed by the next timer_strat_sched() call. */
+static uint32_t tw_next;
+
+/* Expiration tick is kept in tmr->cnt. */
+static void tw_add(struct sys_timer *tmr) {
+	uint32_t expires = tmr->cnt;
+	uint32_t delta = expires - tw_next;
+	struct dlist_head *slot;
+	int lvl;
+
+	if (delta < TW_ROOT_SIZE) {
+		slot = &tw_root[expires & TW_ROOT_MASK];
+	} else {
+		for (lvl = 0; lvl < TW_LVL_NR - 1; lvl++) {
+			if (delta < (1u << TW_LVL_SHIFT(lvl + 1))) {
+				break;
+			}
+		}
+		slot = &tw_lvl[lvl][TW_LVL_IDX(expires, lvl)];
+	}
+
+	dlist_add_prev(&tmr->lnk, slot);
+}
+
+/* Redistributes timers of the slot among lower levels. */
+static void tw_cascade(struct dlist_head *slot) {
+	struct sys_timer *tmr;
+
+	dlist_foreach_entry(tmr, slot, lnk) {
+		dlist_del_init(&tmr->lnk);
+		tw_add(tmr);
+	}
+}
+
+void timer_strat_start(struct sys_timer *tmr) {
+	dlist_head_init(&tmr->lnk);
+	timer_set_started(tmr);
+
+	/* tmr->cnt is a number of ticks to wait, the first one is tw_next. */
+	tmr->cnt = tw_next + (tmr->cnt ? tmr->cnt - 1 : 0);
+
+	tw_add(tmr);
+}
+
+void timer_strat_stop(struct sys_timer *tmr) {
+	timer_set_stopped(tmr);
+
+	dlist_del(&tmr->lnk);
+}
+
+void timer_strat_sched(void) {
+	struct dlist_head expired;
+	struct sys_timer *tmr;
+	unsigned int idx;
+	int lvl;
+
+	idx = tw_next & TW_ROOT_MASK;
+	if (idx == 0) {
+		for (lvl = 0; lvl < TW_LVL_NR; lvl++) {
+			unsigned int lvl_idx = TW_LVL_IDX(tw_next, lvl);
+
+			tw_cascade(&tw_lvl[lvl][lvl_idx]);
+			if (lvl_idx != 0) {
+				break;
+			}
+		}
+	}
+
+	tw_next++;
+
+	/* Handlers may restart timers into the same slot, so detach it first. */
+	dlist_init(&expired);
+	dlist_foreach_entry(tmr, &tw_root[idx], lnk) {
+		dlist_del_init(&tmr->lnk);
+		dlist_add_prev(&tmr->lnk, &expired);
+	}
+
+	while (!dlist_empty(&expired)) {
+		tmr = dlist_first_entry(&expired, struct sys_timer, lnk);
+
+		timer_strat_stop(tmr);
+		if (timer_is_periodic(tmr)) {
+			tmr->cnt = tmr->load;
+			timer_strat_start(tmr);
+		}
+
+		tmr->handle(tmr, tmr->param);
+	}
+}
+
+clock_t timer_strat_get_next_event(void) {
+	struct sys_timer *tmr;
+	unsigned int i, left, lvl_idx;
+	clock_t next = TIMER_STRAT_NO_EVENT;
+	int lvl;
+
+	/* Slots past the wrap hold timers of the next round of the root wheel. */
+	for (i = 0; i < TW_ROOT_SIZE; i++) {
+		if (!dlist_empty(&tw_root[(tw_next + i) & TW_ROOT_MASK])) {
+			next = i + 1;
+			break;
+		}
+	}
+
+	left = TW_ROOT_SIZE - (tw_next & TW_ROOT_MASK);
+
+	/* Slots cascaded by the coming tick are not in the root wheel yet. */
+	if (left == TW_ROOT_SIZE) {
+		for (lvl = 0; lvl < TW_LVL_NR; lvl++) {
+			lvl_idx = TW_LVL_IDX(tw_next, lvl);
+
+			dlist_foreach_entry(tmr, &tw_lvl[lvl][lvl_idx], lnk) {
+				if ((uint32_t) tmr->cnt - tw_next + 1 < next) {
+					next = (uint32_t) tmr->cnt - tw_next + 1;
+				}
+			}
+			if (lvl_idx != 0) {
+				break;
+			}
+		}
+	}
+
+	if (next <= left + 1) {
+		return next;
+	}
+
+	/* Timers of the upper levels may expire as early as the next cascade. */
+	for (lvl = 0; lvl < TW_LVL_NR; lvl++) {
+		for (i = 0; i < TW_LVL_SIZE; i++) {
+			if (!dlist_empty(&tw_lvl[lvl][i])) {
+				return left + 1;
+			}
+		}
+	}
+
+	return next;
+}
+
+static int timer_wheel_init(void) {
+	int i, lvl;
+
+	for (i = 0; i < TW_ROOT_SIZE; i++) {
+		dlist_init(&tw_root[i]);
+	}
+
+	for (lvl = 0; lvl < TW_LVL_NR; lvl++) {
+		for (i = 0; i < TW_LVL_SIZE; i++) {
+			dlist_init(&tw_lvl[lvl][i]);
+		}
+	}
+
+	return 0;
+}
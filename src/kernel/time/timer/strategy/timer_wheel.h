@@ -0,0 +1,18 @@
+/**
+ * @file
+ *
+ * @brief
+ *
+ * @date 17.10.2026
+ */
+
+#ifndef TIMER_WHEEL_H_
+#define TIMER_WHEEL_H_
+
+#include <util/dlist.h>
+
+
+typedef struct dlist_head sys_timer_queue_t;
+
+
+#endif /* TIMER_WHEEL_H_ */
@@ -12,6 +12,7 @@
 
 #include <kernel/time/timer.h>
 #include <kernel/time/time.h>
+#include <kernel/time/tick_idle.h>
 #include <kernel/sched/sched_lock.h>
 #include <util/lang.h>
 
@@ -36,6 +37,9 @@ void timer_start(struct sys_timer *tmr, clock_t jiffies) {
 
 	timer_stop(tmr);
 
+	/* Catch up with ticks elided in idle before counting from now on. */
+	tick_idle_exit();
+
 	if (timer_is_periodic(tmr)) {
 		tmr->load = jiffies;
 		tmr->cnt = tmr->load + 1;
@@ -224,6 +224,18 @@ static struct free_block *block_align(struct free_block_link *free_blocks_list,
 	return aligned_block;
 }
 
+static void block_release(void *heap, struct free_block *block) {
+	/* Free block */
+	block_link(heap, block);
+	set_end_size(block);
+	clear_block(block);
+	clear_next(block);
+
+	/* And than concatenate with neighbors */
+	block = concatenate_prev(block);
+	block = concatenate_next(block);
+}
+
 void *bm_memalign(void *heap, size_t boundary, size_t size) {
 	struct free_block *block;
 	struct free_block_link *link;
@@ -302,17 +314,41 @@ void bm_free(void *heap, void *ptr) {
 
 	afterfree(ptr, (get_clear_size(block->size) - sizeof(block->size)));
 
-	/* Free block */
-	block_link(heap, block);
-	set_end_size(block);
-	clear_block(block);
-	clear_next(block);
+	block_release(heap, block);
 
-	/* And than concatenate with neighbors */
-	block = concatenate_prev(block);
-	block = concatenate_next(block);
+	sched_unlock();
+}
+
+size_t bm_usable_size(void *ptr) {
+	struct free_block *block;
+
+	block = (struct free_block *) ((uint32_t *) ptr - 1);
+	return get_clear_size(block->size) - sizeof(block->size);
+}
+
+int bm_extend(void *heap, size_t size, size_t new_size) {
+	struct free_block *block, *last;
+
+	assert(new_size > size);
+
+	sched_lock();
+
+	/* Persistently busy last word becomes the beginning of a new busy
+	 * block which takes all appended memory, except for the new last word */
+	block = heap + size - sizeof block->size;
+	block->size = (new_size - size) | (block->size & 0x2);
+	mark_block(block);
+
+	last = heap + new_size - sizeof block->size;
+	last->size = 0;
+	mark_block(last);
+	mark_next(block);
+
+	block_release(heap, block);
 
 	sched_unlock();
+
+	return 0;
 }
 
 void bm_init(void *heap, size_t size) {
@@ -0,0 +1,415 @@
+/**
+ * @file
+ * @brief Two-level segregated fit (TLSF) algorithm implementation
+ *
+ * @details Free blocks are kept in lists segregated by size. First level
+ * splits sizes by power of two, second level splits each power of two
+ * range into SL_COUNT equal classes. Non-empty lists are marked in
+ * bitmaps, so a list with large enough blocks is found with two bit
+ * scans instead of a walk through all free blocks.
+ *
+ *    Segment structure:
+ *    |struct tlsf_control| *** blocks *** | sentinel busy block header |
+ *
+ * @date 17.10.2026
+ */
+
+#include <assert.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include <framework/mod/options.h>
+#include <kernel/printk.h>
+#include <kernel/sched/sched_lock.h>
+#include <mem/heap_afterfree.h>
+#include <mem/heap_tlsf.h>
+#include <util/binalign.h>
+#include <util/bit.h>
+#include <util/math.h>
+
+#define SL_LOG2      OPTION_GET(NUMBER, sl_index_log2)
+#define SL_COUNT     (1 << SL_LOG2)
+
+#if SL_LOG2 > 5
+#error "sl_index_log2 is too large for 32-bit second level bitmap"
+#endif
+
+#define ALIGN_LOG2   3
+#define TLSF_ALIGN   (1 << ALIGN_LOG2)
+
+/* Blocks smaller than SMALL_BLOCK are all in the first level list,
+ * second level classes of it are TLSF_ALIGN bytes wide */
+#define FL_SHIFT     (SL_LOG2 + ALIGN_LOG2)
+#define SMALL_BLOCK  (1 << FL_SHIFT)
+
+/* Segment may be extended up to 2^TLSF_GROW_LOG2 times of initial size */
+#define TLSF_GROW_LOG2  2
+
+#define BLOCK_FREE      0x1
+#define BLOCK_PREV_FREE 0x2
+#define BLOCK_FLAGS     (BLOCK_FREE | BLOCK_PREV_FREE)
+
+struct tlsf_block {
+	struct tlsf_block *prev_phys; /**<< Valid only if previous block is free */
+	size_t size;                  /**<< Size of block including header.
+	                                    Low bits store BLOCK_* flags */
+	/* Members below are valid only in free blocks */
+	struct tlsf_block *next_free;
+	struct tlsf_block *prev_free;
+};
+
+#define BLOCK_HDR_SIZE offsetof(struct tlsf_block, next_free)
+#define BLOCK_SIZE_MIN \
+	binalign_bound(sizeof(struct tlsf_block), TLSF_ALIGN)
+
+struct tlsf_fl {
+	uint32_t sl_bitmap;
+	struct tlsf_block *blocks[SL_COUNT];
+};
+
+struct tlsf_control {
+	uint32_t fl_bitmap;
+	int fl_count;
+	struct tlsf_fl fl[];
+};
+
+static struct tlsf_control *tlsf_ctrl(void *segment) {
+	return (struct tlsf_control *) binalign_bound((uintptr_t) segment, TLSF_ALIGN);
+}
+
+static size_t block_size(struct tlsf_block *block) {
+	return block->size & ~BLOCK_FLAGS;
+}
+
+static int block_is_free(struct tlsf_block *block) {
+	return block->size & BLOCK_FREE;
+}
+
+static struct tlsf_block *block_next(struct tlsf_block *block) {
+	return (struct tlsf_block *) ((char *) block + block_size(block));
+}
+
+static void *block_to_ptr(struct tlsf_block *block) {
+	return (char *) block + BLOCK_HDR_SIZE;
+}
+
+static struct tlsf_block *ptr_to_block(void *ptr) {
+	return (struct tlsf_block *) ((char *) ptr - BLOCK_HDR_SIZE);
+}
+
+/* Finds list of blocks of @a size */
+static void mapping_insert(size_t size, int *fl, int *sl) {
+	int t;
+
+	if (size < SMALL_BLOCK) {
+		*fl = 0;
+		*sl = size >> ALIGN_LOG2;
+	} else {
+		t = bit_fls(size) - 1;
+		*sl = (size >> (t - SL_LOG2)) ^ SL_COUNT;
+		*fl = t - FL_SHIFT + 1;
+	}
+}
+
+/* Finds the first list whose every block is not less than @a size */
+static void mapping_search(size_t size, int *fl, int *sl) {
+	if (size >= SMALL_BLOCK) {
+		size += (1UL << (bit_fls(size) - 1 - SL_LOG2)) - 1;
+	}
+	mapping_insert(size, fl, sl);
+}
+
+static void block_insert(struct tlsf_control *ctrl, struct tlsf_block *block) {
+	struct tlsf_block *head;
+	int fl, sl;
+
+	mapping_insert(block_size(block), &fl, &sl);
+	assert(fl < ctrl->fl_count);
+
+	head = ctrl->fl[fl].blocks[sl];
+	block->prev_free = NULL;
+	block->next_free = head;
+	if (head) {
+		head->prev_free = block;
+	}
+	ctrl->fl[fl].blocks[sl] = block;
+
+	ctrl->fl[fl].sl_bitmap |= 1U << sl;
+	ctrl->fl_bitmap |= 1U << fl;
+}
+
+static void block_remove(struct tlsf_control *ctrl, struct tlsf_block *block) {
+	int fl, sl;
+
+	mapping_insert(block_size(block), &fl, &sl);
+
+	if (block->next_free) {
+		block->next_free->prev_free = block->prev_free;
+	}
+	if (block->prev_free) {
+		block->prev_free->next_free = block->next_free;
+		return;
+	}
+
+	ctrl->fl[fl].blocks[sl] = block->next_free;
+	if (!block->next_free) {
+		ctrl->fl[fl].sl_bitmap &= ~(1U << sl);
+		if (!ctrl->fl[fl].sl_bitmap) {
+			ctrl->fl_bitmap &= ~(1U << fl);
+		}
+	}
+}
+
+static struct tlsf_block *block_find(struct tlsf_control *ctrl, size_t size) {
+	struct tlsf_block *block;
+	uint32_t map;
+	int fl, sl;
+
+	mapping_search(size, &fl, &sl);
+
+	if (fl < ctrl->fl_count) {
+		map = ctrl->fl[fl].sl_bitmap & (~0U << sl);
+		if (!map) {
+			map = ctrl->fl_bitmap & ~((2U << fl) - 1);
+			if (!map) {
+				goto good_fit;
+			}
+			fl = bit_ctz(map);
+			map = ctrl->fl[fl].sl_bitmap;
+		}
+		return ctrl->fl[fl].blocks[bit_ctz(map)];
+	}
+
+good_fit:
+	/* Every block of classes above @a size is too small. The head of the
+	 * class of @a size itself still may fit, e.g. the only block of a
+	 * fresh segment. */
+	mapping_insert(size, &fl, &sl);
+	if (fl >= ctrl->fl_count) {
+		return NULL;
+	}
+	block = ctrl->fl[fl].blocks[sl];
+
+	return (block && block_size(block) >= size) ? block : NULL;
+}
+
+/* Cuts @a size bytes from the beginning of @a block. The rest becomes a free
+ * block if it's large enough. */
+static void block_split(struct tlsf_control *ctrl, struct tlsf_block *block,
+		size_t size) {
+	struct tlsf_block *rest, *next;
+
+	if (block_size(block) < size + BLOCK_SIZE_MIN) {
+		return;
+	}
+
+	rest = (struct tlsf_block *) ((char *) block + size);
+	rest->size = (block_size(block) - size) | BLOCK_FREE;
+	rest->prev_phys = block;
+	block->size = size | (block->size & BLOCK_FLAGS);
+
+	next = block_next(rest);
+	next->prev_phys = rest;
+	next->size |= BLOCK_PREV_FREE;
+
+	block_insert(ctrl, rest);
+}
+
+/* Returns part of @a block starting at the first @a boundary aligned address.
+ * Leading part is left free. */
+static struct tlsf_block *block_align(struct tlsf_control *ctrl,
+		struct tlsf_block *block, size_t boundary) {
+	struct tlsf_block *aligned;
+	uintptr_t ptr;
+	size_t gap;
+
+	ptr = (uintptr_t) block_to_ptr(block);
+	gap = binalign_bound(ptr, boundary) - ptr;
+	if (gap == 0) {
+		return block;
+	}
+	if (gap < BLOCK_SIZE_MIN) {
+		gap = binalign_bound(ptr + BLOCK_SIZE_MIN, boundary) - ptr;
+	}
+
+	aligned = (struct tlsf_block *) ((char *) block + gap);
+	aligned->size = (block_size(block) - gap) | BLOCK_PREV_FREE;
+	aligned->prev_phys = block;
+	block->size = gap | (block->size & BLOCK_FLAGS) | BLOCK_FREE;
+
+	block_insert(ctrl, block);
+
+	return aligned;
+}
+
+void *tlsf_memalign(void *segment, size_t boundary, size_t size) {
+	struct tlsf_control *ctrl = tlsf_ctrl(segment);
+	struct tlsf_block *block;
+	size_t need;
+
+	if (size == 0) {
+		return NULL;
+	}
+
+	size = binalign_bound(size + BLOCK_HDR_SIZE, TLSF_ALIGN);
+	if (size < BLOCK_SIZE_MIN) {
+		size = BLOCK_SIZE_MIN;
+	}
+
+	if (boundary <= TLSF_ALIGN) {
+		boundary = 0;
+		need = size;
+	} else {
+		/* Place for the leading free block too */
+		need = size + boundary + BLOCK_SIZE_MIN;
+	}
+
+	sched_lock();
+
+	block = block_find(ctrl, need);
+	if (!block) {
+		sched_unlock();
+		return NULL;
+	}
+
+	block_remove(ctrl, block);
+	block->size &= ~BLOCK_FREE;
+
+	if (boundary) {
+		block = block_align(ctrl, block, boundary);
+	}
+
+	block_split(ctrl, block, size);
+	block_next(block)->size &= ~BLOCK_PREV_FREE;
+
+	sched_unlock();
+
+	return block_to_ptr(block);
+}
+
+static void block_release(struct tlsf_control *ctrl, struct tlsf_block *block) {
+	struct tlsf_block *next;
+
+	/* Header may stay inside of a merged block, keep it marked free */
+	block->size |= BLOCK_FREE;
+
+	/* Concatenate with neighbors */
+	if (block->size & BLOCK_PREV_FREE) {
+		struct tlsf_block *prev = block->prev_phys;
+
+		block_remove(ctrl, prev);
+		prev->size += block_size(block);
+		block = prev;
+	}
+
+	next = block_next(block);
+	if (block_is_free(next)) {
+		block_remove(ctrl, next);
+		block->size += block_size(next);
+		next = block_next(block);
+	}
+
+	next->prev_phys = block;
+	next->size |= BLOCK_PREV_FREE;
+
+	block_insert(ctrl, block);
+}
+
+void tlsf_free(void *segment, void *ptr) {
+	struct tlsf_control *ctrl = tlsf_ctrl(segment);
+	struct tlsf_block *block;
+
+	assert(ptr);
+
+	sched_lock();
+	block = ptr_to_block(ptr);
+
+	if (block_is_free(block)) {
+		sched_unlock();
+		printk("***** free(): the block not busy\n");
+		return; /* if we try to free block more than once */
+	}
+
+	afterfree(ptr, block_size(block) - BLOCK_HDR_SIZE);
+
+	block_release(ctrl, block);
+
+	sched_unlock();
+}
+
+size_t tlsf_usable_size(void *ptr) {
+	return block_size(ptr_to_block(ptr)) - BLOCK_HDR_SIZE;
+}
+
+int tlsf_extend(void *segment, size_t size, size_t new_size) {
+	struct tlsf_control *ctrl = tlsf_ctrl(segment);
+	struct tlsf_block *block, *sentinel;
+	char *end, *new_end;
+	int fl, sl;
+
+	end = (char *) segment + size;
+	end -= (uintptr_t) end % TLSF_ALIGN;
+	new_end = (char *) segment + new_size;
+	new_end -= (uintptr_t) new_end % TLSF_ALIGN;
+
+	/* Blocks of the grown segment must fit in the first level lists */
+	mapping_insert(new_end - (char *) ctrl, &fl, &sl);
+	if (fl >= ctrl->fl_count || new_end - end < BLOCK_SIZE_MIN) {
+		return -1;
+	}
+
+	sched_lock();
+
+	/* Old sentinel becomes a busy block which takes all appended memory */
+	block = (struct tlsf_block *) (end - BLOCK_HDR_SIZE);
+	block->size = (new_end - end) | (block->size & BLOCK_PREV_FREE);
+
+	sentinel = (struct tlsf_block *) (new_end - BLOCK_HDR_SIZE);
+	sentinel->size = 0;
+
+	block_release(ctrl, block);
+
+	sched_unlock();
+
+	return 0;
+}
+
+void tlsf_init(void *segment, size_t size) {
+	struct tlsf_control *ctrl = tlsf_ctrl(segment);
+	struct tlsf_block *block, *sentinel;
+	size_t ctrl_size;
+	char *end;
+	int fl, sl;
+
+	end = (char *) segment + size;
+	end -= (uintptr_t) end % TLSF_ALIGN;
+
+	mapping_insert(end - (char *) ctrl, &fl, &sl);
+	assert(fl < 32);
+
+	ctrl->fl_bitmap = 0;
+	/* Leave room for the segment to grow with tlsf_extend() */
+	ctrl->fl_count = min(fl + 1 + TLSF_GROW_LOG2, 32);
+	for (fl = 0; fl < ctrl->fl_count; fl++) {
+		ctrl->fl[fl].sl_bitmap = 0;
+		for (sl = 0; sl < SL_COUNT; sl++) {
+			ctrl->fl[fl].blocks[sl] = NULL;
+		}
+	}
+
+	ctrl_size = sizeof(*ctrl) + ctrl->fl_count * sizeof(ctrl->fl[0]);
+	block = (struct tlsf_block *) binalign_bound((uintptr_t) ctrl + ctrl_size,
+			TLSF_ALIGN);
+
+	/* The last block is persistently busy and has only a header */
+	sentinel = (struct tlsf_block *) (end - BLOCK_HDR_SIZE);
+	assert((char *) sentinel >= (char *) block + BLOCK_SIZE_MIN);
+
+	block->size = ((char *) sentinel - (char *) block) | BLOCK_FREE;
+	block->prev_phys = NULL;
+
+	sentinel->size = BLOCK_PREV_FREE;
+	sentinel->prev_phys = block;
+
+	block_insert(ctrl, block);
+}
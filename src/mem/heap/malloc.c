@@ -11,13 +11,39 @@
 #include <unistd.h>
 #include <util/dlist.h>
 
+#include <framework/mod/options.h>
 #include <kernel/task.h>
 #include <kernel/task/kernel_task.h>
 #include <kernel/task/resource/task_heap.h>
+#include <kernel/thread.h>
 #include <kernel/printk.h>
+#include <mem/page.h>
+#include <util/bit.h>
+#include <util/math.h>
 
 #include "mspace_malloc.h"
 
+/* Per-thread caches of small blocks. Blocks in caches are allocated in the
+ * task heap, so a thread can keep and reuse blocks freed by another one. */
+#define MCACHE_DEPTH     OPTION_GET(NUMBER, thread_cache_depth)
+/* Each class of a cache holds not more than this part of the heap */
+#define MCACHE_HEAP_PART 256
+#define MCACHE_MIN_LOG2  4
+#define MCACHE_CLASSES   5
+#define MCACHE_MAX_SIZE  (1 << (MCACHE_MIN_LOG2 + MCACHE_CLASSES - 1))
+
+struct malloc_cache_obj {
+	struct malloc_cache_obj *next;
+};
+
+struct malloc_cache {
+	struct {
+		struct malloc_cache_obj *head;
+		unsigned int count;
+		unsigned int depth;
+	} classes[MCACHE_CLASSES];
+};
+
 static struct dlist_head *task_self_mspace(void) {
 	struct task_heap *task_heap;
 
@@ -32,8 +58,166 @@ static struct dlist_head *kernel_task_mspace(void) {
 	return &task_heap->mm;
 }
 
+static void malloc_cache_drain(struct malloc_cache *cache, int c,
+		unsigned int n, struct dlist_head *mspace) {
+	struct malloc_cache_obj *obj;
+
+	while (n-- && (obj = cache->classes[c].head)) {
+		cache->classes[c].head = obj->next;
+		cache->classes[c].count--;
+		mspace_free(obj, mspace);
+	}
+}
+
+static void malloc_cache_refill(struct malloc_cache *cache, int c,
+		struct dlist_head *mspace) {
+	struct malloc_cache_obj *obj;
+	int i;
+
+	for (i = 0; i < (cache->classes[c].depth + 1) / 2; i++) {
+		obj = mspace_malloc(1 << (c + MCACHE_MIN_LOG2), mspace);
+		if (obj == NULL) {
+			break;
+		}
+		obj->next = cache->classes[c].head;
+		cache->classes[c].head = obj;
+		cache->classes[c].count++;
+	}
+}
+
+/* Small heaps can't afford to keep many blocks in each thread */
+static struct malloc_cache *malloc_cache_create(void) {
+	extern struct page_allocator *__heap_pgallocator;
+	struct malloc_cache *cache;
+	size_t part;
+	int c;
+
+	cache = mspace_calloc(1, sizeof(struct malloc_cache), task_self_mspace());
+	if (cache == NULL) {
+		return NULL;
+	}
+
+	part = __heap_pgallocator->pages_n * __heap_pgallocator->page_size
+			/ MCACHE_HEAP_PART;
+	for (c = 0; c < MCACHE_CLASSES; c++) {
+		cache->classes[c].depth = min(MCACHE_DEPTH,
+				part >> (c + MCACHE_MIN_LOG2));
+	}
+
+	return cache;
+}
+
+/* Returns blocks of the current thread cache to the heap */
+static int malloc_cache_flush(void) {
+	struct malloc_cache *cache = thread_self()->malloc_cache;
+	int c, n = 0;
+
+	if (cache == NULL) {
+		return 0;
+	}
+
+	for (c = 0; c < MCACHE_CLASSES; c++) {
+		n += cache->classes[c].count;
+		malloc_cache_drain(cache, c, cache->classes[c].count,
+				task_self_mspace());
+	}
+
+	return n;
+}
+
+static void *malloc_cache_get(size_t size) {
+	struct thread *t = thread_self();
+	struct malloc_cache_obj *obj;
+	int c;
+
+	if (t->malloc_cache == NULL) {
+		t->malloc_cache = malloc_cache_create();
+		if (t->malloc_cache == NULL) {
+			return NULL;
+		}
+	}
+
+	c = size <= (1 << MCACHE_MIN_LOG2) ? 0 : bit_fls(size - 1) - MCACHE_MIN_LOG2;
+
+	if (t->malloc_cache->classes[c].depth == 0) {
+		return NULL;
+	}
+
+	if (t->malloc_cache->classes[c].head == NULL) {
+		malloc_cache_refill(t->malloc_cache, c, task_self_mspace());
+	}
+
+	obj = t->malloc_cache->classes[c].head;
+	if (obj) {
+		t->malloc_cache->classes[c].head = obj->next;
+		t->malloc_cache->classes[c].count--;
+	}
+
+	return obj;
+}
+
+static int malloc_cache_put(void *ptr) {
+	struct malloc_cache *cache = thread_self()->malloc_cache;
+	struct malloc_cache_obj *obj = ptr;
+	size_t size;
+	int c;
+
+	if (cache == NULL) {
+		return 0;
+	}
+
+	/* Also filters out blocks of other tasks */
+	size = mspace_usable_size(ptr, task_self_mspace());
+	if (size < (1 << MCACHE_MIN_LOG2)) {
+		return 0;
+	}
+
+	c = bit_fls(size) - 1 - MCACHE_MIN_LOG2;
+	if (c >= MCACHE_CLASSES || cache->classes[c].depth == 0) {
+		return 0;
+	}
+
+	obj->next = cache->classes[c].head;
+	cache->classes[c].head = obj;
+	if (++cache->classes[c].count > cache->classes[c].depth) {
+		malloc_cache_drain(cache, c, (cache->classes[c].depth + 1) / 2,
+				task_self_mspace());
+	}
+
+	return 1;
+}
+
+void thread_malloc_cache_free(struct thread *t) {
+	struct malloc_cache *cache = t->malloc_cache;
+	struct dlist_head *mspace;
+	int c;
+
+	if (cache == NULL) {
+		return;
+	}
+	t->malloc_cache = NULL;
+
+	/* Heap of exiting task is already freed together with the cache */
+	if (task_get_status(t->task) & (TASKST_EXITED_MASK | TASKST_SIGNALD_MASK)) {
+		return;
+	}
+
+	mspace = &task_heap_get(t->task)->mm;
+	for (c = 0; c < MCACHE_CLASSES; c++) {
+		malloc_cache_drain(cache, c, cache->classes[c].count, mspace);
+	}
+	mspace_free(cache, mspace);
+}
+
 void *memalign(size_t boundary, size_t size) {
-	return mspace_memalign(boundary, size, task_self_mspace());
+	void *ptr;
+
+	ptr = mspace_memalign(boundary, size, task_self_mspace());
+	if (ptr == NULL && MCACHE_DEPTH && malloc_cache_flush()) {
+		ptr = mspace_memalign(boundary, size, task_self_mspace());
+	}
+
+	return ptr;
 }
 
 void *malloc(size_t size) {
@@ -43,7 +227,17 @@ void *malloc(size_t size) {
 		return NULL;
 	}
 
+	if (MCACHE_DEPTH && size <= MCACHE_MAX_SIZE) {
+		ptr = malloc_cache_get(size);
+		if (ptr) {
+			return ptr;
+		}
+	}
+
 	ptr = mspace_malloc(size, task_self_mspace());
+	if (ptr == NULL && MCACHE_DEPTH && malloc_cache_flush()) {
+		ptr = mspace_malloc(size, task_self_mspace());
+	}
 
 	if (ptr == NULL) {
 		SET_ERRNO(ENOMEM);
@@ -55,6 +249,11 @@ void *malloc(size_t size) {
 void free(void *ptr) {
 	if (ptr == NULL)
 		return;
+
+	if (MCACHE_DEPTH && malloc_cache_put(ptr)) {
+		return;
+	}
+
 	/* XXX this workaround for such situation:
 	 * module ConstructionGlobal invokes constructors inside kernel task for all applications,
 	 * and call malloc. After a while Qt application call realloc() on some memory previously
@@ -77,8 +276,12 @@ void *realloc(void *ptr, size_t size) {
 	if (ptr == NULL) {
 		return malloc(size);
 	}
+	ret = mspace_realloc(ptr, size, task_self_mspace());
+	if (ret == NULL && MCACHE_DEPTH && malloc_cache_flush()) {
+		ret = mspace_realloc(ptr, size, task_self_mspace());
+	}
 	/* XXX same as in free() above */
-	if (0 > err(ret = mspace_realloc(ptr, size, task_self_mspace()))) {
+	if (0 > err(ret)) {
 		printk("***** realloc: pointer is not in current task, try realloc in kernel task...\n");
 		if (0 > err(ret = mspace_realloc(ptr, size, kernel_task_mspace()))) {
 			assert(0);
@@ -89,7 +292,15 @@ void *realloc(void *ptr, size_t size) {
 }
 
 void *calloc(size_t nmemb, size_t size) {
+	void *ptr;
+
 	if (nmemb == 0 || size == 0)
 		return NULL; /* ok */
-	return mspace_calloc(nmemb, size, task_self_mspace());
+
+	ptr = mspace_calloc(nmemb, size, task_self_mspace());
+	if (ptr == NULL && MCACHE_DEPTH && malloc_cache_flush()) {
+		ptr = mspace_calloc(nmemb, size, task_self_mspace());
+	}
+
+	return ptr;
 }
@@ -5,6 +5,15 @@
  *    Segment structure:
  *    |struct mm_segment| *** space for bm ***|
  *
+ *    With use_tlsf option segments are managed by TLSF algorithm instead,
+ *    it has bounded allocation time.
+ *
+ *    Every page of a segment is mapped to the segment in a reverse map of
+ *    its page allocator, so free() finds the segment without walking the
+ *    list. New pages which follow a segment of the same mspace extend it.
+ *    Empty segments are kept at the end of the list and returned to the
+ *    page allocator when there are more than empty_segments_keep of them.
+ *
  *    TODO:
  *    Should be improved by usage of page_alloc when size is divisible by PAGE_SIZE()
  *    Also SLAB allocator can be used when size is 16, 32, 64, 128...
@@ -15,23 +24,47 @@
 
 #include <util/err.h>
 #include <errno.h>
+#include <stdint.h>
 #include <string.h>
 #include <unistd.h>
 
+#include <framework/mod/options.h>
 #include <mem/heap_bm.h>
+#include <mem/heap_tlsf.h>
 #include <mem/page.h>
 
 #include <util/dlist.h>
 #include <util/array.h>
+#include <util/binalign.h>
 
 #include <kernel/printk.h>
 #include <kernel/panic.h>
+#include <kernel/sched/sched_lock.h>
 
 /* TODO make it per task field */
 //static DLIST_DEFINE(task_mem_segments);
 
 //#define DEBUG
 
+#if OPTION_GET(BOOLEAN, use_tlsf)
+#define segment_init        tlsf_init
+#define segment_memalign    tlsf_memalign
+#define segment_free        tlsf_free
+#define segment_extend      tlsf_extend
+#define segment_usable_size tlsf_usable_size
+#else
+#define segment_init        bm_init
+#define segment_memalign    bm_memalign
+#define segment_free        bm_free
+#define segment_extend      bm_extend
+#define segment_usable_size bm_usable_size
+#endif
+
+#define MM_EMPTY_KEEP OPTION_GET(NUMBER, empty_segments_keep)
+
+/* Alignment of malloc() */
+#define MM_ALIGN 8
+
 extern struct page_allocator *__heap_pgallocator;
 extern struct page_allocator *__heap_pgallocator2 __attribute__((weak));
 static struct page_allocator ** const mm_page_allocs[] = {
@@ -39,11 +72,73 @@ static struct page_allocator ** const mm_page_allocs[] = {
 	&__heap_pgallocator2,
 };
 
+struct mm_segment {
+	struct dlist_head link;
+	size_t size;
+	struct dlist_head *mspace; /**<< Owner of the segment */
+	unsigned int used;         /**<< Number of allocated blocks */
+	size_t fail_size;          /**<< Smallest malloc() failed since last free */
+};
+
+/* Reverse maps from pages of allocators to segments owning them */
+static struct mm_segment **mm_rmaps[ARRAY_SIZE(mm_page_allocs)];
+
+static int mm_page_alloc_idx(void *ptr) {
+	int i;
+
+	for (i = 0; i < ARRAY_SIZE(mm_page_allocs); i++) {
+		if (mm_page_allocs[i] && *mm_page_allocs[i]
+				&& page_belong(*mm_page_allocs[i], ptr)) {
+			return i;
+		}
+	}
+
+	return -1;
+}
+
+static struct mm_segment **mm_rmap_slot(void *ptr) {
+	struct page_allocator *allocator;
+	int i;
+
+	i = mm_page_alloc_idx(ptr);
+	if (i < 0 || !mm_rmaps[i]) {
+		return NULL;
+	}
+
+	allocator = *mm_page_allocs[i];
+	return &mm_rmaps[i][((char *) ptr - (char *) allocator->pages_start)
+		/ allocator->page_size];
+}
+
+static void mm_rmap_set(void *pages, size_t size, struct mm_segment *mm) {
+	struct mm_segment **slot;
+	char *p;
+
+	for (p = pages; p < (char *) pages + size; p += PAGE_SIZE()) {
+		slot = mm_rmap_slot(p);
+		if (slot) {
+			*slot = mm;
+		}
+	}
+}
+
+static void mm_rmap_init(int i) {
+	struct page_allocator *allocator = *mm_page_allocs[i];
+	size_t len;
+
+	len = binalign_bound(allocator->pages_n * sizeof(*mm_rmaps[i]),
+			allocator->page_size);
+	mm_rmaps[i] = page_alloc_zero(allocator, len / allocator->page_size);
+}
+
 static void *mm_segment_alloc(int page_cnt) {
-	void *ret;
+	void *ret = NULL;
 	int i;
 	for (i = 0; i < ARRAY_SIZE(mm_page_allocs); i++) {
-		if (mm_page_allocs[i]) {
+		if (mm_page_allocs[i] && *mm_page_allocs[i]) {
+			if (!mm_rmaps[i]) {
+				mm_rmap_init(i);
+			}
 			ret = page_alloc(*mm_page_allocs[i], page_cnt);
 			if (ret) {
 				break;
@@ -63,11 +158,6 @@ static void mm_segment_free(void *segment, int page_cnt) {
 	}
 }
 
-struct mm_segment {
-	struct dlist_head link;
-	size_t size;
-};
-
 static inline int pointer_inside_segment(void *segment, size_t size, void *pointer) {
 	return (pointer > segment && pointer < (segment + size));
 }
@@ -77,30 +167,116 @@ static inline void *mm_to_segment(struct mm_segment *mm) {
 	return ((char *) mm + sizeof *mm);
 }
 
-static void *pointer_to_segment(void *ptr, struct dlist_head *mspace) {
+static struct mm_segment *pointer_to_segment(void *ptr, struct dlist_head *mspace) {
+	struct mm_segment **slot;
 	struct mm_segment *mm;
-	void *segment;
 
 	assert(ptr);
 	assert(mspace);
 
+	slot = mm_rmap_slot(ptr);
+	if (slot && *slot) {
+		mm = *slot;
+		if (mm->mspace == mspace
+				&& pointer_inside_segment(mm_to_segment(mm), mm->size, ptr)) {
+			return mm;
+		}
+	}
+
+	/* Segments may be missed in the map, e.g. after fork restored the heap */
 	dlist_foreach_entry(mm, mspace, link) {
-		segment = mm_to_segment(mm);
-		if (pointer_inside_segment(segment, mm->size, ptr)) {
-			return segment;
+		if (pointer_inside_segment(mm_to_segment(mm), mm->size, ptr)) {
+			return mm;
 		}
 	}
 
 	return NULL;
 }
 
+static void mm_segment_release(struct mm_segment *mm) {
+	dlist_del(&mm->link);
+	mm_rmap_set(mm, mm->size, NULL);
+	mm_segment_free(mm, mm->size / PAGE_SIZE());
+}
+
+static void mm_segment_get(struct mm_segment *mm, struct dlist_head *mspace) {
+	if (mm->used++ == 0) {
+		dlist_move(&mm->link, mspace);
+	}
+}
+
+static void mm_segment_put(struct mm_segment *mm, struct dlist_head *mspace) {
+	struct dlist_head *lnk;
+	int empty;
+
+	assert(mm->used > 0);
+	if (--mm->used > 0 || mm->mspace != mspace) {
+		return;
+	}
+
+	/* Empty segments are at the end of the list, so they are tried last */
+	dlist_del(&mm->link);
+	dlist_add_prev(&mm->link, mspace);
+
+	empty = 0;
+	for (lnk = mspace->prev; lnk != mspace; lnk = lnk->prev) {
+		if (member_cast_out(lnk, struct mm_segment, link)->used) {
+			break;
+		}
+		if (++empty > MM_EMPTY_KEEP) {
+			mm_segment_release(mm);
+			break;
+		}
+	}
+}
+
+/* Appends @a pages to a segment of @a mspace which ends right before them */
+static struct mm_segment *mm_segment_merge(void *pages, size_t size,
+		struct dlist_head *mspace) {
+	struct mm_segment **slot, *mm;
+
+	slot = mm_rmap_slot((char *) pages - 1);
+	if (!slot || !*slot) {
+		return NULL;
+	}
+
+	mm = *slot;
+	if (mm->mspace != mspace || (char *) mm + mm->size != pages
+			|| mm_page_alloc_idx(mm) != mm_page_alloc_idx(pages)) {
+		return NULL;
+	}
+
+	if (segment_extend(mm_to_segment(mm), mm->size - sizeof *mm,
+				mm->size + size - sizeof *mm)) {
+		return NULL;
+	}
+
+	mm->size += size;
+	mm->fail_size = SIZE_MAX;
+	mm_rmap_set(pages, size, mm);
+
+	return mm;
+}
+
 static void *mspace_do_alloc(size_t boundary, size_t size, struct dlist_head *mspace) {
 	struct mm_segment *mm;
+	void *block;
+
 	dlist_foreach_entry(mm, mspace, link) {
-		void *block = bm_memalign(mm_to_segment(mm), boundary, size);
+		/* Skip segments which recently failed smaller request */
+		if (boundary == MM_ALIGN && size >= mm->fail_size) {
+			continue;
+		}
+
+		block = segment_memalign(mm_to_segment(mm), boundary, size);
 		if (block != NULL) {
+			mm_segment_get(mm, mspace);
 			return block;
 		}
+
+		if (boundary == MM_ALIGN) {
+			mm->fail_size = size;
+		}
 	}
 
 	return NULL;
@@ -110,6 +286,7 @@ void *mspace_memalign(size_t boundary, size_t size, struct dlist_head *mspace) {
 	/* No corresponding heap was found */
 	struct mm_segment *mm;
 	size_t segment_pages_cnt;
+	void *pages;
 	void *block;
 
 	if (size == 0)
@@ -117,8 +294,11 @@ void *mspace_memalign(size_t boundary, size_t size, struct dlist_head *mspace) {
 
 	assert(mspace);
 
+	sched_lock();
+
 	block = mspace_do_alloc(boundary, size, mspace);
 	if (block) {
+		sched_unlock();
 		return block;
 	}
 
@@ -127,57 +307,94 @@ void *mspace_memalign(size_t boundary, size_t size, struct dlist_head *mspace) {
 	segment_pages_cnt = size / PAGE_SIZE() + boundary / PAGE_SIZE();
 	segment_pages_cnt += (size % PAGE_SIZE() + boundary % PAGE_SIZE() + 2 * PAGE_SIZE()) / PAGE_SIZE();
 
-	mm = mm_segment_alloc(segment_pages_cnt);
-	if (mm == NULL)
+	pages = mm_segment_alloc(segment_pages_cnt);
+	if (pages == NULL) {
+		sched_unlock();
 		return NULL;
+	}
 
-	mm->size = segment_pages_cnt * PAGE_SIZE();
-	dlist_head_init(&mm->link);
-	dlist_add_next(&mm->link, mspace);
-
-	bm_init(mm_to_segment(mm), mm->size - sizeof(struct mm_segment));
+	mm = mm_segment_merge(pages, segment_pages_cnt * PAGE_SIZE(), mspace);
+	if (mm == NULL) {
+		mm = pages;
+		mm->size = segment_pages_cnt * PAGE_SIZE();
+		mm->mspace = mspace;
+		mm->used = 0;
+		mm->fail_size = SIZE_MAX;
+		dlist_head_init(&mm->link);
+		dlist_add_next(&mm->link, mspace);
+
+		segment_init(mm_to_segment(mm), mm->size - sizeof(struct mm_segment));
+		mm_rmap_set(mm, mm->size, mm);
+	}
 
-	block = mspace_do_alloc(boundary, size, mspace);
+	block = segment_memalign(mm_to_segment(mm), boundary, size);
 	if (!block) {
 		panic("new memory block is not sufficient to allocate requested size");
 	}
+	mm_segment_get(mm, mspace);
+
+	sched_unlock();
 
 	return block;
 }
 
 void *mspace_malloc(size_t size, struct dlist_head *mspace) {
 	assert(mspace);
-	return mspace_memalign(8, size, mspace);
+	return mspace_memalign(MM_ALIGN, size, mspace);
 }
 
 int mspace_free(void *ptr, struct dlist_head *mspace) {
-	void *segment;
+	struct mm_segment *mm;
 
 	assert(ptr);
 	assert(mspace);
 
-	segment = pointer_to_segment(ptr, mspace);
+	sched_lock();
+
+	mm = pointer_to_segment(ptr, mspace);
 
-	if (segment != NULL) {
-		bm_free(segment, ptr);
+	if (mm != NULL) {
+		segment_free(mm_to_segment(mm), ptr);
+		mm->fail_size = SIZE_MAX;
+		mm_segment_put(mm, mspace);
 	} else {
 		/* No segment containing pointer @c ptr was found. */
 #ifdef DEBUG
 		printk("***** free(): incorrect address space\n");
 #endif
+		sched_unlock();
 		return -1;
 	}
 
+	sched_unlock();
+
 	return 0;
 }
 
+size_t mspace_usable_size(void *ptr, struct dlist_head *mspace) {
+	struct mm_segment *mm;
+	size_t size = 0;
+
+	assert(ptr);
+	assert(mspace);
+
+	sched_lock();
+	mm = pointer_to_segment(ptr, mspace);
+	if (mm != NULL) {
+		size = segment_usable_size(ptr);
+	}
+	sched_unlock();
+
+	return size;
+}
+
 void *mspace_realloc(void *ptr, size_t size, struct dlist_head *mspace) {
 	void *ret;
 
 	assert(mspace);
 	assert(size != 0 || ptr == NULL);
 
-	ret = mspace_memalign(8, size, mspace);
+	ret = mspace_memalign(MM_ALIGN, size, mspace);
 
 	if (ret == NULL) {
 		return NULL; /* error: errno set in malloc */
@@ -225,7 +442,7 @@ int mspace_fini(struct dlist_head *mspace) {
 	struct mm_segment *mm;
 
 	dlist_foreach_entry(mm, mspace, link) {
-		mm_segment_free(mm, mm->size / PAGE_SIZE());
+		mm_segment_release(mm);
 	}
 
 	return 0;
@@ -17,5 +17,7 @@ extern void *mspace_malloc(size_t size, struct dlist_head *mspace);
 extern int   mspace_free(void *ptr, struct dlist_head *mspace);
 extern void *mspace_calloc(size_t nmemb, size_t size, struct dlist_head *mspace);
 extern void *mspace_realloc(void *ptr, size_t size, struct dlist_head *mspace);
+/* Returns 0 if @a ptr is not allocated in @a mspace */
+extern size_t mspace_usable_size(void *ptr, struct dlist_head *mspace);
 
 #endif /* MSPACE_MALLOC_H_ */
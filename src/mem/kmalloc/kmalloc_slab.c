@@ -0,0 +1,75 @@
+/**
+ * @file
+ * @brief kmalloc on top of power of two slab caches
+ *
+ * @details Requests up to 2^max_order bytes are rounded up to the power of
+ * two and served by the cache of this size. Larger requests go to
+ * sysmalloc. The cache of a freed block is found by its page.
+ *
+ * @date 17.10.2026
+ */
+
+#include <stdio.h>
+
+#include <mem/kmalloc.h>
+#include <mem/misc/slab.h>
+#include <mem/sysmalloc.h>
+#include <util/bit.h>
+#include <util/math.h>
+
+#include <framework/mod/options.h>
+#include <embox/unit.h>
+
+#define KMALLOC_MIN_ORDER OPTION_GET(NUMBER, min_order)
+#define KMALLOC_MAX_ORDER OPTION_GET(NUMBER, max_order)
+#define KMALLOC_CACHES    (KMALLOC_MAX_ORDER - KMALLOC_MIN_ORDER + 1)
+
+EMBOX_UNIT_INIT(kmalloc_init);
+
+static cache_t *kmalloc_caches[KMALLOC_CACHES];
+
+void *kmalloc(size_t size) {
+	int order;
+
+	if (size == 0) {
+		return NULL;
+	}
+
+	order = max(bit_fls(size - 1), KMALLOC_MIN_ORDER);
+	if (order > KMALLOC_MAX_ORDER) {
+		return sysmalloc(size);
+	}
+
+	return cache_alloc(kmalloc_caches[order - KMALLOC_MIN_ORDER]);
+}
+
+void kfree(void *ptr) {
+	cache_t *cache;
+
+	if (ptr == NULL) {
+		return;
+	}
+
+	cache = cache_of(ptr);
+	if (cache) {
+		cache_free(cache, ptr);
+	} else {
+		sysfree(ptr);
+	}
+}
+
+static int kmalloc_init(void) {
+	char name[16];
+	int i;
+
+	for (i = 0; i < KMALLOC_CACHES; i++) {
+		snprintf(name, sizeof(name), "kmalloc-%d", 1 << (i + KMALLOC_MIN_ORDER));
+
+		kmalloc_caches[i] = cache_create(name, 1 << (i + KMALLOC_MIN_ORDER), 0);
+		if (!kmalloc_caches[i]) {
+			return -1;
+		}
+	}
+
+	return 0;
+}
@@ -0,0 +1,17 @@
+/**
+ * @file
+ * @brief kmalloc implemented directly with sysmalloc
+ *
+ * @date 17.10.2026
+ */
+
+#include <mem/kmalloc.h>
+#include <mem/sysmalloc.h>
+
+void *kmalloc(size_t size) {
+	return sysmalloc(size);
+}
+
+void kfree(void *ptr) {
+	sysfree(ptr);
+}
@@ -17,12 +17,16 @@
 #include <util/dlist.h>
 #include <util/slist.h>
 #include <util/binalign.h>
+#include <util/math.h>
 
 #include <mem/misc/slab.h>
 #include <mem/page.h>
 #include <mem/heap.h>
 #include <framework/mod/ops.h>
 #include <mem/phymem.h>
+#include <hal/cpu.h>
+#include <hal/ipl.h>
+#include <kernel/spinlock.h>
 
 #include <embox/unit.h>
 
@@ -47,6 +51,8 @@ typedef struct page_info {
 } page_info_t;
 
 static struct page_allocator *slab_pa;
+/* Slabs of different caches are allocated concurrently */
+static spinlock_t slab_pa_lock = SPIN_STATIC_UNLOCKED;
 
 #if 0
 # define SLAB_ALLOCATOR_DEBUG
@@ -54,6 +60,9 @@ static struct page_allocator *slab_pa;
 
 #define HEAP_SIZE OPTION_MODULE_GET(embox__mem__slab,NUMBER,heap_size)
 
+/* Objects moved between magazine and slabs at once */
+#define CACHE_MAGAZINE_BATCH ((CACHE_MAGAZINE_SIZE + 1) / 2)
+
 static char *heap_start_ptr;
 
 static page_info_t pages[HEAP_SIZE / PAGE_SIZE()];
@@ -80,7 +89,7 @@ void print_slab_info(cache_t *cachep, slab_t *slabp) {
 
 /* return information about page which an object belongs to */
 static page_info_t* ptr_to_page(void *objp) {
-	unsigned int index = ((unsigned int) objp - (unsigned int) heap_start_ptr)
+	unsigned int index = ((uintptr_t) objp - (uintptr_t) heap_start_ptr)
 			/ PAGE_SIZE();
 	return &(pages[index]);
 }
@@ -97,9 +106,13 @@ cache_t cache_chain = {
 	.slabs_partial = DLIST_INIT(cache_chain.slabs_partial),
 	.next = DLIST_INIT(cache_chain.next),
 	.slab_order = CACHE_CHAIN_SIZE,
-	.growing = true
+	.growing = true,
+	.lock = SPIN_STATIC_UNLOCKED,
 };
 
+/* Protects list of caches */
+static spinlock_t cache_list_lock = SPIN_STATIC_UNLOCKED;
+
 /** Initialize cache according to storage data in info structure */
 static int cache_member_init(const struct mod_member *info);
 
@@ -117,7 +130,11 @@ static int cache_member_init(const struct mod_member *info) {
  * @param slab_ptr the pointer to slab which must be deleted
  */
 static void cache_slab_destroy(cache_t *cachep, slab_t *slabp) {
-	page_free(slab_pa, slabp, slabp->inuse);
+	ipl_t ipl;
+
+	ipl = spin_lock_ipl(&slab_pa_lock);
+	page_free(slab_pa, slabp, 1 << cachep->slab_order);
+	spin_unlock_ipl(&slab_pa_lock, ipl);
 }
 
 /* init slab descriptor and slab objects */
@@ -141,8 +158,12 @@ static int cache_grow(cache_t *cachep) {
 	page_info_t *page;
 	slab_t * slabp;
 	size_t slab_size = 1 << cachep->slab_order;
+	ipl_t ipl;
 
-	if (!(slabp = (slab_t*) page_alloc(slab_pa, slab_size)))
+	ipl = spin_lock_ipl(&slab_pa_lock);
+	slabp = (slab_t*) page_alloc(slab_pa, slab_size);
+	spin_unlock_ipl(&slab_pa_lock, ipl);
+	if (!slabp)
 		return 0;
 
 	page = ptr_to_page(slabp);
@@ -193,6 +214,7 @@ static void cache_estimate(unsigned int gfporder, size_t size,
 
 int cache_init(cache_t *cachep, size_t obj_size, size_t obj_num) {
 	size_t left_over;
+	ipl_t ipl;
 
 	assert(cachep != NULL);
 
@@ -229,7 +251,8 @@ int cache_init(cache_t *cachep, size_t obj_size, size_t obj_num) {
 	dlist_init(&cachep->slabs_partial);
 	dlist_init(&cachep->slabs_free);
 	dlist_head_init(&cachep->next);
-	dlist_add_prev(&cachep->next, &(cache_chain.next));
+	spin_init(&cachep->lock, __SPIN_UNLOCKED);
+	memset(cachep->cpu, 0, sizeof(cachep->cpu));
 
 	/* Reserve memory for minimum count of objects (obj_num) */
 	while (obj_num >= cachep->num) {
@@ -241,6 +264,10 @@ int cache_init(cache_t *cachep, size_t obj_size, size_t obj_num) {
 		cache_grow(cachep);
 	}
 
+	ipl = spin_lock_ipl(&cache_list_lock);
+	dlist_add_prev(&cachep->next, &(cache_chain.next));
+	spin_unlock_ipl(&cache_list_lock, ipl);
+
 #ifdef SLAB_ALLOCATOR_DEBUG
 	printf("\n\nCreating cache with name \"%s\"\n", cachep->name);
 	printf("Object size: %d\n", cachep->obj_size);
@@ -285,29 +312,15 @@ static void destroy_slabs(cache_t *cachep, struct dlist_head *slabs) {
 	}
 }
 
-int cache_destroy(cache_t *cachep) {
-	assert(cachep);
-
-	destroy_slabs(cachep, &cachep->slabs_free);
-	destroy_slabs(cachep, &cachep->slabs_full);
-	destroy_slabs(cachep, &cachep->slabs_partial);
-
-	dlist_del(&cachep->next);
-	cache_free(&cache_chain, cachep);
-
-	return 0;
-}
-
-void *cache_alloc(cache_t *cachep) {
+/* Must be called with cache lock held */
+static void *cache_slab_alloc(cache_t *cachep, bool grow) {
 	slab_t * slabp;
 	void *objp;
 
-	assert(cachep);
-
 	/* getting slab */
 	if (dlist_empty(&cachep->slabs_partial)) {
 		if (dlist_empty(&cachep->slabs_free)) {
-			if (cachep->growing == false || !cache_grow(cachep)) {
+			if (!grow || cachep->growing == false || !cache_grow(cachep)) {
 				return NULL;
 			}
 		}
@@ -335,15 +348,11 @@ void *cache_alloc(cache_t *cachep) {
 	return objp;
 }
 
-void cache_free(cache_t *cachep, void* objp) {
+/* Must be called with cache lock held */
+static void cache_slab_free(cache_t *cachep, void *objp) {
 	slab_t * slabp;
 	page_info_t* page;
 
-	assert(cachep);
-
-	if (objp == NULL)
-		return;
-
 	page = ptr_to_page(objp);
 	slabp = GET_PAGE_SLAB(page);
 	slist_add_first_link(slist_link_init((struct slist_link *)objp),
@@ -364,21 +373,233 @@ void cache_free(cache_t *cachep, void* objp) {
 #endif
 }
 
+#if CACHE_MAGAZINE_SIZE
+static void *cache_magazine_pop(struct cache_cpu *cpu) {
+	return cpu->count ? cpu->objs[--cpu->count] : NULL;
+}
+
+static int cache_magazine_push(struct cache_cpu *cpu, void *objp) {
+	if (cpu->count == CACHE_MAGAZINE_SIZE) {
+		return -ENOSPC;
+	}
+
+	cpu->objs[cpu->count++] = objp;
+	return 0;
+}
+
+/* Refills magazine from slabs which are already allocated */
+static void cache_magazine_refill(cache_t *cachep, struct cache_cpu *cpu) {
+	while (cpu->count < CACHE_MAGAZINE_BATCH) {
+		cpu->objs[cpu->count] = cache_slab_alloc(cachep, false);
+		if (!cpu->objs[cpu->count]) {
+			break;
+		}
+		cpu->count++;
+	}
+}
+
+/* Returns @a n least recently freed objects of magazine to slabs */
+static void cache_magazine_flush(cache_t *cachep, struct cache_cpu *cpu,
+		unsigned int n) {
+	unsigned int i;
+
+	n = min(n, cpu->count);
+	for (i = 0; i < n; i++) {
+		cache_slab_free(cachep, cpu->objs[i]);
+	}
+
+	cpu->count -= n;
+	memmove(cpu->objs, cpu->objs + n, cpu->count * sizeof(cpu->objs[0]));
+}
+#else
+static inline void *cache_magazine_pop(struct cache_cpu *cpu) {
+	return NULL;
+}
+
+static inline int cache_magazine_push(struct cache_cpu *cpu, void *objp) {
+	return -ENOSPC;
+}
+
+static inline void cache_magazine_refill(cache_t *cachep,
+		struct cache_cpu *cpu) {
+}
+
+static inline void cache_magazine_flush(cache_t *cachep,
+		struct cache_cpu *cpu, unsigned int n) {
+}
+#endif
+
+int cache_destroy(cache_t *cachep) {
+	ipl_t ipl;
+	int i;
+
+	assert(cachep);
+
+	ipl = spin_lock_ipl(&cache_list_lock);
+	dlist_del(&cachep->next);
+	spin_unlock_ipl(&cache_list_lock, ipl);
+
+	/* Cache has no users any more, so magazines of all CPUs are flushed */
+	ipl = spin_lock_ipl(&cachep->lock);
+	{
+		for (i = 0; i < NCPU; i++) {
+			cache_magazine_flush(cachep, &cachep->cpu[i], cachep->cpu[i].count);
+		}
+
+		destroy_slabs(cachep, &cachep->slabs_free);
+		destroy_slabs(cachep, &cachep->slabs_full);
+		destroy_slabs(cachep, &cachep->slabs_partial);
+	}
+	spin_unlock_ipl(&cachep->lock, ipl);
+
+	cache_free(&cache_chain, cachep);
+
+	return 0;
+}
+
+void *cache_alloc(cache_t *cachep) {
+	struct cache_cpu *cpu;
+	void *objp;
+	ipl_t ipl;
+
+	assert(cachep);
+
+	ipl = ipl_save();
+	{
+		cpu = &cachep->cpu[cpu_get_id()];
+		cpu->allocs++;
+
+		objp = cache_magazine_pop(cpu);
+		if (objp) {
+			cpu->hits++;
+		} else {
+			spin_lock(&cachep->lock);
+			{
+				objp = cache_slab_alloc(cachep, true);
+				if (objp) {
+					cache_magazine_refill(cachep, cpu);
+				}
+			}
+			spin_unlock(&cachep->lock);
+		}
+	}
+	ipl_restore(ipl);
+
+	return objp;
+}
+
+void cache_free(cache_t *cachep, void* objp) {
+	struct cache_cpu *cpu;
+	ipl_t ipl;
+
+	assert(cachep);
+
+	if (objp == NULL)
+		return;
+
+	ipl = ipl_save();
+	{
+		cpu = &cachep->cpu[cpu_get_id()];
+		cpu->frees++;
+
+		if (0 != cache_magazine_push(cpu, objp)) {
+			spin_lock(&cachep->lock);
+			{
+				cache_slab_free(cachep, objp);
+				cache_magazine_flush(cachep, cpu, CACHE_MAGAZINE_BATCH);
+			}
+			spin_unlock(&cachep->lock);
+		}
+	}
+	ipl_restore(ipl);
+}
+
 int cache_shrink(cache_t *cachep) {
 	slab_t * slabp;
 	int ret = 0;
+	ipl_t ipl;
 
 	assert(cachep);
 
-	dlist_foreach_entry(slabp, &cachep->slabs_free, cache_link) {
-		dlist_del(&slabp->cache_link);
-		cache_slab_destroy(cachep, slabp);
-		ret++;
+	ipl = spin_lock_ipl(&cachep->lock);
+	{
+		cache_magazine_flush(cachep, &cachep->cpu[cpu_get_id()], CACHE_MAGAZINE_SIZE);
+
+		dlist_foreach_entry(slabp, &cachep->slabs_free, cache_link) {
+			dlist_del(&slabp->cache_link);
+			cache_slab_destroy(cachep, slabp);
+			ret++;
+		}
 	}
+	spin_unlock_ipl(&cachep->lock, ipl);
 
 	return ret;
 }
 
+cache_t *cache_of(void *objp) {
+	if (!slab_pa || !page_belong(slab_pa, objp)) {
+		return NULL;
+	}
+
+	return GET_PAGE_CACHE(ptr_to_page(objp));
+}
+
+static void cache_stats_fill(cache_t *cachep, struct cache_stats *st) {
+	slab_t *slabp;
+	int i;
+
+	memset(st, 0, sizeof(*st));
+	strncpy(st->name, cachep->name, sizeof(st->name) - 1);
+	st->obj_size = cachep->obj_size;
+	st->obj_per_slab = cachep->num;
+	st->slab_order = cachep->slab_order;
+
+	dlist_foreach_entry(slabp, &cachep->slabs_full, cache_link) {
+		st->slabs_full++;
+		st->objs_active += slabp->inuse;
+	}
+	dlist_foreach_entry(slabp, &cachep->slabs_partial, cache_link) {
+		st->slabs_partial++;
+		st->objs_active += slabp->inuse;
+	}
+	dlist_foreach_entry(slabp, &cachep->slabs_free, cache_link) {
+		st->slabs_free++;
+	}
+
+	/* Counters of other CPUs are read without synchronization */
+	for (i = 0; i < NCPU; i++) {
+		st->objs_cached += cachep->cpu[i].count;
+		st->allocs += cachep->cpu[i].allocs;
+		st->frees += cachep->cpu[i].frees;
+		st->hits += cachep->cpu[i].hits;
+	}
+	st->objs_active -= st->objs_cached;
+}
+
+int cache_stats_get(struct cache_stats *stats, int n) {
+	cache_t *cachep;
+	ipl_t ipl;
+	int cnt = 0;
+
+	ipl = spin_lock_ipl(&cache_list_lock);
+	{
+		cachep = &cache_chain;
+		do {
+			if (cnt < n) {
+				spin_lock(&cachep->lock);
+				cache_stats_fill(cachep, &stats[cnt]);
+				spin_unlock(&cachep->lock);
+			}
+			cnt++;
+
+			cachep = dlist_entry(cachep->next.next, cache_t, next);
+		} while (cachep != &cache_chain);
+	}
+	spin_unlock_ipl(&cache_list_lock, ipl);
+
+	return cnt;
+}
+
 static int slab_init(void) {
 	extern struct page_allocator *__heap_pgallocator;
 	int page_cnt = (HEAP_SIZE / PAGE_SIZE() - 2);
@@ -390,8 +611,12 @@ static int slab_init(void) {
 	}
 
 	slab_pa = page_allocator_init(heap_start_ptr, page_cnt * PAGE_SIZE(), PAGE_SIZE());
+	if (NULL == slab_pa) {
+		return -1;
+	}
 
-	heap_start_ptr += PAGE_SIZE();
+	/* Page allocator keeps its descriptor ahead of pages */
+	heap_start_ptr = slab_pa->pages_start;
 
 	return 0;
 }
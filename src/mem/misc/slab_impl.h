@@ -11,6 +11,9 @@
 
 #include <util/dlist.h>
 #include <framework/mod/self.h>
+#include <framework/mod/options.h>
+#include <hal/cpu.h>
+#include <kernel/spinlock.h>
 #include <stddef.h>
 #include <stdbool.h>
 
@@ -27,6 +30,24 @@
 #define CACHE_CHAIN_SIZE 1
 /** use to search a fit cache for object */
 #define MAX_OBJECT_ALIGN 0
+/** number of objects kept per CPU, 0 disables magazines */
+#define CACHE_MAGAZINE_SIZE \
+	OPTION_MODULE_GET(embox__mem__slab,NUMBER,magazine_size)
+
+/** per-CPU part of cache, accessed with local interrupts disabled */
+struct cache_cpu {
+	/** number of objects in magazine */
+	unsigned int count;
+	/** number of allocations and frees on this CPU */
+	unsigned long allocs;
+	unsigned long frees;
+	/** number of allocations served from magazine */
+	unsigned long hits;
+#if CACHE_MAGAZINE_SIZE
+	/** objects which can be allocated without taking cache lock */
+	void *objs[CACHE_MAGAZINE_SIZE];
+#endif
+};
 
 /** cache descriptor */
 struct cache {
@@ -48,6 +69,10 @@ struct cache {
 	unsigned int slab_order;
 	/** Indicates weather cache can growing or not. All caches are growing by default */
 	bool growing;
+	/** protects slab lists */
+	spinlock_t lock;
+	/** per-CPU magazines */
+	struct cache_cpu cpu[NCPU];
 };
 
 #define __CACHE_DEF(cache_nm, object_t, objects_nr) \
@@ -0,0 +1,348 @@
+/**
+ * @file
+ *
+ * @brief Buddy system page allocator
+ *
+ * @details Free pages are kept in blocks of 2^order pages aligned to their
+ * size, one free list per order. Allocation splits the smallest suitable
+ * block, free merges a block with its buddy while the buddy is free too.
+ * Requests which are not power of two return the tail of the block back.
+ *
+ * Single pages are served from per-CPU lists accessed with local interrupts
+ * disabled only; global lists are locked once per batch of pages. Pages in
+ * per-CPU lists are not counted in @c free of the allocator.
+ *
+ * @date 17.10.2026
+ */
+
+#include <stdint.h>
+#include <assert.h>
+#include <string.h>
+
+#include <hal/cpu.h>
+#include <hal/ipl.h>
+#include <kernel/spinlock.h>
+#include <util/binalign.h>
+#include <util/bit.h>
+#include <util/dlist.h>
+#include <util/math.h>
+#include <util/member.h>
+
+#include <mem/page.h>
+#include <embox/unit.h>
+
+#define BUDDY_ORDERS     OPTION_GET(NUMBER, max_order)
+#define BUDDY_HOT_PAGES  OPTION_GET(NUMBER, hot_pages)
+#define BUDDY_HOT_BATCH  ((BUDDY_HOT_PAGES + 1) / 2)
+
+/* State of the first page of a free block */
+#define BUDDY_FREE       0x80
+
+struct buddy_hot {
+	struct dlist_head pages;
+	unsigned int count;
+};
+
+struct buddy_allocator {
+	struct page_allocator pa;
+
+	spinlock_t lock;
+	struct dlist_head free_lists[BUDDY_ORDERS];
+	struct buddy_hot hot[NCPU];
+
+	uint8_t state[]; /* One per page */
+};
+
+static inline struct buddy_allocator *buddy_of(struct page_allocator *pa) {
+	return member_cast_out(pa, struct buddy_allocator, pa);
+}
+
+static inline unsigned int page_ptr2i(struct page_allocator *allocator, void *page) {
+	return ((char *) page - (char *) allocator->pages_start) / allocator->page_size;
+}
+
+static inline void *page_i2ptr(struct page_allocator *allocator, unsigned int i) {
+	return (char *) allocator->pages_start + i * allocator->page_size;
+}
+
+static void buddy_list_add(struct buddy_allocator *b, unsigned int i, int order) {
+	struct dlist_head *link = page_i2ptr(&b->pa, i);
+
+	dlist_head_init(link);
+	dlist_add_next(link, &b->free_lists[order]);
+	b->state[i] = BUDDY_FREE | order;
+}
+
+static void buddy_list_del(struct buddy_allocator *b, unsigned int i) {
+	dlist_del(page_i2ptr(&b->pa, i));
+	b->state[i] = 0;
+}
+
+static void buddy_free_block(struct buddy_allocator *b, unsigned int i, int order) {
+	unsigned int buddy;
+
+	for (; order < BUDDY_ORDERS - 1; order++) {
+		buddy = i ^ (1U << order);
+		if (buddy + (1U << order) > b->pa.pages_n
+				|| b->state[buddy] != (BUDDY_FREE | order)) {
+			break;
+		}
+		buddy_list_del(b, buddy);
+		i &= ~(1U << order);
+	}
+
+	buddy_list_add(b, i, order);
+}
+
+/* Splits the range into the largest aligned blocks */
+static void buddy_free_range(struct buddy_allocator *b, unsigned int i,
+		unsigned int page_q) {
+	int order;
+
+	while (page_q) {
+		order = min(bit_fls(page_q) - 1, BUDDY_ORDERS - 1);
+		if (i) {
+			order = min(order, bit_ctz(i));
+		}
+
+		buddy_free_block(b, i, order);
+		i += 1U << order;
+		page_q -= 1U << order;
+	}
+}
+
+static int buddy_alloc_block(struct buddy_allocator *b, int order) {
+	unsigned int i;
+	int o;
+
+	for (o = order; o < BUDDY_ORDERS; o++) {
+		if (!dlist_empty(&b->free_lists[o])) {
+			break;
+		}
+	}
+	if (o == BUDDY_ORDERS) {
+		return -1;
+	}
+
+	i = page_ptr2i(&b->pa, b->free_lists[o].next);
+	buddy_list_del(b, i);
+
+	while (o > order) {
+		o--;
+		buddy_list_add(b, i + (1U << o), o);
+	}
+
+	return i;
+}
+
+static int buddy_alloc(struct buddy_allocator *b, unsigned int page_q) {
+	int order, i;
+	ipl_t ipl;
+
+	order = page_q == 1 ? 0 : bit_fls(page_q - 1);
+	if (order >= BUDDY_ORDERS) {
+		return -1;
+	}
+
+	ipl = spin_lock_ipl(&b->lock);
+	{
+		i = buddy_alloc_block(b, order);
+		if (i >= 0) {
+			buddy_free_range(b, i + page_q, (1U << order) - page_q);
+			b->pa.free -= page_q * b->pa.page_size;
+		}
+	}
+	spin_unlock_ipl(&b->lock, ipl);
+
+	return i;
+}
+
+static void buddy_free(struct buddy_allocator *b, unsigned int i,
+		unsigned int page_q) {
+	ipl_t ipl;
+
+	ipl = spin_lock_ipl(&b->lock);
+	{
+		buddy_free_range(b, i, page_q);
+		b->pa.free += page_q * b->pa.page_size;
+	}
+	spin_unlock_ipl(&b->lock, ipl);
+}
+
+/* Must be called with local interrupts disabled */
+static void buddy_hot_drain(struct buddy_allocator *b, struct buddy_hot *hot,
+		unsigned int n) {
+	struct dlist_head *page;
+
+	spin_lock(&b->lock);
+	{
+		while (n-- && hot->count) {
+			page = hot->pages.next;
+			dlist_del(page);
+			hot->count--;
+			buddy_free_block(b, page_ptr2i(&b->pa, page), 0);
+			b->pa.free += b->pa.page_size;
+		}
+	}
+	spin_unlock(&b->lock);
+}
+
+static void *buddy_hot_alloc(struct buddy_allocator *b) {
+	struct buddy_hot *hot;
+	struct dlist_head *page = NULL;
+	ipl_t ipl;
+	int i;
+
+	ipl = ipl_save();
+	{
+		hot = &b->hot[cpu_get_id()];
+
+		if (hot->count == 0) {
+			spin_lock(&b->lock);
+			{
+				while (hot->count < BUDDY_HOT_BATCH
+						&& (i = buddy_alloc_block(b, 0)) >= 0) {
+					page = page_i2ptr(&b->pa, i);
+					dlist_head_init(page);
+					dlist_add_next(page, &hot->pages);
+					hot->count++;
+					b->pa.free -= b->pa.page_size;
+				}
+			}
+			spin_unlock(&b->lock);
+		}
+
+		if (hot->count) {
+			page = hot->pages.next;
+			dlist_del(page);
+			hot->count--;
+		}
+	}
+	ipl_restore(ipl);
+
+	return page;
+}
+
+static void buddy_hot_free(struct buddy_allocator *b, void *page) {
+	struct buddy_hot *hot;
+	ipl_t ipl;
+
+	ipl = ipl_save();
+	{
+		hot = &b->hot[cpu_get_id()];
+
+		dlist_head_init(page);
+		dlist_add_next(page, &hot->pages);
+		if (++hot->count > BUDDY_HOT_PAGES) {
+			buddy_hot_drain(b, hot, BUDDY_HOT_BATCH);
+		}
+	}
+	ipl_restore(ipl);
+}
+
+void *page_alloc(struct page_allocator *allocator, size_t page_q) {
+	struct buddy_allocator *b;
+	ipl_t ipl;
+	int i;
+
+	assert(allocator);
+
+	if (page_q == 0 || page_q > allocator->pages_n) {
+		return NULL;
+	}
+
+	b = buddy_of(allocator);
+
+	if (BUDDY_HOT_PAGES && page_q == 1) {
+		return buddy_hot_alloc(b);
+	}
+
+	i = buddy_alloc(b, page_q);
+	if (i < 0 && BUDDY_HOT_PAGES) {
+		/* Pages of this CPU list may complete a block */
+		ipl = ipl_save();
+		buddy_hot_drain(b, &b->hot[cpu_get_id()], BUDDY_HOT_PAGES);
+		ipl_restore(ipl);
+
+		i = buddy_alloc(b, page_q);
+	}
+
+	return i < 0 ? NULL : page_i2ptr(allocator, i);
+}
+
+void *page_alloc_zero(struct page_allocator *allocator, size_t page_q) {
+	char *page_p;
+
+	if (NULL != (page_p = page_alloc(allocator, page_q))) {
+		memset(page_p, 0, page_q * allocator->page_size);
+	}
+
+	return page_p;
+}
+
+void page_free(struct page_allocator *allocator, void *page, size_t page_q) {
+	struct buddy_allocator *b;
+
+	assert(allocator);
+	assert(page_belong(allocator, page));
+
+	b = buddy_of(allocator);
+
+	if (BUDDY_HOT_PAGES && page_q == 1) {
+		buddy_hot_free(b, page);
+		return;
+	}
+
+	buddy_free(b, page_ptr2i(allocator, page), page_q);
+}
+
+struct page_allocator *page_allocator_init(char *start, size_t len, size_t page_size) {
+	struct buddy_allocator *b;
+	char *pages_start, *end;
+	unsigned int pages;
+	int i;
+
+	if (len < page_size) {
+		return NULL;
+	}
+
+	end = start + len;
+	start = (char *) binalign_bound((uintptr_t) start, 16);
+	pages_start = (char *) binalign_bound((uintptr_t) start, page_size);
+	pages = (end - pages_start) / page_size;
+
+	while (sizeof(struct buddy_allocator) + pages > pages_start - start) {
+		pages_start += page_size;
+		pages --;
+		if (pages == 0) {
+			return NULL;
+		}
+	}
+
+	b = (struct buddy_allocator *) start;
+	b->pa.pages_start = pages_start;
+	b->pa.pages_n = pages;
+	b->pa.page_size = page_size;
+	b->pa.free = pages * page_size;
+	b->pa.bitmap_len = 0;
+	b->pa.bitmap = NULL;
+
+	spin_init(&b->lock, __SPIN_UNLOCKED);
+	for (i = 0; i < BUDDY_ORDERS; i++) {
+		dlist_init(&b->free_lists[i]);
+	}
+	for (i = 0; i < NCPU; i++) {
+		dlist_init(&b->hot[i].pages);
+		b->hot[i].count = 0;
+	}
+
+	memset(b->state, 0, pages);
+	buddy_free_range(b, 0, pages);
+
+	return &b->pa;
+}
+
+int page_belong(struct page_allocator *allocator, void *page) {
+	void *pages_end = allocator->pages_start + allocator->pages_n * allocator->page_size;
+	return allocator->pages_start <= page && page < pages_end;
+}
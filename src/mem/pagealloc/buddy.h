@@ -0,0 +1,14 @@
+/*
+ * @file
+ *
+ * @date 17.10.2026
+ */
+
+#ifndef BUDDY_H_
+#define BUDDY_H_
+
+
+#define PAGE_SIZE() OPTION_MODULE_GET(embox__mem__buddy,NUMBER,page_size)
+
+
+#endif /* BUDDY_H_ */
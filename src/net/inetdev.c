@@ -21,6 +21,7 @@
 
 POOL_DEF(inetdev_pool, struct in_device, MODOPS_AMOUNT_INTERFACE);
 static DLIST_DEFINE(inetdev_list);
+static unsigned int inetdev_addr_gen;
 
 int inetdev_register_dev(struct net_device *dev) {
 	int ret;
@@ -122,10 +123,15 @@ int inetdev_set_addr(struct in_device *in_dev, in_addr_t addr) {
 	}
 
 	in_dev->ifa_address = addr;
+	inetdev_addr_gen++;
 
 	return 0;
 }
 
+unsigned int inetdev_get_addr_gen(void) {
+	return inetdev_addr_gen;
+}
+
 int inetdev_set_mask(struct in_device *in_dev, in_addr_t mask) {
 	if (in_dev == NULL) {
 		return -EINVAL;
@@ -16,13 +16,17 @@
 #include <stdio.h>
 #include <string.h>
 #include <util/dlist.h>
+#include <util/math.h>
 #include <net/l0/net_rx.h>
+#include <net/l0/net_entry.h>
 #include <embox/unit.h>
 
 #include <kernel/sched/schedee_priority.h>
 #include <kernel/lthread/lthread.h>
 
 #define NETIF_RX_HND_PRIORITY OPTION_GET(NUMBER, hnd_priority)
+#define NETIF_RX_WEIGHT       OPTION_GET(NUMBER, weight)
+#define NETIF_RX_BUDGET       OPTION_GET(NUMBER, budget)
 
 EMBOX_UNIT_INIT(net_entry_init);
 
@@ -44,33 +48,70 @@ static void netif_rx_queued(struct net_device *dev) {
 	ipl_restore(sp);
 }
 
-static void netif_rx_dequeued(struct net_device *dev) {
+static struct net_device * netif_rx_dequeue(void) {
 	ipl_t sp;
-
-	assert(dev != NULL);
+	struct net_device *dev;
 
 	sp = ipl_save();
 	{
-		assert(!dlist_empty(&dev->rx_lnk));
-		dlist_del_init(&dev->rx_lnk);
+		dev = dlist_first_entry_or_null(&netif_rx_list, struct net_device,
+				rx_lnk);
+		if (dev != NULL) {
+			dlist_del_init(&dev->rx_lnk);
+		}
 	}
 	ipl_restore(sp);
+
+	return dev;
 }
 
-static void netif_poll(struct net_device *dev) {
+/* Packets passed by net_driver::poll, handled as one batch after it */
+static struct sk_buff_head netif_rx_batch;
+
+static int netif_poll(struct net_device *dev, int budget) {
 	struct sk_buff *skb;
+	int done;
 
-	while ((skb = skb_queue_pop(&dev->dev_queue)) != NULL) {
-		net_rx(skb);
+	if ((dev->drv_ops != NULL) && (dev->drv_ops->poll != NULL)) {
+		done = dev->drv_ops->poll(dev, budget);
 	}
+	else {
+		done = 0;
+		while ((done < budget)
+				&& ((skb = skb_queue_pop(&dev->dev_queue)) != NULL)) {
+			skb_queue_push(&netif_rx_batch, skb);
+			++done;
+		}
+	}
+
+	net_rx_list(&netif_rx_batch);
+
+	return done;
 }
 
+/**
+ * Poll devices round-robin, at most NETIF_RX_WEIGHT packets from a device
+ * per turn and NETIF_RX_BUDGET packets per run. Devices are dequeued
+ * before polling, so interrupt arriving meanwhile queues them again.
+ */
 static int netif_rx_action(struct lthread *self) {
 	struct net_device *dev;
+	int budget, weight, done;
+
+	budget = NETIF_RX_BUDGET;
+	while ((budget > 0) && ((dev = netif_rx_dequeue()) != NULL)) {
+		weight = min(budget, NETIF_RX_WEIGHT);
+		done = netif_poll(dev, weight);
+		budget -= done;
+		if (done >= weight) {
+			/* may have more packets, queue after the others */
+			netif_rx_queued(dev);
+		}
+	}
 
-	dlist_foreach_entry(dev, &netif_rx_list, rx_lnk) {
-		netif_poll(dev);
-		netif_rx_dequeued(dev);
+	if (!dlist_empty(&netif_rx_list)) {
+		/* let other lthreads run before the next round */
+		lthread_launch(self);
 	}
 
 	return 0;
@@ -97,7 +138,20 @@ int netif_rx(void *data) {
 	return NET_RX_SUCCESS;
 }
 
+void netif_poll_schedule(struct net_device *dev) {
+	netif_rx_queued(dev);
+
+	lthread_launch(&netif_rx_irq_handler);
+}
+
+int netif_receive_skb(struct sk_buff *skb) {
+	assert(skb != NULL);
+	skb_queue_push(&netif_rx_batch, skb);
+	return NET_RX_SUCCESS;
+}
+
 static int net_entry_init(void) {
+	skb_queue_init(&netif_rx_batch);
 	lthread_init(&netif_rx_irq_handler, &netif_rx_action);
 	schedee_priority_set(&netif_rx_irq_handler.schedee, NETIF_RX_HND_PRIORITY);
 	return 0;
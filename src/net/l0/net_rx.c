@@ -16,30 +16,33 @@
 #include <net/netdevice.h>
 #include <net/skbuff.h>
 #include <net/socket/packet.h>
+#include <net/sock_wait.h>
 #include <util/log.h>
 
 #define LOG_LEVEL OPTION_GET(NUMBER, log_level)
 
-int net_rx(struct sk_buff *skb) {
-	struct net_header_info hdr_info;
-	const struct net_pack *npack;
-
+/**
+ * L2 processing and delivery to packet sockets
+ * @return skb to pass to L3 layer or NULL if it's consumed
+ */
+static struct sk_buff * net_rx_l2(struct sk_buff *skb,
+		struct net_header_info *hdr_info) {
 	/* check L2 header size */
 	assert(skb != NULL);
 	assert(skb->dev != NULL);
 	if (skb->len < skb->dev->hdr_len) {
 		log_error("net_rx: %p invalid length %zu\n", skb, skb->len);
 		skb_free(skb);
-		return 0; /* error: invalid size */
+		return NULL; /* error: invalid size */
 	}
 
 	/* parse L2 header */
 	assert(skb->dev->ops != NULL);
 	assert(skb->dev->ops->parse_hdr != NULL);
-	if (0 != skb->dev->ops->parse_hdr(skb, &hdr_info)) {
+	if (0 != skb->dev->ops->parse_hdr(skb, hdr_info)) {
 		log_error("net_rx: %p can't parse header\n", skb);
 		skb_free(skb);
-		return 0; /* error: can't parse L2 header */
+		return NULL; /* error: can't parse L2 header */
 	}
 
 	/* check recipient on L2 layer */
@@ -47,7 +50,7 @@ int net_rx(struct sk_buff *skb) {
 	default:
 		log_debug("net_rx: %p not for us\n", skb);
 		skb_free(skb);
-		return 0; /* ok, but: not for us */
+		return NULL; /* ok, but: not for us */
 	case PACKET_HOST:
 	case PACKET_LOOPBACK:
 	case PACKET_BROADCAST:
@@ -59,23 +62,27 @@ int net_rx(struct sk_buff *skb) {
 	assert(skb->mac.raw != NULL);
 	skb->nh.raw = skb->mac.raw + skb->dev->hdr_len;
 
-	log_debug("net_rx: %p len %zu type %#.6hx\n", skb, skb->len, hdr_info.type);
+	log_debug("net_rx: %p len %zu type %#.6hx\n", skb, skb->len, hdr_info->type);
 
 	/* decrypt packet */
 	skb = net_decrypt(skb);
 	if (skb == NULL) {
-		return 0; /* error: something wrong :( */
+		return NULL; /* error: something wrong :( */
 	}
 
-	sock_packet_add(skb, hdr_info.type);
+	sock_packet_add(skb, hdr_info->type);
+
+	return skb;
+}
 
+static int net_rx_l3(struct sk_buff *skb, const struct net_pack *npack,
+		unsigned short type) {
 	/* lookup handler for L3 layer
 	 * We check if L3 handler exists only after sock_packet_add(), because of
 	 * we must pass skb to all packet sockets even though L3 header is not valid
 	 * from Embox kernel's point of view. */
-	npack = net_pack_lookup(hdr_info.type);
 	if (npack == NULL) {
-		log_debug("net_rx: %p unknown type %#.6hx\n", skb, hdr_info.type);
+		log_debug("net_rx: %p unknown type %#.6hx\n", skb, type);
 		skb_free(skb);
 		return 0; /* ok, but: not supported */
 	}
@@ -83,3 +90,51 @@ int net_rx(struct sk_buff *skb) {
 	/* handling on L3 layer */
 	return npack->rcv_pack(skb, skb->dev);
 }
+
+int net_rx(struct sk_buff *skb) {
+	struct net_header_info hdr_info;
+
+	skb = net_rx_l2(skb, &hdr_info);
+	if (skb == NULL) {
+		return 0;
+	}
+
+	return net_rx_l3(skb, net_pack_lookup(hdr_info.type), hdr_info.type);
+}
+
+int net_rx_list(struct sk_buff_head *skbs) {
+	struct net_header_info hdr_info;
+	struct sk_buff *skb;
+	const struct net_pack *npack;
+	unsigned short type;
+	int count;
+
+	assert(skbs != NULL);
+
+	/* traffic usually comes in runs of one protocol */
+	npack = NULL;
+	type = 0;
+	count = 0;
+
+	sock_notify_batch_begin();
+	{
+		while ((skb = skb_queue_pop(skbs)) != NULL) {
+			++count;
+
+			skb = net_rx_l2(skb, &hdr_info);
+			if (skb == NULL) {
+				continue;
+			}
+
+			if ((npack == NULL) || (type != hdr_info.type)) {
+				type = hdr_info.type;
+				npack = net_pack_lookup(type);
+			}
+
+			net_rx_l3(skb, npack, type);
+		}
+	}
+	sock_notify_batch_end();
+
+	return count;
+}
@@ -42,7 +42,11 @@ static int nt_build_hdr(struct sk_buff *skb,
 	}
 	if (hdr_info->dst_hw == NULL) {
 		if (hdr_info->dst_p != NULL) {
-			ret = neighbour_get_haddr(hdr_info->type,
+			ret = hdr_info->nbr_cache != NULL
+				? neighbour_get_haddr_cached(hdr_info->nbr_cache,
+					hdr_info->type, hdr_info->dst_p, dev, dev->type,
+					ARRAY_SIZE(dst_haddr), &dst_haddr[0])
+				: neighbour_get_haddr(hdr_info->type,
 					hdr_info->dst_p, dev, dev->type,
 					ARRAY_SIZE(dst_haddr), &dst_haddr[0]);
 			if (ret == 0) {
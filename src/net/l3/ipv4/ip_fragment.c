@@ -17,7 +17,9 @@
 #include <net/l3/ipv4/ip.h>
 
 #include <mem/objalloc.h>
-#include <kernel/time/timer.h>
+#include <hal/clock.h>
+#include <kernel/time/time.h>
+#include <linux/list.h>
 
 #include <util/math.h>
 #include <util/dlist.h>
@@ -26,13 +28,17 @@
 
 #define MAX_BUFS_CNT       OPTION_GET(NUMBER, max_uncomplete_cnt)
 #define IP_FRAGMENTED_SUPP OPTION_GET(NUMBER, ip_fragmented_support)
+#define FRAG_HASH_SIZE     OPTION_GET(NUMBER, frag_hash_size)
+#define FRAG_MEM_MAX       OPTION_GET(NUMBER, frag_mem_max)
+#define FRAG_TIMEOUT       OPTION_GET(NUMBER, frag_timeout)
 
 /**
  * Datagram receive buffer
  */
 struct dgram_buf {
-	struct sk_buff_head fragments;
-	struct dlist_head   next_buf; /* linked list pointers */
+	struct sk_buff_head fragments; /* sorted by offset, not overlapped */
+	struct dlist_head   next_buf;  /* link in list of all buffers, oldest first */
+	struct dgram_buf   *hash_next; /* next buffer in hash bucket */
 	struct buf_id {
 		in_addr_t         saddr;
 		in_addr_t         daddr;
@@ -42,23 +48,22 @@ struct dgram_buf {
 	int               is_last_frag_received;
 	int               meat;
 	int               len; /* total length of original datagram */
-	struct sys_timer *timer;
-	int               buf_ttl;
+	size_t            mem; /* memory used by fragments */
+	clock_t           expires;
 };
 
 static DLIST_DEFINE(__dgram_buf_list);
+static struct dgram_buf *__dgram_buf_hash[FRAG_HASH_SIZE];
+static size_t __dgram_mem; /* memory used by all fragments */
 
 OBJALLOC_DEF(__dgram_bufs, struct dgram_buf, MAX_BUFS_CNT);
 
 #define df_flag(skb) (ntohs(skb->nh.iph->frag_off) & IP_DF)
 
-#define TIMER_TICK 1000
-
 static struct dgram_buf *ip_buf_create(struct iphdr *iph);
 static void buf_delete(struct dgram_buf *buf);
-static void ip_buf_add_skb(struct dgram_buf *buf, struct sk_buff *skb);
+static int ip_buf_add_skb(struct dgram_buf *buf, struct sk_buff *skb);
 static struct sk_buff *build_packet(struct dgram_buf *buf);
-//static void ttl_handler(struct sys_timer *timer, void *param);
 
 static inline int ip_offset(struct sk_buff *skb) {
 	int offset;
@@ -70,28 +75,27 @@ static inline int ip_offset(struct sk_buff *skb) {
 	return offset;
 }
 
-#if 0
-static void ttl_handler(struct sys_timer *timer, void *param) {
-	struct dgram_buf *buf;
+static inline int ip_frag_data_len(struct sk_buff *skb) {
+	return skb->len - (skb->h.raw - skb->mac.raw);
+}
 
-	buf = (struct dgram_buf *)param;
+static inline struct dgram_buf **ip_buf_bucket(in_addr_t saddr,
+		in_addr_t daddr, uint16_t id, uint8_t protocol) {
+	uint32_t key;
 
-	if (buf->buf_ttl == 0) {
-		/*icmp_send(buf->next_skbuff, ICMP_TIME_EXCEEDED, ICMP_EXC_FRAGTIME, 0);*/
-		buf_delete(buf);
-		timer_close(timer);
-	} else {
-		*(volatile int *)buf->buf_ttl -= 1;
-	}
+	key = saddr ^ daddr ^ ((uint32_t)id << 8) ^ protocol;
+	key ^= key >> 16;
+
+	return &__dgram_buf_hash[key % FRAG_HASH_SIZE];
 }
-#endif
 
 static inline struct dgram_buf *ip_find(struct iphdr *iph) {
 	struct dgram_buf *buf;
 
 	assert(iph);
 
-	dlist_foreach_entry(buf, &__dgram_buf_list, next_buf) {
+	for (buf = *ip_buf_bucket(iph->saddr, iph->daddr, iph->id, iph->proto);
+			buf != NULL; buf = buf->hash_next) {
 		if (buf->buf_id.daddr == iph->daddr
 			&& buf->buf_id.saddr == iph->saddr
 			&& buf->buf_id.protocol == iph->proto
@@ -103,82 +107,132 @@ static inline struct dgram_buf *ip_find(struct iphdr *iph) {
 	return NULL;
 }
 
-static void ip_buf_add_skb(struct dgram_buf *buf, struct sk_buff *skb) {
+/**
+ * Drops expired buffers and then the oldest ones while more than @a mem
+ * bytes are needed, except @a keep
+ */
+static void ip_buf_evict(size_t mem, struct dgram_buf *keep) {
+	struct dgram_buf *buf;
+	clock_t now;
+
+	now = clock_sys_ticks();
+
+	dlist_foreach_entry(buf, &__dgram_buf_list, next_buf) {
+		if (buf == keep) {
+			continue;
+		}
+		if (((long)(now - buf->expires) < 0)
+				&& (__dgram_mem + mem <= FRAG_MEM_MAX)) {
+			break;
+		}
+		buf_delete(buf);
+	}
+}
+
+/**
+ * Inserts fragment keeping the queue sorted
+ *
+ * @return 0 on success
+ * @return -EEXIST if the fragment overlaps received data (it's not queued)
+ */
+static int ip_buf_add_skb(struct dgram_buf *buf, struct sk_buff *skb) {
+	struct sk_buff *iter;
 	int offset, data_len, end;
 
 	assert(buf && skb);
 
-	buf->buf_ttl = max(buf->buf_ttl, ntohs(skb->nh.iph->ttl));
-
 	offset = ip_offset(skb);
-
-	data_len = skb->len - (skb->h.raw - skb->mac.raw);
+	data_len = ip_frag_data_len(skb);
 	end = offset + data_len;
 
-	skb_queue_push(&buf->fragments, skb);
+	for (iter = buf->fragments.next;
+			iter != (struct sk_buff *)&buf->fragments;
+			iter = iter->lnk.next) {
+		if (ip_offset(iter) >= end) {
+			break;
+		}
+		if (ip_offset(iter) + ip_frag_data_len(iter) > offset) {
+			return -EEXIST; /* duplicate or overlapping fragment */
+		}
+	}
+	/* put before @a iter, it's the queue head if there is no such */
+	list_move_tail((struct list_head *)skb, (struct list_head *)iter);
 
 	buf->meat += data_len;
 	if (end > buf->len) {
 		buf->len = end;
 	}
+	buf->mem += skb->len;
+	__dgram_mem += skb->len;
+
+	return 0;
 }
 
+/**
+ * Builds datagram in place of its first fragment, the others are
+ * appended once. There are no scatter-gather sk_buffs, so the data must
+ * be contiguous for consumers.
+ */
 static struct sk_buff *build_packet(struct dgram_buf *buf) {
 	struct sk_buff *skb, *skb_iter;
-	int offset = 0;
-	int ihlen;
+	struct net_device *dev;
+	int ihlen, nhoff;
 
 	assert(buf);
 
-	skb_iter = skb_queue_front(&buf->fragments);
-	assert(skb_iter);
-
-	ihlen = (skb_iter->h.raw - skb_iter->mac.raw);
-	skb = skb_alloc(buf->len + ihlen);
-	/* Strange:
-	 *	- it might return NULL, because length is too big now.
-	 *	- ihlen has upper limit. So it's more wise to has such
-	 *	amount of extra space in the pool (NOT shared with ICMP)
-	 */
+	skb = skb_queue_pop(&buf->fragments);
 	assert(skb);
+	assert(ip_offset(skb) == 0);
 
-	/* copy and concatenate dat. Queue is NOT sorted by offset! */
-	while((skb_iter = skb_queue_pop(&buf->fragments))) {
-		offset = ip_offset(skb_iter);
-		if (offset == 0) {
-			memcpy(skb->mac.raw, skb_iter->mac.raw, skb_iter->len);
-			/* Terrible. Some pointers might be NULL here. sk pointer is omitted */
-			skb->nh.raw = skb->mac.raw + (skb_iter->nh.raw - skb_iter->mac.raw);
-			skb->h.raw = skb->nh.raw + IP_HEADER_SIZE(ip_hdr(skb_iter));
-			skb->nh.iph->tot_len = htons(buf->len + IP_HEADER_SIZE(ip_hdr(skb_iter)));
-			skb->dev = skb_iter->dev;
-		}
-		memcpy(skb->mac.raw + ihlen + offset, skb_iter->mac.raw + ihlen,
-				skb_iter->len - ihlen);
+	ihlen = skb->h.raw - skb->mac.raw;
+	nhoff = skb->nh.raw - skb->mac.raw;
+	dev = skb->dev;
+
+	/* may move data to the bigger size class of skb_data, frees skb on fail */
+	if (NULL == skb_realloc(buf->len + ihlen, skb)) {
+		buf_delete(buf);
+		return NULL;
+	}
+	skb->dev = dev;
+	skb->nh.raw = skb->mac.raw + nhoff;
+	skb->h.raw = skb->mac.raw + ihlen;
+	skb->nh.iph->tot_len = htons(buf->len + (ihlen - nhoff));
+
+	while ((skb_iter = skb_queue_pop(&buf->fragments))) {
+		memcpy(skb->h.raw + ip_offset(skb_iter), skb_iter->h.raw,
+				ip_frag_data_len(skb_iter));
 		skb_free(skb_iter);
 	}
 
-	/* recalculate length */
-	skb->len = buf->len + ihlen;
 	buf_delete(buf);
 
 	return skb;
 }
 
 static struct dgram_buf *ip_buf_create(struct iphdr *iph) {
-	struct dgram_buf *buf;
-	//sys_timer_t *timer;
+	struct dgram_buf *buf, **bucket;
 
 	assert(iph);
 
 	buf = (struct dgram_buf*) objalloc(&__dgram_bufs);
-	if (!buf)
-		return NULL;
+	if (!buf) {
+		/* drop the oldest datagram */
+		buf = dlist_first_entry_or_null(&__dgram_buf_list,
+				struct dgram_buf, next_buf);
+		if (!buf) {
+			return NULL;
+		}
+		buf_delete(buf);
+		buf = (struct dgram_buf*) objalloc(&__dgram_bufs);
+		assert(buf);
+	}
 
-	//timer_set(&timer, TIMER_ONESHOT, TIMER_TICK, ttl_handler, (void *)buf);
 	skb_queue_init(&buf->fragments);
 	dlist_head_init(&buf->next_buf);
 	dlist_add_prev(&buf->next_buf, &__dgram_buf_list);
+	bucket = ip_buf_bucket(iph->saddr, iph->daddr, iph->id, iph->proto);
+	buf->hash_next = *bucket;
+	*bucket = buf;
 
 	buf->buf_id.protocol = iph->proto;
 	buf->buf_id.id = iph->id;
@@ -187,13 +241,24 @@ static struct dgram_buf *ip_buf_create(struct iphdr *iph) {
 	buf->len = 0;
 	buf->is_last_frag_received = 0;
 	buf->meat = 0;
-	//buf->timer = timer;
-	buf->buf_ttl = MSL;
+	buf->mem = 0;
+	buf->expires = clock_sys_ticks() + ms2jiffies(FRAG_TIMEOUT);
 
 	return buf;
 }
 
 static void buf_delete(struct dgram_buf *buf) {
+	struct dgram_buf **prev;
+
+	prev = ip_buf_bucket(buf->buf_id.saddr, buf->buf_id.daddr,
+			buf->buf_id.id, buf->buf_id.protocol);
+	while (*prev != buf) {
+		assert(*prev != NULL);
+		prev = &(*prev)->hash_next;
+	}
+	*prev = buf->hash_next;
+
+	__dgram_mem -= buf->mem;
 	skb_queue_purge(&buf->fragments);
 	dlist_del(&buf->next_buf);
 	objfree(&__dgram_bufs, (void*)buf);
@@ -235,15 +300,34 @@ struct sk_buff *ip_defrag(struct sk_buff *skb) {
 	}
 
 	buf = ip_find(skb->nh.iph);
+	ip_buf_evict(skb->len, buf);
 	if (!buf) {
 		buf = ip_buf_create(skb->nh.iph);
+		if (!buf) {
+			skb_free(skb);
+			return NULL;
+		}
 	}
-	assert(buf);
 
-	ip_buf_add_skb(buf, skb);
+	if ((__dgram_mem + skb->len > FRAG_MEM_MAX)
+			|| (skb->h.raw - skb->mac.raw + ip_offset(skb)
+				+ ip_frag_data_len(skb) > skb_max_size())) {
+		/* datagram is too big to be reassembled */
+		skb_free(skb);
+		buf_delete(buf);
+		return NULL;
+	}
 
 	mf_flag = ntohs(skb->nh.iph->frag_off) & IP_MF;
-	buf->is_last_frag_received = !mf_flag;
+
+	if (0 != ip_buf_add_skb(buf, skb)) {
+		skb_free(skb);
+		return NULL;
+	}
+
+	if (!mf_flag) {
+		buf->is_last_frag_received = 1;
+	}
 
 	if (buf->is_last_frag_received && buf->meat == buf->len) {
 		return build_packet(buf);
@@ -39,6 +39,7 @@ static int ip_rcv(struct sk_buff *skb, struct net_device *dev) {
 	__u16 old_check;
 	size_t ip_len;
 	int optlen;
+	int forward;
 	sk_buff_t *complete_skb;
 
 	/**
@@ -88,6 +89,36 @@ static int ip_rcv(struct sk_buff *skb, struct net_device *dev) {
 	/* Setup transport layer (L4) header */
 	skb->h.raw = skb->nh.raw + IP_HEADER_SIZE(iph);
 
+	assert(skb->dev);
+	assert(inetdev_get_by_dev(skb->dev));
+	/**
+	 * FIXME
+	 * ifa_address check needed for BOOTP protocol
+	 * disable forwarding if interface is not set yet
+	 */
+	/**
+	 * Check the destination address, and if it doesn't match
+	 * any of own addresses, retransmit packet according to the routing table.
+	 */
+	forward = (inetdev_get_by_dev(skb->dev)->ifa_address != 0)
+			&& !ip_is_local(iph->daddr, IP_LOCAL_BROADCAST);
+
+	/* It's very useful for us to have complete packet even for forwarding
+	 * (we may apply any filter, we may perform NAT etc),
+	 * but it'll break routing if different parts of a fragmented
+	 * packet will use different routes. So they can't be assembled.
+	 * See RFC 1812 for details
+	 * Local packets are assembled before netfilter, so connection tracking
+	 * sees the transport header of every datagram.
+	 */
+	if (!forward && (ntohs(iph->frag_off) & (IP_MF | IP_OFFSET))) {
+		if ((complete_skb = ip_defrag(skb)) == NULL) {
+			return 0; /* fragment is queued or dropped */
+		}
+		skb = complete_skb;
+		iph = ip_hdr(complete_skb);
+	}
+
 	/* Validating */
 	if (0 != nf_test_skb(NF_CHAIN_INPUT, NF_TARGET_ACCEPT, skb)) {
 		log_debug("ip_rcv: dropped by input netfilter");
@@ -97,27 +128,14 @@ static int ip_rcv(struct sk_buff *skb, struct net_device *dev) {
 	}
 
 	/* Forwarding */
-	assert(skb->dev);
-	assert(inetdev_get_by_dev(skb->dev));
-	if (inetdev_get_by_dev(skb->dev)->ifa_address != 0) {
-		/**
-		 * FIXME
-		 * This check needed for BOOTP protocol
-		 * disable forwarding if interface is not set yet
-		 */
-		/**
-		 * Check the destination address, and if it doesn't match
-		 * any of own addresses, retransmit packet according to the routing table.
-		 */
-		if (!ip_is_local(iph->daddr, IP_LOCAL_BROADCAST)) {
-			if (0 != nf_test_skb(NF_CHAIN_FORWARD, NF_TARGET_ACCEPT, skb)) {
-				log_debug("ip_rcv: dropped by forward netfilter");
-				stats->rx_dropped++;
-				skb_free(skb);
-				return 0; /* error: dropped */
-			}
-			return ip_forward(skb);
+	if (forward) {
+		if (0 != nf_test_skb(NF_CHAIN_FORWARD, NF_TARGET_ACCEPT, skb)) {
+			log_debug("ip_rcv: dropped by forward netfilter");
+			stats->rx_dropped++;
+			skb_free(skb);
+			return 0; /* error: dropped */
 		}
+		return ip_forward(skb);
 	}
 
 	memset(skb->cb, 0, sizeof(skb->cb));
@@ -146,24 +164,6 @@ static int ip_rcv(struct sk_buff *skb, struct net_device *dev) {
 		}
 	}
 
-	/* It's very useful for us to have complete packet even for forwarding
-	 * (we may apply any filter, we may perform NAT etc),
-	 * but it'll break routing if different parts of a fragmented
-	 * packet will use different routes. So they can't be assembled.
-	 * See RFC 1812 for details
-	 */
-	if (ntohs(skb->nh.iph->frag_off) & (IP_MF | IP_OFFSET)) {
-		if ((complete_skb = ip_defrag(skb)) == NULL) {
-			if (skb == NULL) {
-				return 0; /* error: */
-			}
-			return 0;
-		} else {
-			skb = complete_skb;
-			iph = ip_hdr(complete_skb);
-		}
-	}
-
 	/* When a packet is received, it is passed to any raw sockets
 	 * which have been bound to its protocol or to socket with concrete protocol */
 	raw_rcv(skb);
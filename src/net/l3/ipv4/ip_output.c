@@ -54,6 +54,7 @@ static int ip_xmit(struct sk_buff *skb) {
 	hdr_info.type = ETH_P_IP;
 	hdr_info.src_hw = NULL;
 	hdr_info.dst_hw = NULL;
+	hdr_info.nbr_cache = NULL;
 
 	/* it's loopback/local or broadcast address? */
 	if (ip_is_local(daddr, IP_LOCAL_BROADCAST)) {
@@ -61,7 +62,7 @@ static int ip_xmit(struct sk_buff *skb) {
 	}
 	else {
 		/* get dest ip from route table */
-		ret = rt_fib_route_ip(daddr, &daddr);
+		ret = rt_fib_route_ip_cached(daddr, &daddr, &hdr_info.nbr_cache);
 		if (ret != 0) {
 			DBG(printk("ip_xmit: unknown target for %s\n",
 						inet_ntoa(*(struct in_addr *)&daddr)));
@@ -229,22 +230,35 @@ static int ip_make(const struct sock *sk,
 
 	dst_ip = ip_get_dest_addr(in_sk, to, out_skb);
 
-	ret = rt_fib_out_dev(dst_ip, in_sk != NULL ? &in_sk->sk : NULL,
-			&dev);
-	if (ret != 0) {
-		DBG(printk("ip_make: unknown device for %s\n",
-					inet_ntoa(*(struct in_addr *)&dst_ip)));
-		return ret;
+	if ((in_sk != NULL) && (to == NULL)) {
+		/* Connected socket sends to the same peer each time */
+		ret = rt_fib_out_cached(&((struct inet_sock *)in_sk)->rt_cache,
+				dst_ip, &in_sk->sk, &dev, &src_ip);
+		if (ret != 0) {
+			DBG(printk("ip_make: no route to %s\n",
+						inet_ntoa(*(struct in_addr *)&dst_ip)));
+			return ret;
+		}
+		assert(dev != NULL);
 	}
-	assert(dev != NULL);
+	else {
+		ret = rt_fib_out_dev(dst_ip, in_sk != NULL ? &in_sk->sk : NULL,
+				&dev);
+		if (ret != 0) {
+			DBG(printk("ip_make: unknown device for %s\n",
+						inet_ntoa(*(struct in_addr *)&dst_ip)));
+			return ret;
+		}
+		assert(dev != NULL);
 
-	assert(inetdev_get_by_dev(dev) != NULL);
-	//src_ip = inetdev_get_by_dev(dev)->ifa_address; /* TODO it's better! */
-	ret = rt_fib_source_ip(dst_ip, dev, &src_ip);
-	if (ret != 0) {
-		DBG(printk("ip_make: can't resolve source ip for %s\n",
-					inet_ntoa(*(struct in_addr *)&dst_ip)));
-		return ret;
+		assert(inetdev_get_by_dev(dev) != NULL);
+		//src_ip = inetdev_get_by_dev(dev)->ifa_address; /* TODO it's better! */
+		ret = rt_fib_source_ip(dst_ip, dev, &src_ip);
+		if (ret != 0) {
+			DBG(printk("ip_make: can't resolve source ip for %s\n",
+						inet_ntoa(*(struct in_addr *)&dst_ip)));
+			return ret;
+		}
 	}
 
 	proto = in_sk != NULL ? in_sk->sk.opt.so_protocol
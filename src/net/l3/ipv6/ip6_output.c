@@ -33,6 +33,7 @@ static int ip6_xmit(struct sk_buff *skb) {
 	hdr_info.type = ETH_P_IPV6;
 	hdr_info.src_hw = NULL;
 	hdr_info.dst_hw = NULL;
+	hdr_info.nbr_cache = NULL;
 
 	/* FIXME */
 	assert(skb->dev != NULL);
@@ -31,6 +31,7 @@ static int ndp_xmit(struct sk_buff *skb,
 	hdr_info.type = ETH_P_IPV6;
 	hdr_info.src_hw = dev->dev_addr;
 	hdr_info.dst_hw = dev->broadcast;
+	hdr_info.nbr_cache = NULL;
 
 	return net_tx(skb, &hdr_info);
 }
@@ -9,37 +9,203 @@
  */
 
 #include <errno.h>
+#include <string.h>
 #include <assert.h>
 #include <net/l3/route.h>
 #include <linux/in.h>
 #include <mem/misc/pool.h>
 #include <net/inetdevice.h>
+#include <net/neighbour.h>
 #include <util/bit.h>
 #include <util/dlist.h>
+#include <util/math.h>
 #include <util/member.h>
 #include <net/skbuff.h>
 #include <net/sock.h>
+#include <hal/ipl.h>
 
 #include <framework/mod/options.h>
 
+#define RT_TABLE_SIZE OPTION_GET(NUMBER,route_table_size)
+
 /**
  * NOTE: Linux route uses 3 structures for routing:
  *    + Forwarding Information Base (FIB)
  *    - routing cache (256 chains)
  *    + neighbour table (ARP cache)
+ *
+ * Entries are kept in a list in order of addition for iteration and are
+ * indexed by a path-compressed binary trie for the longest prefix match.
+ * Each trie node stands for a prefix, either with routes to it or only
+ * branching its two children. Prefixes are kept in host byte order.
  */
 
+struct rt_trie_node;
+
 struct rt_entry_info {
 	struct dlist_head lnk;
+	struct dlist_head node_lnk;
+	struct rt_trie_node *node;
 	struct rt_entry entry;
+	struct neighbour_cache gw_nbr; /* resolved gateway */
 };
 
-POOL_DEF(rt_entry_info_pool, struct rt_entry_info, OPTION_GET(NUMBER,route_table_size));
+struct rt_trie_node {
+	struct rt_trie_node *parent;
+	struct rt_trie_node *child[2];
+	uint32_t prefix;
+	int len;
+	struct dlist_head routes;
+};
+
+POOL_DEF(rt_entry_info_pool, struct rt_entry_info, RT_TABLE_SIZE);
+/* Each route adds at most a node for itself and a branching one */
+POOL_DEF(rt_trie_node_pool, struct rt_trie_node, 2 * RT_TABLE_SIZE);
 static DLIST_DEFINE(rt_entry_info_list);
+static struct rt_trie_node *rt_trie_root;
+
+/* Changed on every table update, zero is never used */
+static unsigned int rt_fib_gen = 1;
+
+static inline uint32_t rt_prefix_mask(int len) {
+	return len ? ~0U << (32 - len) : 0;
+}
+
+static inline int rt_prefix_bit(uint32_t prefix, int pos) {
+	return (prefix >> (31 - pos)) & 1;
+}
+
+static inline int rt_clz32(uint32_t x) {
+	return bit_clz(x) - (LONG_BIT - 32);
+}
+
+static inline int rt_mask_len(in_addr_t mask) {
+	return ~mask ? rt_clz32(ntohl(~mask)) : 32;
+}
+
+static struct rt_trie_node * rt_trie_node_alloc(uint32_t prefix, int len,
+		struct rt_trie_node *parent) {
+	struct rt_trie_node *node;
+
+	node = pool_alloc(&rt_trie_node_pool);
+	if (node == NULL) {
+		return NULL;
+	}
+
+	node->parent = parent;
+	node->child[0] = node->child[1] = NULL;
+	node->prefix = prefix & rt_prefix_mask(len);
+	node->len = len;
+	dlist_init(&node->routes);
+
+	return node;
+}
+
+static struct rt_trie_node ** rt_trie_link(struct rt_trie_node *node) {
+	if (node->parent == NULL) {
+		return &rt_trie_root;
+	}
+	return &node->parent->child[rt_prefix_bit(node->prefix,
+			node->parent->len)];
+}
+
+/* Finds or creates node for the prefix */
+static struct rt_trie_node * rt_trie_get(uint32_t prefix, int len) {
+	struct rt_trie_node **link, *node, *parent, *new, *branch;
+	int common;
+
+	prefix &= rt_prefix_mask(len);
+
+	parent = NULL;
+	link = &rt_trie_root;
+	while ((node = *link) != NULL) {
+		common = min(node->len, len);
+		if (common != 0) {
+			uint32_t diff = (node->prefix ^ prefix) & rt_prefix_mask(common);
+			if (diff) {
+				common = rt_clz32(diff);
+			}
+		}
+
+		if (common < node->len) {
+			/* Node's prefix is longer than the common part, so the new
+			 * node (or a branching one) goes between it and its parent. */
+			new = rt_trie_node_alloc(prefix, len, parent);
+			if (new == NULL) {
+				return NULL;
+			}
+
+			if (common == len) {
+				new->child[rt_prefix_bit(node->prefix, len)] = node;
+				node->parent = new;
+				*link = new;
+				return new;
+			}
+
+			branch = rt_trie_node_alloc(prefix, common, parent);
+			if (branch == NULL) {
+				pool_free(&rt_trie_node_pool, new);
+				return NULL;
+			}
+			branch->child[rt_prefix_bit(node->prefix, common)] = node;
+			branch->child[rt_prefix_bit(prefix, common)] = new;
+			node->parent = new->parent = branch;
+			*link = branch;
+			return new;
+		}
+
+		if (node->len == len) {
+			return node;
+		}
+
+		parent = node;
+		link = &node->child[rt_prefix_bit(prefix, node->len)];
+	}
+
+	node = rt_trie_node_alloc(prefix, len, parent);
+	if (node != NULL) {
+		*link = node;
+	}
+
+	return node;
+}
+
+/* Removes nodes which neither hold routes nor branch */
+static void rt_trie_shrink(struct rt_trie_node *node) {
+	struct rt_trie_node *parent, *child;
+
+	while (node != NULL && dlist_empty(&node->routes)
+			&& (node->child[0] == NULL || node->child[1] == NULL)) {
+		parent = node->parent;
+		child = node->child[0] != NULL ? node->child[0] : node->child[1];
+
+		*rt_trie_link(node) = child;
+		if (child != NULL) {
+			child->parent = parent;
+		}
+		pool_free(&rt_trie_node_pool, node);
+
+		node = parent;
+	}
+}
+
+static void rt_entry_info_free(struct rt_entry_info *rt_info) {
+	struct rt_trie_node *node = rt_info->node;
+
+	dlist_del_init_entry(rt_info, lnk);
+	dlist_del_init_entry(rt_info, node_lnk);
+	if (dlist_empty(&node->routes)) {
+		rt_trie_shrink(node);
+	}
+	pool_free(&rt_entry_info_pool, rt_info);
+
+	rt_fib_gen = rt_fib_gen + 1 ? rt_fib_gen + 1 : 1;
+}
 
 int rt_add_route(struct net_device *dev, in_addr_t dst,
 		in_addr_t mask, in_addr_t gw, int flags) {
 	struct rt_entry_info *rt_info;
+	struct rt_trie_node *node;
 
 	if (dev == NULL) {
 		return -EINVAL;
@@ -49,13 +215,25 @@ int rt_add_route(struct net_device *dev, in_addr_t dst,
 	if (rt_info == NULL) {
 		return -ENOMEM;
 	}
+
+	node = rt_trie_get(ntohl(dst), rt_mask_len(mask));
+	if (node == NULL) {
+		pool_free(&rt_entry_info_pool, rt_info);
+		return -ENOMEM;
+	}
 	rt_info->entry.dev = dev;
 	rt_info->entry.rt_dst = dst; /* We assume that host bits are zeroes here */
 	rt_info->entry.rt_mask = mask;
 	rt_info->entry.rt_gateway = gw;
 	rt_info->entry.rt_flags = RTF_UP | flags;
+	memset(&rt_info->gw_nbr, 0, sizeof rt_info->gw_nbr);
 
 	dlist_add_prev_entry(rt_info, &rt_entry_info_list, lnk);
+	rt_info->node = node;
+	dlist_head_init(&rt_info->node_lnk);
+	dlist_add_prev_entry(rt_info, &node->routes, node_lnk);
+
+	rt_fib_gen = rt_fib_gen + 1 ? rt_fib_gen + 1 : 1;
 
 	return 0;
 }
@@ -69,8 +247,7 @@ int rt_del_route(struct net_device *dev, in_addr_t dst,
                 ((rt_info->entry.rt_mask == mask) || (INADDR_ANY == mask)) &&
     			((rt_info->entry.rt_gateway == gw) || (INADDR_ANY == gw)) &&
     			((rt_info->entry.dev == dev) || (INADDR_ANY == dev))) {
-			dlist_del_init_entry(rt_info, lnk);
-			pool_free(&rt_entry_info_pool, rt_info);
+			rt_entry_info_free(rt_info);
 			return 0;
 		}
 	}
@@ -84,8 +261,7 @@ int rt_del_route_if(struct net_device *dev) {
 
 	dlist_foreach_entry(rt_info, &rt_entry_info_list, lnk) {
 		if (rt_info->entry.dev == dev) {
-			dlist_del_init_entry(rt_info, lnk);
-			pool_free(&rt_entry_info_pool, rt_info);
+			rt_entry_info_free(rt_info);
 			ret ++;
 		}
 	}
@@ -160,6 +336,33 @@ int rt_fib_route_ip(in_addr_t dst_ip, in_addr_t *next_ip) {
 	return 0;
 }
 
+int rt_fib_route_ip_cached(in_addr_t dst_ip, in_addr_t *next_ip,
+		struct neighbour_cache **out_nc) {
+	struct rt_entry *rte;
+
+	*out_nc = NULL;
+
+	if (dst_ip == INADDR_BROADCAST) {
+		*next_ip = dst_ip;
+		return 0;
+	}
+
+	rte = rt_fib_get_best(dst_ip, NULL);
+	if (rte == NULL) {
+		return -ENETUNREACH;
+	}
+
+	if (rte->rt_gateway == INADDR_ANY) {
+		*next_ip = dst_ip;
+	}
+	else {
+		*next_ip = rte->rt_gateway;
+		*out_nc = &member_cast_out(rte, struct rt_entry_info, entry)->gw_nbr;
+	}
+
+	return 0;
+}
+
 int rt_fib_source_ip(in_addr_t dst_ip, struct net_device *dev,
 		in_addr_t *src_ip) {
 	struct rt_entry *rte;
@@ -245,27 +448,72 @@ struct rt_entry * rt_fib_get_next(struct rt_entry *entry) {
 			struct rt_entry_info, lnk)->entry;
 }
 
-/* ToDo: It's too ugly to perform sorting for every packet.
- * Routes must be added into list with mask_len decrease.
- * In this case we'll simply take the first match
- */
 struct rt_entry * rt_fib_get_best(in_addr_t dst, struct net_device *out_dev) {
+	struct rt_trie_node *node;
 	struct rt_entry_info *rt_info;
-	int mask_len, best_mask_len;
 	struct rt_entry *best_rte;
+	uint32_t key;
 
+	key = ntohl(dst);
 	best_rte = NULL;
-	best_mask_len = -1;
-	dlist_foreach_entry(rt_info, &rt_entry_info_list, lnk) {
-		mask_len = ~rt_info->entry.rt_mask
-			? bit_clz(ntohl(~rt_info->entry.rt_mask)) + 1 : 32;
-		if (((dst & rt_info->entry.rt_mask) == rt_info->entry.rt_dst)
-				&& (out_dev == NULL || out_dev == rt_info->entry.dev)
-				&& (mask_len > best_mask_len)) {
-			best_rte = &rt_info->entry;
-			best_mask_len = mask_len;
+
+	/* Nodes along the path have increasing prefix length */
+	node = rt_trie_root;
+	while ((node != NULL)
+			&& !((key ^ node->prefix) & rt_prefix_mask(node->len))) {
+		dlist_foreach_entry(rt_info, &node->routes, node_lnk) {
+			if (((dst & rt_info->entry.rt_mask) == rt_info->entry.rt_dst)
+					&& (out_dev == NULL || out_dev == rt_info->entry.dev)) {
+				best_rte = &rt_info->entry;
+				break;
+			}
 		}
+
+		if (node->len == 32) {
+			break;
+		}
+		node = node->child[rt_prefix_bit(key, node->len)];
 	}
 
 	return best_rte;
 }
+
+int rt_fib_out_cached(struct rt_cache *rtc, in_addr_t dst,
+		const struct sock *sk, struct net_device **out_dev,
+		in_addr_t *out_src) {
+	struct net_device *wanna_dev;
+	in_addr_t src;
+	int ret;
+
+	assert(rtc != NULL);
+
+	wanna_dev = sk != NULL ? sk->opt.so_bindtodevice : NULL;
+
+	if ((rtc->gen != rt_fib_gen)
+			|| (rtc->addr_gen != inetdev_get_addr_gen())
+			|| (rtc->dst != dst) || (rtc->wanna_dev != wanna_dev)) {
+		ret = rt_fib_out_dev(dst, sk, out_dev);
+		if (ret != 0) {
+			return ret;
+		}
+
+		/* Own addresses go out through loopback, but the source is the
+		 * address of the interface the best route points to */
+		ret = rt_fib_source_ip(dst, *out_dev, &src);
+		if (ret != 0) {
+			return ret;
+		}
+
+		rtc->dst = dst;
+		rtc->wanna_dev = wanna_dev;
+		rtc->dev = *out_dev;
+		rtc->src = src;
+		rtc->gen = rt_fib_gen;
+		rtc->addr_gen = inetdev_get_addr_gen();
+	}
+
+	*out_dev = rtc->dev;
+	*out_src = rtc->src;
+
+	return 0;
+}
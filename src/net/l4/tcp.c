@@ -24,16 +24,17 @@
 #include <net/sock_wait.h>
 #include <net/socket/inet_sock.h>
 #include <net/socket/inet6_sock.h>
+#include <net/socket/sock_hash.h>
 #include <net/l3/ipv4/ip.h>
 #include <net/l3/ipv6.h>
 #include <net/l2/ethernet.h>
 
 
 #include <kernel/time/timer.h>
+#include <kernel/time/time.h>
 
 #include <embox/net/pack.h>
 #include <embox/net/proto.h>
-#include <embox/unit.h>
 #include <kernel/sched/sched_lock.h>
 #include <kernel/time/ktime.h>
 #include <net/lib/tcp.h>
@@ -42,12 +43,12 @@
 #include <fs/idesc_event.h>
 
 #include <util/log.h>
+#include <util/math.h>
 #include <stdarg.h>
 
 #include <net/lib/ipv4.h>
 #include <net/lib/ipv6.h>
 
-EMBOX_UNIT_INIT(tcp_init);
 EMBOX_NET_PROTO(ETH_P_IP, IPPROTO_TCP, tcp_rcv,
 		net_proto_handle_error_none);
 EMBOX_NET_PROTO(ETH_P_IPV6, IPPROTO_TCP, tcp_rcv,
@@ -91,8 +92,6 @@ typedef enum tcp_ret_code (*tcp_handler_t)(struct tcp_sock *tcp_sk,
 		const struct tcphdr *tcph, struct sk_buff *skb,
 		struct tcphdr *out_tcph);
 
-static struct sys_timer tcp_tmr_default; /* Timer structure for rexmitting or TIME-WAIT satate */
-
 /* Prototypes */
 static int tcp_handle(struct tcp_sock *tcp_sk, struct sk_buff *skb, tcp_handler_t hnd);
 static const tcp_handler_t tcp_st_handler[];
@@ -120,7 +119,7 @@ void debug_print(__u8 code, const char *msg, ...) {
 //	case 4:  /* hash/unhash */
 //	case 5:  /* lock/unlock */
 //	case 6:	 /* sock_alloc/sock_free */
-//	case 7:  /* tcp_default_timer action */
+//	case 7:  /* tcp_timer_handler action */
 //	case 8:  /* state's handler */
 //	case 9:  /* sending package */
 //	case 10: /* pre_process */
@@ -262,6 +261,11 @@ void tcp_sock_set_state(struct tcp_sock *tcp_sk, enum tcp_sock_state new_state)
 	tcp_sk->state = new_state;
 	debug_print(2, "sk %p set state %d-%s\n", sk, new_state, str_state[new_state]);
 
+	if (new_state == TCP_TIMEWAIT) {
+		/* the same timer is reused, no more rexmitting after that */
+		timer_start(&tcp_sk->tmr, ms2jiffies(TCP_TIMEWAIT_DELAY));
+	}
+
 	/* idesc manipulation */
 	switch (new_state) {
 	default:
@@ -335,6 +339,50 @@ static int tcp_is_expired(struct timeval *since,
 	return timercmp(&delta, &limit, >=);
 }
 
+static uint32_t tcp_elapsed_msec(struct timeval *since) {
+	struct timeval now, delta;
+	ktime_get_timeval(&now);
+	timersub(&now, since, &delta);
+	return delta.tv_sec * MSEC_PER_SEC + delta.tv_usec / USEC_PER_MSEC;
+}
+
+/**
+ * Update SRTT, RTTVAR and RTO with a new RTT sample (RFC 6298)
+ */
+static void tcp_rtt_sample(struct tcp_sock *tcp_sk, uint32_t rtt) {
+	int32_t delta;
+
+	if (tcp_sk->srtt == 0) {
+		/* first measurement */
+		tcp_sk->srtt = rtt << 3;
+		tcp_sk->rttvar = rtt << 1;
+	}
+	else {
+		/* srtt = 7/8 srtt + 1/8 rtt, rttvar = 3/4 rttvar + 1/4 |delta| */
+		delta = rtt - (tcp_sk->srtt >> 3);
+		tcp_sk->srtt += delta;
+		if (delta < 0) {
+			delta = -delta;
+		}
+		tcp_sk->rttvar += delta - (tcp_sk->rttvar >> 2);
+	}
+
+	tcp_sk->rto = clamp((tcp_sk->srtt >> 3) + max(tcp_sk->rttvar, 1u),
+			TCP_RTO_MIN, TCP_RTO_MAX);
+}
+
+static void tcp_rexmit_timer_start(struct tcp_sock *tcp_sk) {
+	if (tcp_sk->state != TCP_TIMEWAIT) {
+		timer_start(&tcp_sk->tmr, ms2jiffies(tcp_sk->rto));
+	}
+}
+
+static void tcp_rexmit_timer_stop(struct tcp_sock *tcp_sk) {
+	if (tcp_sk->state != TCP_TIMEWAIT) {
+		timer_close(&tcp_sk->tmr);
+	}
+}
+
 static void tcp_xmit(struct sk_buff *skb,
 		const struct tcp_sock *tcp_sk,
 		const struct net_pack_out_ops *out_ops) {
@@ -469,6 +517,14 @@ void send_seq_from_sock(struct tcp_sock *tcp_sk, struct sk_buff *skb) {
 		assert(to_sock(tcp_sk) != NULL);
 		skb_queue_push(&to_sock(tcp_sk)->tx_queue, skb);
 		tcp_sk->self.seq += tcp_seq_length(skb->h.th, skb->nh.raw);
+		if (!timerisset(&tcp_sk->rtt_time) && !tcp_sk->rexmit_mode) {
+			/* time this segment, retransmitted ones are never timed */
+			tcp_sk->rtt_seq = tcp_sk->self.seq;
+			tcp_get_now(&tcp_sk->rtt_time);
+		}
+		if (!timer_is_started(&tcp_sk->tmr)) {
+			tcp_rexmit_timer_start(tcp_sk);
+		}
 	}
 	tcp_sock_unlock(tcp_sk, TCP_SYNC_WRITE_QUEUE);
 
@@ -485,14 +541,17 @@ void tcp_sock_release(struct tcp_sock *tcp_sk) {
 		{
 			list_for_each_entry(anticipant,
 					&tcp_sk->conn_wait, conn_lnk) {
+				timer_close(&anticipant->tmr);
 				sock_release(to_sock(anticipant));
 			}
 			list_for_each_entry(anticipant,
 					&tcp_sk->conn_ready, conn_lnk) {
+				timer_close(&anticipant->tmr);
 				sock_release(to_sock(anticipant));
 			}
 			list_for_each_entry(anticipant,
 					&tcp_sk->conn_free, conn_lnk) {
+				timer_close(&anticipant->tmr);
 				sock_release(to_sock(anticipant));
 			}
 		}
@@ -510,6 +569,7 @@ void tcp_sock_release(struct tcp_sock *tcp_sk) {
 		tcp_sock_unlock(tcp_sk->parent, TCP_SYNC_CONN_QUEUE);
 	}
 
+	timer_close(&tcp_sk->tmr);
 	sock_release(to_sock(tcp_sk));
 }
 
@@ -589,6 +649,7 @@ static enum tcp_ret_code tcp_st_listen(struct tcp_sock *tcp_sk,
 					&ip6_hdr(skb)->saddr,
 					sizeof newsk.in6->dst_in6.sin6_addr);
 		}
+		sock_rehash(to_sock(tcp_newsk));
 		/* Save new socket to accept queue */
 		tcp_sock_lock(tcp_sk, TCP_SYNC_CONN_QUEUE);
 		{
@@ -807,7 +868,8 @@ static enum tcp_ret_code tcp_st_timewait(struct tcp_sock *tcp_sk,
 	debug_print(8, "call tcp_st_timewait\n");
 	assert(tcp_sk->state == TCP_TIMEWAIT);
 
-	/* timeout 2msl and set TCP_CLOSED state */
+	/* restart 2msl timeout, socket is released by tcp_timer_handler */
+	timer_start(&tcp_sk->tmr, ms2jiffies(TCP_TIMEWAIT_DELAY));
 
 	return TCP_RET_DROP;
 }
@@ -897,6 +959,7 @@ static enum tcp_ret_code process_ack(struct tcp_sock *tcp_sk,
 			++tcp_sk->dup_ack;
 			if (tcp_sk->dup_ack == TCP_REXMIT_DUP_ACK) {
 				tcp_sk->rexmit_mode = 1;
+				timerclear(&tcp_sk->rtt_time); /* Karn's algorithm */
 				tcp_rexmit(tcp_sk);
 			}
 		}
@@ -904,7 +967,17 @@ static enum tcp_ret_code process_ack(struct tcp_sock *tcp_sk,
 	else if (ack2last_ack <= seq - tcp_sk->last_ack) {
 		confirm_ack(tcp_sk, ack);
 		tcp_sk->last_ack = ack;
-		tcp_get_now(&tcp_sk->ack_time);
+		if (timerisset(&tcp_sk->rtt_time)
+				&& ((int32_t)(ack - tcp_sk->rtt_seq) >= 0)) {
+			tcp_rtt_sample(tcp_sk, tcp_elapsed_msec(&tcp_sk->rtt_time));
+			timerclear(&tcp_sk->rtt_time);
+		}
+		if (seq == ack) {
+			tcp_rexmit_timer_stop(tcp_sk);
+		}
+		else {
+			tcp_rexmit_timer_start(tcp_sk);
+		}
 		if (!tcp_sk->rexmit_mode) {
 			tcp_sk->dup_ack = 0;
 			sock_notify(to_sock(tcp_sk), POLLOUT);
@@ -1218,8 +1291,6 @@ static void tcp_process(struct tcp_sock *tcp_sk,
 	if (tcp_sk != NULL) {
 		enum tcp_ret_code ret;
 
-		tcp_get_now(&tcp_sk->rcv_time);
-
 		ret = tcp_handle(tcp_sk, skb, pre_process);
 		if (ret == TCP_RET_OK) {
 			ret = tcp_handle(tcp_sk, skb, NULL);
@@ -1275,6 +1346,14 @@ static int tcp6_rcv_tester_soft(const struct sock *sk,
 			&& (sock_inet_get_dst_port(sk) == 0);
 }
 
+static unsigned int tcp_rcv_hash(const struct sk_buff *skb) {
+	return sock_hash_tuple(tcp_hdr(skb)->dest,
+			ip_check_version(ip_hdr(skb))
+				? ip_hdr(skb)->saddr
+				: sock_hash_in6_addr(&ip6_hdr(skb)->saddr),
+			tcp_hdr(skb)->source);
+}
+
 extern uint16_t skb_get_secure_level(const struct sk_buff *skb);
 extern uint16_t sock_get_secure_level(const struct sock *sk);
 
@@ -1308,17 +1387,17 @@ static int tcp_rcv(struct sk_buff *skb) {
 	assert(ip_check_version(ip_hdr(skb))
 			|| ip6_check_version(ip6_hdr(skb)));
 
-	sk = sock_lookup(NULL, tcp_sock_ops,
+	sk = sock_lookup_established(tcp_sock_ops,
 			ip_check_version(ip_hdr(skb))
 				? tcp4_rcv_tester_strict
 				: tcp6_rcv_tester_strict,
-			skb);
+			skb, tcp_rcv_hash(skb));
 	if (sk == NULL) {
-		sk = sock_lookup(NULL, tcp_sock_ops,
+		sk = sock_lookup_bound(tcp_sock_ops,
 				ip_check_version(ip_hdr(skb))
 					? tcp4_rcv_tester_soft
 					: tcp6_rcv_tester_soft,
-				skb);
+				skb, sock_hash_port(tcp_hdr(skb)->dest));
 	}
 
 	tcp_sk = sk != NULL ? to_tcp_sock(sk) : NULL;
@@ -1347,55 +1426,45 @@ static int tcp_rcv(struct sk_buff *skb) {
 
 static void tcp_timer_handler(struct sys_timer *timer,
 		void *param) {
-	struct sock *sk;
 	struct tcp_sock *tcp_sk;
 
-	(void)timer;
-	(void)param;
+	tcp_sk = param;
+	assert(tcp_sk != NULL);
 
-	debug_print(7, "TIMER: call tcp_timer_handler\n");
+	debug_print(7, "TIMER: call tcp_timer_handler sk %p\n",
+			to_sock(tcp_sk));
 
-	sock_foreach(sk, tcp_sock_ops) {
-		tcp_sk = to_tcp_sock(sk);
-		if ((tcp_sk->state == TCP_TIMEWAIT)
-				&& tcp_is_expired(&tcp_sk->rcv_time,
-					TCP_TIMEWAIT_DELAY)) {
-			debug_print(7, "tcp_timer_handler: release timewait"
-					 	" sk %p\n",
-					to_sock(tcp_sk));
-			tcp_sock_release(tcp_sk);
-		}
-		else if ((tcp_sock_get_status(tcp_sk) == TCP_ST_NONSYNC)
-				&& !list_empty(&tcp_sk->conn_lnk)
-				&& tcp_is_expired(&tcp_sk->syn_time,
-					TCP_SYNC_TIMEOUT)) {
-			assert(tcp_sk->parent != NULL);
-			debug_print(7, "tcp_timer_handler: release nonsync"
-						" sk %p\n",
-					to_sock(tcp_sk));
-			tcp_sock_release(tcp_sk);
-		}
-		else if ((tcp_sock_get_status(tcp_sk) != TCP_ST_NOTEXIST)
-				&& tcp_is_expired(&tcp_sk->ack_time,
-					TCP_REXMIT_DELAY)
-				&& (tcp_sk->last_ack != tcp_sk->self.seq)) {
-			debug_print(7, "tcp_timer_handler: rexmit sk %p\n",
-					to_sock(tcp_sk));
-			tcp_sk->rexmit_mode = 1;
-			tcp_rexmit(tcp_sk);
-		}
+	if (tcp_sk->state == TCP_TIMEWAIT) {
+		debug_print(7, "tcp_timer_handler: release timewait"
+					" sk %p\n",
+				to_sock(tcp_sk));
+		tcp_sock_release(tcp_sk);
 	}
-}
-
-static int tcp_init(void) {
-	int ret;
-
-	/* Create default timer */
-	ret = timer_init_start_msec(&tcp_tmr_default, TIMER_PERIODIC,
-			TCP_TIMER_FREQUENCY, tcp_timer_handler, NULL);
-	if (ret != 0) {
-		return ret;
+	else if ((tcp_sock_get_status(tcp_sk) == TCP_ST_NONSYNC)
+			&& !list_empty(&tcp_sk->conn_lnk)
+			&& tcp_is_expired(&tcp_sk->syn_time,
+				TCP_SYNC_TIMEOUT)) {
+		assert(tcp_sk->parent != NULL);
+		debug_print(7, "tcp_timer_handler: release nonsync"
+					" sk %p\n",
+				to_sock(tcp_sk));
+		tcp_sock_release(tcp_sk);
 	}
+	else if ((tcp_sock_get_status(tcp_sk) != TCP_ST_NOTEXIST)
+			&& (tcp_sk->last_ack != tcp_sk->self.seq)) {
+		debug_print(7, "tcp_timer_handler: rexmit sk %p rto %u\n",
+				to_sock(tcp_sk), tcp_sk->rto);
+		tcp_sk->rexmit_mode = 1;
+		timerclear(&tcp_sk->rtt_time); /* Karn's algorithm */
+		tcp_sk->rto = min(tcp_sk->rto << 1, (uint32_t) TCP_RTO_MAX); /* back off */
+		tcp_rexmit(tcp_sk);
+		timer_start(timer, ms2jiffies(tcp_sk->rto));
+	}
+}
 
-	return 0;
+void tcp_timer_init(struct tcp_sock *tcp_sk) {
+	timer_init(&tcp_sk->tmr, TIMER_ONESHOT, tcp_timer_handler, tcp_sk);
+	tcp_sk->srtt = tcp_sk->rttvar = 0;
+	tcp_sk->rto = TCP_RTO_INIT;
+	timerclear(&tcp_sk->rtt_time);
 }
@@ -21,6 +21,7 @@
 #include <net/l3/icmpv4.h>
 #include <net/l2/ethernet.h>
 #include <net/socket/inet_sock.h>
+#include <net/socket/sock_hash.h>
 
 #include <net/netdevice.h>
 #include <framework/mod/options.h>
@@ -74,6 +75,24 @@ static int udp6_accept_dst(const struct sock *sk,
 				|| (sk->opt.so_bindtodevice == NULL));
 }
 
+static int udp4_rcv_tester_strict(const struct sock *sk,
+		const struct sk_buff *skb) {
+	return udp4_rcv_tester(sk, skb) && udp4_accept_dst(sk, skb);
+}
+
+static int udp6_rcv_tester_strict(const struct sock *sk,
+		const struct sk_buff *skb) {
+	return udp6_rcv_tester(sk, skb) && udp6_accept_dst(sk, skb);
+}
+
+static unsigned int udp_rcv_hash(const struct sk_buff *skb) {
+	return sock_hash_tuple(udp_hdr(skb)->dest,
+			ip_check_version(ip_hdr(skb))
+				? ip_hdr(skb)->saddr
+				: sock_hash_in6_addr(&ip6_hdr(skb)->saddr),
+			udp_hdr(skb)->source);
+}
+
 static int udp_rcv(struct sk_buff *skb) {
 	struct sock *sk;
 
@@ -91,10 +110,17 @@ static int udp_rcv(struct sk_buff *skb) {
 		}
 	}
 
-	sk = sock_lookup(NULL, udp_sock_ops,
+	/* Connected sockets come first, then ones bound to the port only */
+	sk = sock_lookup_established(udp_sock_ops,
 			ip_check_version(ip_hdr(skb))
-				? udp4_rcv_tester : udp6_rcv_tester,
-			skb);
+				? udp4_rcv_tester_strict : udp6_rcv_tester_strict,
+			skb, udp_rcv_hash(skb));
+	if (sk == NULL) {
+		sk = sock_lookup_bound(udp_sock_ops,
+				ip_check_version(ip_hdr(skb))
+					? udp4_rcv_tester : udp6_rcv_tester,
+				skb, sock_hash_port(udp_hdr(skb)->dest));
+	}
 	if (sk != NULL) {
 		if (ip_check_version(ip_hdr(skb))
 				? udp4_accept_dst(sk, skb)
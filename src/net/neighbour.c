@@ -16,6 +16,7 @@
 #include <util/array.h>
 #include <sys/time.h>
 #include <kernel/time/ktime.h>
+#include <kernel/time/time.h>
 #include <kernel/time/timer.h>
 #include <net/l0/net_tx.h>
 #include <util/binalign.h>
@@ -32,38 +33,131 @@
 
 #define MODOPS_NEIGHBOUR_AMOUNT   OPTION_GET(NUMBER, neighbour_amount)
 #define MODOPS_NEIGHBOUR_EXPIRE   OPTION_GET(NUMBER, neighbour_expire)
-#define MODOPS_NEIGHBOUR_TMR_FREQ OPTION_GET(NUMBER, neighbour_tmr_freq)
 #define MODOPS_NEIGHBOUR_RESEND   OPTION_GET(NUMBER, neighbour_resend)
 #define MODOPS_NEIGHBOUR_ATTEMPT  OPTION_GET(NUMBER, neighbour_attempt)
+#define MODOPS_NEIGHBOUR_HASH_SIZE OPTION_GET(NUMBER, neighbour_hash_size)
+#define MODOPS_NEIGHBOUR_QUEUE_LEN OPTION_GET(NUMBER, neighbour_queue_len)
 
 EMBOX_UNIT_INIT(neighbour_init);
 
 POOL_DEF(neighbour_pool, struct neighbour, MODOPS_NEIGHBOUR_AMOUNT);
-static DLIST_DEFINE(neighbour_list);
-static struct sys_timer neighbour_tmr;
+static DLIST_DEFINE(neighbour_list); /* least recently used go first */
+static struct dlist_head neighbour_paddr_hash[MODOPS_NEIGHBOUR_HASH_SIZE];
+static struct dlist_head neighbour_haddr_hash[MODOPS_NEIGHBOUR_HASH_SIZE];
+
+static void nbr_timer_handler(struct sys_timer *tmr, void *param);
+
+static unsigned char nbr_paddr_len(unsigned short ptype) {
+	return ptype == ETH_P_IPV6 ? sizeof(struct in6_addr)
+		: sizeof(in_addr_t);
+}
+
+static struct dlist_head * nbr_hash(struct dlist_head *table,
+		unsigned short type, const void *addr, unsigned char len,
+		const struct net_device *dev) {
+	const unsigned char *a;
+	unsigned int h;
+
+	h = type ^ (unsigned int)(uintptr_t)dev;
+	for (a = addr; len != 0; --len, ++a) {
+		h = h * 31 + *a;
+	}
+
+	return &table[h % MODOPS_NEIGHBOUR_HASH_SIZE];
+}
+
+static void nbr_timer_update(struct neighbour *nbr) {
+	if (nbr->incomplete) {
+		timer_start(&nbr->tmr, ms2jiffies(MODOPS_NEIGHBOUR_RESEND));
+	}
+	else if (nbr->flags & NEIGHBOUR_FLAG_PERMANENT) {
+		timer_close(&nbr->tmr);
+	}
+	else {
+		timer_start(&nbr->tmr, ms2jiffies(MODOPS_NEIGHBOUR_EXPIRE));
+	}
+}
 
 static void nbr_set_haddr(struct neighbour *nbr, const void *haddr) {
 	assert(nbr != NULL);
 
+	dlist_del_init(&nbr->h_lnk);
+
 	if (haddr != NULL) {
 		nbr->incomplete = 0;
 		memcpy(&nbr->haddr[0], haddr, nbr->hlen);
+		dlist_add_prev(&nbr->h_lnk, nbr_hash(neighbour_haddr_hash,
+					nbr->htype, haddr, nbr->dev->addr_len, nbr->dev));
 	}
 	else {
 		nbr->incomplete = 1;
-		nbr->resend = MODOPS_NEIGHBOUR_RESEND;
 		nbr->sent_times = 0;
 	}
+
+	nbr_timer_update(nbr);
+}
+
+static void nbr_touch(struct neighbour *nbr) {
+	dlist_del(&nbr->lnk);
+	dlist_add_prev(&nbr->lnk, &neighbour_list);
 }
 
 static void nbr_free(struct neighbour *nbr) {
 	assert(nbr != NULL);
 
-	dlist_del_init_entry(nbr, lnk);
+	timer_close(&nbr->tmr);
+	dlist_del_init(&nbr->lnk);
+	dlist_del_init(&nbr->p_lnk);
+	dlist_del_init(&nbr->h_lnk);
 	skb_queue_purge(&nbr->w_queue);
+	nbr->w_queue_len = 0;
+	++nbr->gen; /* invalidate caches */
 	pool_free(&neighbour_pool, nbr);
 }
 
+/**
+ * Allocates entity, evicts least recently used one if the table is full.
+ * Must be called with scheduler locked
+ */
+static struct neighbour * nbr_alloc(unsigned short ptype,
+		const void *paddr, unsigned char plen, struct net_device *dev) {
+	struct neighbour *nbr;
+
+	nbr = pool_alloc(&neighbour_pool);
+	if (nbr == NULL) {
+		dlist_foreach_entry(nbr, &neighbour_list, lnk) {
+			if (!(nbr->flags & NEIGHBOUR_FLAG_PERMANENT)) {
+				nbr_free(nbr);
+				break;
+			}
+		}
+		nbr = pool_alloc(&neighbour_pool);
+		if (nbr == NULL) {
+			return NULL;
+		}
+	}
+
+	dlist_head_init(&nbr->lnk);
+	dlist_head_init(&nbr->p_lnk);
+	dlist_head_init(&nbr->h_lnk);
+	nbr->ptype = ptype;
+	memcpy(nbr->paddr, paddr, plen);
+	nbr->plen = plen;
+	nbr->dev = dev;
+	nbr->flags = 0;
+	skb_queue_init(&nbr->w_queue);
+	nbr->w_queue_len = 0;
+	nbr->sent_times = 0;
+	/* @a gen is kept from the previous use of the memory */
+	timer_init(&nbr->tmr, TIMER_ONESHOT, nbr_timer_handler, nbr);
+
+	dlist_add_prev(&nbr->lnk, &neighbour_list);
+	dlist_add_prev(&nbr->p_lnk, nbr_hash(neighbour_paddr_hash, ptype,
+				paddr, nbr_paddr_len(ptype), dev));
+
+	return nbr;
+}
+
 static struct neighbour * nbr_lookup_by_paddr(unsigned short ptype,
 		const void *paddr, struct net_device *dev) {
 	struct neighbour *nbr;
@@ -71,7 +165,8 @@ static struct neighbour * nbr_lookup_by_paddr(unsigned short ptype,
 	assert(paddr != NULL);
 	assert(dev != NULL);
 
-	dlist_foreach_entry(nbr, &neighbour_list, lnk) {
+	dlist_foreach_entry(nbr, nbr_hash(neighbour_paddr_hash, ptype,
+				paddr, nbr_paddr_len(ptype), dev), p_lnk) {
 		if ((nbr->ptype == ptype)
 				&& (0 == memcmp(&nbr->paddr[0], paddr, nbr->plen))
 				&& (nbr->dev == dev)) {
@@ -89,7 +184,8 @@ static struct neighbour * nbr_lookup_by_haddr(unsigned short htype,
 	assert(haddr != NULL);
 	assert(dev != NULL);
 
-	dlist_foreach_entry(nbr, &neighbour_list, lnk) {
+	dlist_foreach_entry(nbr, nbr_hash(neighbour_haddr_hash, htype,
+				haddr, dev->addr_len, dev), h_lnk) {
 		if ((nbr->htype == htype)
 				&& (0 == memcmp(&nbr->haddr[0], haddr, nbr->hlen))
 				&& (nbr->dev == dev)) {
@@ -140,6 +236,7 @@ static void nbr_drop_w_queue(struct neighbour *nbr) {
 		icmp_discard(skb, ICMP_DEST_UNREACH, ICMP_HOST_UNREACH);
 	}
 
+	nbr->w_queue_len = 0;
 	nbr->sent_times = 0;
 }
 
@@ -180,9 +277,14 @@ static void nbr_flush_w_queue(struct neighbour *nbr) {
 	hdr_info.src_hw = &nbr->dev->dev_addr[0];
 	hdr_info.dst_hw = &nbr->haddr[0];
 
-	while ((skb = skb_queue_pop(&nbr->w_queue)) != NULL) {
-		(void)nbr_build_and_send_pkt(skb, &hdr_info);
+	sched_lock();
+	{
+		while ((skb = skb_queue_pop(&nbr->w_queue)) != NULL) {
+			(void)nbr_build_and_send_pkt(skb, &hdr_info);
+		}
+		nbr->w_queue_len = 0;
 	}
+	sched_unlock();
 }
 
 int neighbour_add(unsigned short ptype, const void *paddr,
@@ -204,45 +306,52 @@ int neighbour_add(unsigned short ptype, const void *paddr,
 		nbr = nbr_lookup_by_paddr(ptype, paddr, dev);
 		exist = nbr != NULL;
 		if (nbr == NULL) {
-			nbr = pool_alloc(&neighbour_pool);
+			nbr = nbr_alloc(ptype, paddr, plen, dev);
+			if (nbr == NULL) {
+				sched_unlock();
+				return -ENOMEM;
+			}
 		}
+
+		nbr->htype = htype;
+		nbr->hlen = hlen;
+		nbr->flags = flags;
+		nbr_set_haddr(nbr, haddr);
 	}
 	sched_unlock();
-	if (nbr == NULL) {
-		return -ENOMEM;
-	}
-
-	nbr->htype = htype;
-	nbr->hlen = hlen;
-	nbr_set_haddr(nbr, haddr);
-	nbr->flags = flags;
-	nbr->expire = MODOPS_NEIGHBOUR_EXPIRE;
 
 	if (exist) {
 		nbr_flush_w_queue(nbr);
 	}
-	else {
-		dlist_head_init(&nbr->lnk);
-		nbr->ptype = ptype;
-		memcpy(nbr->paddr, paddr, plen);
-		nbr->plen = plen;
-		nbr->dev = dev;
-		skb_queue_init(&nbr->w_queue);
-
-		sched_lock();
-		{
-			dlist_add_prev_entry(nbr, &neighbour_list, lnk);
-		}
-		sched_unlock();
+
+	return 0;
+}
+
+static int nbr_get_haddr(struct neighbour *nbr, unsigned short htype,
+		unsigned char hlen_max, void *out_haddr) {
+	if (nbr == NULL) {
+		return -ENOENT;
+	}
+	else if (nbr->htype != htype) {
+		return -ENOENT;
+	}
+	else if (nbr->incomplete) {
+		return -EINPROGRESS;
+	}
+	else if (nbr->hlen > hlen_max) {
+		return -ENOMEM;
 	}
 
+	memcpy(out_haddr, &nbr->haddr[0], nbr->hlen);
+	nbr_touch(nbr);
+
 	return 0;
 }
 
 int neighbour_get_haddr(unsigned short ptype,  const void *paddr,
 		struct net_device *dev, unsigned short htype,
 		unsigned char hlen_max, void *out_haddr) {
-	struct neighbour *nbr;
+	int ret;
 
 	if ((paddr == NULL) || (dev == NULL) || (out_haddr == NULL)) {
 		return -EINVAL;
@@ -250,29 +359,44 @@ int neighbour_get_haddr(unsigned short ptype,  const void *paddr,
 
 	sched_lock();
 	{
-		nbr = nbr_lookup_by_paddr(ptype, paddr, dev);
-		if (nbr == NULL) {
-			sched_unlock();
-			return -ENOENT;
-		}
-		else if (nbr->htype != htype) {
-			sched_unlock();
-			return -ENOENT;
-		}
-		else if (nbr->incomplete) {
-			sched_unlock();
-			return -EINPROGRESS;
-		}
-		else if (nbr->hlen > hlen_max) {
-			sched_unlock();
-			return -ENOMEM;
+		ret = nbr_get_haddr(nbr_lookup_by_paddr(ptype, paddr, dev),
+				htype, hlen_max, out_haddr);
+	}
+	sched_unlock();
+
+	return ret;
+}
+
+int neighbour_get_haddr_cached(struct neighbour_cache *nc,
+		unsigned short ptype, const void *paddr, struct net_device *dev,
+		unsigned short htype, unsigned char hlen_max,
+		void *out_haddr) {
+	struct neighbour *nbr;
+	int ret;
+
+	if ((nc == NULL) || (paddr == NULL) || (dev == NULL)
+			|| (out_haddr == NULL)) {
+		return -EINVAL;
+	}
+
+	sched_lock();
+	{
+		nbr = nc->nbr;
+		if ((nbr == NULL) || (nbr->gen != nc->gen) || (nbr->dev != dev)
+				|| (nbr->ptype != ptype)
+				|| (0 != memcmp(&nbr->paddr[0], paddr, nbr->plen))) {
+			nbr = nbr_lookup_by_paddr(ptype, paddr, dev);
+			if (nbr != NULL) {
+				nc->nbr = nbr;
+				nc->gen = nbr->gen;
+			}
 		}
 
-		memcpy(out_haddr, &nbr->haddr[0], nbr->hlen);
+		ret = nbr_get_haddr(nbr, htype, hlen_max, out_haddr);
 	}
 	sched_unlock();
 
-	return 0;
+	return ret;
 }
 
 int neighbour_get_paddr(unsigned short htype, const void *haddr,
@@ -387,36 +511,33 @@ int neighbour_send_after_resolve(unsigned short ptype,
 	{
 		nbr = nbr_lookup_by_paddr(ptype, paddr, dev);
 		if (nbr == NULL) {
-			nbr = pool_alloc(&neighbour_pool);
+			nbr = nbr_alloc(ptype, paddr, plen, dev);
 			if (nbr == NULL) {
 				sched_unlock();
 				skb_free(skb);
 				return -ENOMEM;
 			}
-			dlist_head_init(&nbr->lnk);
-			nbr->ptype = ptype;
-			memcpy(nbr->paddr, paddr, plen);
-			nbr->plen = plen;
-			nbr->dev = dev;
 			nbr->htype = dev->type;
 			nbr->hlen = dev->addr_len;
 			nbr_set_haddr(nbr, NULL);
-			nbr->flags = 0;
-			skb_queue_init(&nbr->w_queue);
-			nbr->expire = MODOPS_NEIGHBOUR_EXPIRE;
-
-			dlist_add_prev_entry(nbr, &neighbour_list, lnk);
 
 			allocated = 1;
 		}
 		else {
 			allocated = 0;
+			nbr_touch(nbr);
 		}
 
 		resolved = !nbr->incomplete;
 
 		if (!resolved) {
+			if (nbr->w_queue_len == MODOPS_NEIGHBOUR_QUEUE_LEN) {
+				/* drop the oldest packet */
+				skb_free(skb_queue_pop(&nbr->w_queue));
+				--nbr->w_queue_len;
+			}
 			skb_queue_push(&nbr->w_queue, skb);
+			++nbr->w_queue_len;
 		}
 	}
 	sched_unlock();
@@ -438,46 +559,32 @@ int neighbour_send_after_resolve(unsigned short ptype,
 static void nbr_timer_handler(struct sys_timer *tmr, void *param) {
 	struct neighbour *nbr;
 
+	nbr = param;
+	assert(nbr != NULL);
+
 	sched_lock();
 	{
-		dlist_foreach_entry(nbr, &neighbour_list, lnk) {
-			if (nbr->flags & NEIGHBOUR_FLAG_PERMANENT) {
-				continue;
-			}
-			else if (nbr->expire <= MODOPS_NEIGHBOUR_TMR_FREQ) {
-				nbr_free(nbr);
-				continue;
-			}
-
-			nbr->expire -= MODOPS_NEIGHBOUR_TMR_FREQ;
-
-			if (nbr->incomplete) {
-				if (nbr->resend <= MODOPS_NEIGHBOUR_TMR_FREQ) {
-					if (nbr->sent_times == MODOPS_NEIGHBOUR_ATTEMPT) {
-						(void)nbr_drop_w_queue(nbr);
-						nbr_free(nbr);
-					}
-					else {
-						(void)nbr_send_request(nbr);
-						nbr->resend = MODOPS_NEIGHBOUR_RESEND;
-					}
-				}
-				else {
-					nbr->resend -= MODOPS_NEIGHBOUR_TMR_FREQ;
-				}
-			}
+		if (!nbr->incomplete) {
+			nbr_free(nbr); /* expired */
+		}
+		else if (nbr->sent_times == MODOPS_NEIGHBOUR_ATTEMPT) {
+			(void)nbr_drop_w_queue(nbr);
+			nbr_free(nbr);
+		}
+		else {
+			(void)nbr_send_request(nbr);
+			nbr_timer_update(nbr);
 		}
 	}
 	sched_unlock();
 }
 
 static int neighbour_init(void) {
-	int ret;
+	size_t i;
 
-	ret = timer_init_start_msec(&neighbour_tmr, TIMER_PERIODIC,
-			MODOPS_NEIGHBOUR_TMR_FREQ, nbr_timer_handler, NULL);
-	if (ret != 0) {
-		return ret;
+	for (i = 0; i < MODOPS_NEIGHBOUR_HASH_SIZE; ++i) {
+		dlist_init(&neighbour_paddr_hash[i]);
+		dlist_init(&neighbour_haddr_hash[i]);
 	}
 
 	return 0;
@@ -10,6 +10,9 @@
 #include <mem/misc/pool.h>
 #include <framework/mod/options.h>
 #include <assert.h>
+#include <stdint.h>
+#include <kernel/spinlock.h>
+#include <kernel/thread/sync/mutex.h>
 #include <net/netfilter.h>
 #include <net/skbuff.h>
 #include <net/l3/ipv4/ip.h>
@@ -20,6 +23,7 @@
 #include <net/l4/tcp.h>
 
 #define MODOPS_NETFILTER_AMOUNT_RULES  OPTION_GET(NUMBER, amount_rules)
+#define MODOPS_NETFILTER_HASH_SIZE     OPTION_GET(NUMBER, hash_size)
 
 /**
  * Storage of nf_rule structure
@@ -40,10 +44,142 @@ static enum nf_target nf_input_default_target = NF_TARGET_ACCEPT;
 static enum nf_target nf_forward_default_target = NF_TARGET_ACCEPT;
 static enum nf_target nf_output_default_target = NF_TARGET_ACCEPT;
 
-static void free_rule(struct nf_rule *r) {
-	assert(r != NULL);
-	dlist_del_init(&r->lnk);
-	pool_free(&nf_rule_pool, r);
+/**
+ * Compiled chains
+ *
+ * Every rule with a positive exact match on destination port,
+ * destination address or source address (checked in this order) is
+ * put into a bucket of the corresponding hash table, all the others
+ * (negations, hw addresses, callbacks and wildcards) go to the @a any
+ * list. Entries keep the chain order and each list is sorted by it, so
+ * the first match of the chain is the first match among the lists
+ * which the packet may hit.
+ */
+enum {
+	NF_CLS_DPORT,
+	NF_CLS_DADDR,
+	NF_CLS_SADDR,
+	NF_CLS_HASHES,
+	NF_CLS_ANY = NF_CLS_HASHES
+};
+
+struct nf_cls_ent {
+	struct nf_rule rule;      /* Copy of the matching part of the rule */
+	struct nf_rule *orig;     /* Rule of the chain to update counters */
+	struct nf_cls_ent *next;  /* Next entry in the same list */
+};
+
+struct nf_cls {
+	struct nf_cls_ent *hash[NF_CLS_HASHES][MODOPS_NETFILTER_HASH_SIZE];
+	struct nf_cls_ent *any;
+	struct nf_cls_ent *fast;  /* First rule if it matches state only */
+	struct nf_cls_ent ent[MODOPS_NETFILTER_AMOUNT_RULES];
+};
+
+struct nf_chain_cls {
+	struct nf_cls *active; /* Used for packets, NULL if chain is empty */
+	struct nf_cls buff[2]; /* Active one and the one to compile next */
+	spinlock_t lock;       /* Protects @a active and rule counters */
+};
+
+static struct nf_chain_cls nf_input_cls = { .lock = SPIN_STATIC_UNLOCKED };
+static struct nf_chain_cls nf_forward_cls = { .lock = SPIN_STATIC_UNLOCKED };
+static struct nf_chain_cls nf_output_cls = { .lock = SPIN_STATIC_UNLOCKED };
+
+/**
+ * Serializes changes of chains
+ */
+static struct mutex nf_mutex = MUTEX_INIT(nf_mutex);
+
+static struct nf_chain_cls *nf_get_chain_cls(int chain) {
+	switch (chain) {
+	default: return NULL;
+	case NF_CHAIN_INPUT: return &nf_input_cls;
+	case NF_CHAIN_FORWARD: return &nf_forward_cls;
+	case NF_CHAIN_OUTPUT: return &nf_output_cls;
+	}
+}
+
+static inline unsigned int nf_cls_hash(uint32_t key) {
+	key ^= key >> 16;
+	key ^= key >> 8;
+	return key % MODOPS_NETFILTER_HASH_SIZE;
+}
+
+static struct nf_cls_ent **nf_cls_list(struct nf_cls *cls,
+		const struct nf_rule *r) {
+	if (r->set_dport && !r->not_dport) {
+		return &cls->hash[NF_CLS_DPORT][nf_cls_hash(r->dport)];
+	}
+	else if (r->set_daddr && !r->not_daddr) {
+		return &cls->hash[NF_CLS_DADDR][nf_cls_hash(r->daddr.s_addr)];
+	}
+	else if (r->set_saddr && !r->not_saddr) {
+		return &cls->hash[NF_CLS_SADDR][nf_cls_hash(r->saddr.s_addr)];
+	}
+	else {
+		return &cls->any;
+	}
+}
+
+static int nf_rule_state_only(const struct nf_rule *r) {
+	return r->set_ctstate && !r->not_ctstate && !r->test_hnd
+		&& !r->set_hwaddr_src && !r->set_hwaddr_dst
+		&& !r->set_saddr && !r->set_daddr
+		&& ((r->proto == NF_PROTO_ALL) && !r->not_proto)
+		&& !r->set_sport && !r->set_dport;
+}
+
+/**
+ * Compiles the chain into the spare classifier and makes it active.
+ * Must be called with @a nf_mutex held
+ */
+static void nf_chain_compile(int chain) {
+	struct dlist_head *rules;
+	struct nf_chain_cls *chain_cls;
+	struct nf_cls *cls;
+	struct nf_cls_ent *e, **list;
+	struct nf_rule *r;
+	size_t n;
+	ipl_t ipl;
+
+	rules = nf_get_chain(chain);
+	chain_cls = nf_get_chain_cls(chain);
+	assert((rules != NULL) && (chain_cls != NULL));
+
+	cls = chain_cls->active == &chain_cls->buff[0]
+		? &chain_cls->buff[1] : &chain_cls->buff[0];
+	memset(cls->hash, 0, sizeof cls->hash);
+	cls->any = cls->fast = NULL;
+
+	n = 0;
+	dlist_foreach_entry(r, rules, lnk) {
+		if (r->target == NF_TARGET_UNKNOWN) {
+			continue; /* never matches */
+		}
+		assert(n < MODOPS_NETFILTER_AMOUNT_RULES);
+		e = &cls->ent[n++];
+		memcpy(&e->rule, r, sizeof e->rule);
+		e->orig = r;
+	}
+
+	if ((n != 0) && nf_rule_state_only(&cls->ent[0].rule)) {
+		cls->fast = &cls->ent[0];
+	}
+
+	/* push in reverse order to get lists sorted by chain order */
+	while (n-- > 0) {
+		e = &cls->ent[n];
+		list = nf_cls_list(cls, &e->rule);
+		e->next = *list;
+		*list = e;
+	}
+
+	ipl = spin_lock_ipl(&chain_cls->lock);
+	{
+		chain_cls->active = dlist_empty(rules) ? NULL : cls;
+	}
+	spin_unlock_ipl(&chain_cls->lock, ipl);
 }
 
 int nf_chain_get_by_name(const char *chain_name) {
@@ -252,7 +388,12 @@ int nf_add_rule(int chain, const struct nf_rule *r) {
 		return res;
 	}
 
-	dlist_add_prev(&new_r->lnk, rules);
+	mutex_lock(&nf_mutex);
+	{
+		dlist_add_prev(&new_r->lnk, rules);
+		nf_chain_compile(chain);
+	}
+	mutex_unlock(&nf_mutex);
 
 	return 0;
 }
@@ -267,12 +408,17 @@ int nf_insert_rule(int chain, const struct nf_rule *r, size_t num) {
 		return res;
 	}
 
-	old_r = nf_get_rule_by_num(chain, num);
-	if (!old_r) {
-		dlist_add_prev(&new_r->lnk, rules);
-	} else {
-		dlist_add_prev(&new_r->lnk, &old_r->lnk);
+	mutex_lock(&nf_mutex);
+	{
+		old_r = nf_get_rule_by_num(chain, num);
+		if (!old_r) {
+			dlist_add_prev(&new_r->lnk, rules);
+		} else {
+			dlist_add_prev(&new_r->lnk, &old_r->lnk);
+		}
+		nf_chain_compile(chain);
 	}
+	mutex_unlock(&nf_mutex);
 
 	return 0;
 }
@@ -284,31 +430,41 @@ int nf_set_rule(int chain, const struct nf_rule *r, size_t r_num) {
 		return -EINVAL;
 	}
 
-	new_r = nf_get_rule_by_num(chain, r_num);
-	if (new_r == NULL) {
-		return -ENOENT;
+	mutex_lock(&nf_mutex);
+	{
+		new_r = nf_get_rule_by_num(chain, r_num);
+		if (new_r != NULL) {
+			/* packets are matched against the compiled copy meanwhile */
+			nf_rule_copy(new_r, r);
+			nf_chain_compile(chain);
+		}
 	}
+	mutex_unlock(&nf_mutex);
 
-	nf_rule_copy(new_r, r);
-
-	return 0;
+	return new_r != NULL ? 0 : -ENOENT;
 }
 
 int nf_del_rule(int chain, size_t r_num) {
 	struct nf_rule *r;
 
-	r = nf_get_rule_by_num(chain, r_num);
-	if (r == NULL) {
-		return -ENOENT;
+	mutex_lock(&nf_mutex);
+	{
+		r = nf_get_rule_by_num(chain, r_num);
+		if (r != NULL) {
+			dlist_del_init(&r->lnk);
+			nf_chain_compile(chain);
+			/* the rule is unreachable from packets after recompilation */
+			pool_free(&nf_rule_pool, r);
+		}
 	}
+	mutex_unlock(&nf_mutex);
 
-	free_rule(r);
-
-	return 0;
+	return r != NULL ? 0 : -ENOENT;
 }
 
 int nf_clear(int chain) {
 	struct dlist_head *rules;
+	struct dlist_head removed;
 	struct nf_rule *r;
 
 	rules = nf_get_chain(chain);
@@ -316,8 +472,20 @@ int nf_clear(int chain) {
 		return -EINVAL;
 	}
 
-	dlist_foreach_entry(r, rules, lnk) {
-		free_rule(r);
+	dlist_init(&removed);
+
+	mutex_lock(&nf_mutex);
+	{
+		dlist_foreach_entry(r, rules, lnk) {
+			dlist_move(&r->lnk, &removed);
+		}
+		nf_chain_compile(chain);
+	}
+	mutex_unlock(&nf_mutex);
+
+	dlist_foreach_entry(r, &removed, lnk) {
+		dlist_del_init(&r->lnk);
+		pool_free(&nf_rule_pool, r);
 	}
 
 	return 0;
@@ -330,12 +498,64 @@ int nf_clear(int chain) {
 					sizeof test_r->field))          \
 				!= !!r->not_##field))
 
-int nf_test_rule(int chain, const struct nf_rule *test_r) {
-	struct dlist_head *rules;
-	struct nf_rule *r;
+static int nf_rule_match(const struct nf_rule *r,
+		const struct nf_rule *test_r) {
+	return NF_TEST_NOT_FIELD(test_r, r, hwaddr_src)
+			&& NF_TEST_NOT_FIELD(test_r, r, hwaddr_dst)
+			&& NF_TEST_NOT_FIELD(test_r, r, saddr)
+			&& NF_TEST_NOT_FIELD(test_r, r, daddr)
+			&& (((test_r->proto != NF_PROTO_ALL)
+					&& (r->proto != NF_PROTO_ALL)
+					&& NF_TEST_NOT_FIELD(test_r, r, proto))
+				|| ((test_r->proto == NF_PROTO_ALL) && !test_r->not_proto
+					&& (r->proto == NF_PROTO_ALL) && !r->not_proto)
+				|| ((test_r->proto != NF_PROTO_ALL)
+					&& ((r->proto == NF_PROTO_ALL) && !r->not_proto)))
+			&& NF_TEST_NOT_FIELD(test_r, r, sport)
+			&& NF_TEST_NOT_FIELD(test_r, r, dport)
+			&& (!r->set_ctstate ? 1 : !test_r->set_ctstate ? 0
+				: (0 != (test_r->ctstate & r->ctstate)) != !!r->not_ctstate)
+			&& (!r->test_hnd ? 1 : r->test_hnd(test_r, r->test_hnd_data));
+}
 
-	rules = nf_get_chain(chain);
-	if (rules == NULL) {
+static struct nf_cls_ent *nf_cls_lookup(struct nf_cls *cls,
+		const struct nf_rule *test_r) {
+	struct nf_cls_ent *lists[NF_CLS_HASHES + 1];
+	struct nf_cls_ent *e, *first;
+	int i;
+
+	lists[NF_CLS_DPORT] = !test_r->set_dport ? NULL
+		: cls->hash[NF_CLS_DPORT][nf_cls_hash(test_r->dport)];
+	lists[NF_CLS_DADDR] = !test_r->set_daddr ? NULL
+		: cls->hash[NF_CLS_DADDR][nf_cls_hash(test_r->daddr.s_addr)];
+	lists[NF_CLS_SADDR] = !test_r->set_saddr ? NULL
+		: cls->hash[NF_CLS_SADDR][nf_cls_hash(test_r->saddr.s_addr)];
+	lists[NF_CLS_ANY] = cls->any;
+
+	first = NULL;
+	for (i = 0; i < NF_CLS_HASHES + 1; ++i) {
+		/* entries are in chain order, stop after the current first one */
+		for (e = lists[i]; (e != NULL) && ((first == NULL) || (e < first));
+				e = e->next) {
+			if (nf_rule_match(&e->rule, test_r)) {
+				first = e;
+				break;
+			}
+		}
+	}
+
+	return first;
+}
+
+static int nf_chain_test(int chain, const struct nf_rule *test_r,
+		size_t len) {
+	struct nf_chain_cls *chain_cls;
+	struct nf_cls_ent *e;
+	enum nf_target target;
+	ipl_t ipl;
+
+	chain_cls = nf_get_chain_cls(chain);
+	if (chain_cls == NULL) {
 		return -EINVAL;
 	}
 
@@ -343,28 +563,33 @@ int nf_test_rule(int chain, const struct nf_rule *test_r) {
 		return -EINVAL;
 	}
 
-	dlist_foreach_entry(r, rules, lnk) {
-		if ((r->target != NF_TARGET_UNKNOWN)
-				&& NF_TEST_NOT_FIELD(test_r, r, hwaddr_src)
-				&& NF_TEST_NOT_FIELD(test_r, r, hwaddr_dst)
-				&& NF_TEST_NOT_FIELD(test_r, r, saddr)
-				&& NF_TEST_NOT_FIELD(test_r, r, daddr)
-				&& (((test_r->proto != NF_PROTO_ALL)
-						&& (r->proto != NF_PROTO_ALL)
-						&& NF_TEST_NOT_FIELD(test_r, r, proto))
-					|| ((test_r->proto == NF_PROTO_ALL) && !test_r->not_proto
-						&& (r->proto == NF_PROTO_ALL) && !r->not_proto)
-					|| ((test_r->proto != NF_PROTO_ALL)
-						&& ((r->proto == NF_PROTO_ALL) && !r->not_proto)))
-				&& NF_TEST_NOT_FIELD(test_r, r, sport)
-				&& NF_TEST_NOT_FIELD(test_r, r, dport)
-				&& (!r->test_hnd ? 1 : r->test_hnd(test_r, r->test_hnd_data))) {
-
-			return test_r->target != r->target;
+	target = NF_TARGET_UNKNOWN;
+
+	ipl = spin_lock_ipl(&chain_cls->lock);
+	{
+		if (chain_cls->active != NULL) {
+			e = chain_cls->active->fast;
+			if ((e == NULL) || !nf_rule_match(&e->rule, test_r)) {
+				e = nf_cls_lookup(chain_cls->active, test_r);
+			}
+			if (e != NULL) {
+				++e->orig->pkts;
+				e->orig->bytes += len;
+				target = e->rule.target;
+			}
 		}
 	}
+	spin_unlock_ipl(&chain_cls->lock, ipl);
 
-	return test_r->target != nf_get_chain_target(chain);
+	if (target == NF_TARGET_UNKNOWN) {
+		target = nf_get_chain_target(chain);
+	}
+
+	return test_r->target != target;
+}
+
+int nf_test_rule(int chain, const struct nf_rule *test_r) {
+	return nf_chain_test(chain, test_r, 0);
 }
 
 int nf_test_skb(int chain, enum nf_target target,
@@ -396,8 +621,13 @@ int nf_test_skb(int chain, enum nf_target target,
 		NF_SET_NOT_FIELD(&rule, dport, 0, test_skb->h.uh->dest);
 		break;
 	}
+	if (!(ntohs(test_skb->nh.iph->frag_off) & IP_OFFSET)) {
+		/* Forwarded fragments aren't reassembled. Ones without transport
+		 * header have no connection state, so state rules don't match them */
+		NF_SET_NOT_FIELD(&rule, ctstate, 0, nf_conntrack_in(test_skb));
+	}
 
-	return nf_test_rule(chain, &rule);
+	return nf_chain_test(chain, &rule, test_skb->len);
 }
 
 int nf_test_raw(int chain, enum nf_target target, const void *hwaddr_dst,
@@ -0,0 +1,447 @@
+/**
+ * @file
+ * @brief Connection tracking for netfilter
+ *
+ * Each connection is hashed by the tuples of both its directions, so
+ * the state of a packet is found by a single lookup. Timeouts are kept
+ * as expiration time of connections and collected by a periodic timer.
+ *
+ * @date 17.10.2026
+ */
+
+#include <errno.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+
+#include <embox/unit.h>
+#include <framework/mod/options.h>
+#include <hal/clock.h>
+#include <kernel/spinlock.h>
+#include <kernel/time/time.h>
+#include <kernel/time/timer.h>
+#include <mem/misc/pool.h>
+#include <util/dlist.h>
+
+#include <net/nf_conntrack.h>
+#include <net/skbuff.h>
+#include <net/l3/icmpv4.h>
+#include <net/l3/ipv4/ip.h>
+#include <net/l4/tcp.h>
+#include <net/l4/udp.h>
+
+#define MODOPS_AMOUNT_CONN    OPTION_GET(NUMBER, amount_conn)
+#define MODOPS_HASH_SIZE      OPTION_GET(NUMBER, hash_size)
+#define MODOPS_GC_INTERVAL    OPTION_GET(NUMBER, gc_interval)
+#define MODOPS_TCP_SYN_TMO    OPTION_GET(NUMBER, tcp_timeout_syn)
+#define MODOPS_TCP_EST_TMO    OPTION_GET(NUMBER, tcp_timeout_established)
+#define MODOPS_TCP_CLOSE_TMO  OPTION_GET(NUMBER, tcp_timeout_close)
+#define MODOPS_UDP_TMO        OPTION_GET(NUMBER, udp_timeout)
+#define MODOPS_UDP_STREAM_TMO OPTION_GET(NUMBER, udp_timeout_stream)
+#define MODOPS_ICMP_TMO       OPTION_GET(NUMBER, icmp_timeout)
+
+EMBOX_UNIT_INIT(nf_conntrack_init);
+
+enum nf_ct_dir {
+	NF_CT_DIR_ORIGINAL,
+	NF_CT_DIR_REPLY,
+	NF_CT_DIR_MAX
+};
+
+enum nf_ct_tcp_state {
+	NF_CT_TCP_SYN_SENT,    /* SYN seen */
+	NF_CT_TCP_SYN_RECV,    /* SYN+ACK seen in reply */
+	NF_CT_TCP_ESTABLISHED, /* Handshake is completed */
+	NF_CT_TCP_FIN_WAIT,    /* FIN seen in one direction */
+	NF_CT_TCP_TIME_WAIT,   /* FIN seen in both directions */
+	NF_CT_TCP_CLOSE        /* RST seen */
+};
+
+/**
+ * Connection tuple. For ICMP queries @a sport is an identifier and
+ * @a dport is a type of the message
+ */
+struct nf_ct_tuple {
+	struct in_addr saddr;
+	struct in_addr daddr;
+	in_port_t sport;
+	in_port_t dport;
+	uint8_t proto;
+};
+
+struct nf_ct_tuple_hash {
+	struct dlist_head lnk;
+	struct nf_ct_tuple tuple;
+	enum nf_ct_dir dir;
+};
+
+struct nf_conn {
+	struct nf_ct_tuple_hash tuplehash[NF_CT_DIR_MAX];
+	struct dlist_head lnk;   /* Link in list of all connections */
+	enum nf_ct_tcp_state tcp_state;
+	unsigned int fin_seen;   /* Mask of directions in which FIN was seen */
+	int seen_reply;          /* Reply direction was seen */
+	clock_t expires;         /* Time when connection will be forgotten */
+};
+
+POOL_DEF(nf_conn_pool, struct nf_conn, MODOPS_AMOUNT_CONN);
+
+static struct dlist_head nf_conn_hash[MODOPS_HASH_SIZE];
+static DLIST_DEFINE(nf_conn_list);
+static spinlock_t nf_conn_lock = SPIN_STATIC_UNLOCKED;
+static struct sys_timer nf_conn_gc_timer;
+
+unsigned int nf_ct_state_get_by_name(const char *state_name) {
+	if (state_name == NULL) {
+		return 0;
+	}
+	else if (0 == strcmp(state_name, "INVALID")) {
+		return NF_CT_INVALID;
+	}
+	else if (0 == strcmp(state_name, "NEW")) {
+		return NF_CT_NEW;
+	}
+	else if (0 == strcmp(state_name, "ESTABLISHED")) {
+		return NF_CT_ESTABLISHED;
+	}
+	else if (0 == strcmp(state_name, "RELATED")) {
+		return NF_CT_RELATED;
+	}
+	else {
+		return 0;
+	}
+}
+
+const char *nf_ct_state_to_str(unsigned int state) {
+	switch (state) {
+	default: return NULL;
+	case NF_CT_INVALID: return "INVALID";
+	case NF_CT_NEW: return "NEW";
+	case NF_CT_ESTABLISHED: return "ESTABLISHED";
+	case NF_CT_RELATED: return "RELATED";
+	}
+}
+
+static inline int nf_ct_expired(const struct nf_conn *ct, clock_t now) {
+	return (long)(now - ct->expires) >= 0;
+}
+
+static inline struct nf_conn *nf_ct_tuplehash_to_conn(
+		struct nf_ct_tuple_hash *h) {
+	return (struct nf_conn *)(h - h->dir);
+}
+
+static unsigned int nf_ct_hash(const struct nf_ct_tuple *t) {
+	uint32_t key;
+
+	key = t->saddr.s_addr ^ (t->daddr.s_addr * 31)
+		^ (((uint32_t)t->sport << 16) | t->dport) ^ t->proto;
+	key ^= key >> 16;
+	key ^= key >> 8;
+
+	return key % MODOPS_HASH_SIZE;
+}
+
+static int nf_ct_tuple_equal(const struct nf_ct_tuple *t1,
+		const struct nf_ct_tuple *t2) {
+	return (t1->saddr.s_addr == t2->saddr.s_addr)
+		&& (t1->daddr.s_addr == t2->daddr.s_addr)
+		&& (t1->sport == t2->sport) && (t1->dport == t2->dport)
+		&& (t1->proto == t2->proto);
+}
+
+static uint8_t nf_ct_icmp_reply_type(uint8_t type) {
+	switch (type) {
+	default: return 0xff;
+	case ICMP_ECHO_REQUEST: return ICMP_ECHO_REPLY;
+	case ICMP_TIMESTAMP_REQUEST: return ICMP_TIMESTAMP_REPLY;
+	case ICMP_INFO_REQUEST: return ICMP_INFO_REPLY;
+	}
+}
+
+static void nf_ct_tuple_invert(struct nf_ct_tuple *inv,
+		const struct nf_ct_tuple *t) {
+	inv->saddr = t->daddr;
+	inv->daddr = t->saddr;
+	inv->proto = t->proto;
+	if (t->proto == IPPROTO_ICMP) {
+		inv->sport = t->sport;
+		inv->dport = nf_ct_icmp_reply_type(t->dport);
+	}
+	else {
+		inv->sport = t->dport;
+		inv->dport = t->sport;
+	}
+}
+
+/**
+ * Fills tuple from IP header and first 8 bytes of its payload
+ */
+static void nf_ct_tuple_fill(struct nf_ct_tuple *t, const iphdr_t *iph,
+		const void *l4) {
+	const struct tcphdr *th;
+	const struct udphdr *uh;
+	const struct icmphdr *icmph;
+
+	t->saddr.s_addr = iph->saddr;
+	t->daddr.s_addr = iph->daddr;
+	t->proto = iph->proto;
+	t->sport = t->dport = 0;
+
+	switch (iph->proto) {
+	case IPPROTO_TCP:
+		th = l4;
+		t->sport = th->source;
+		t->dport = th->dest;
+		break;
+	case IPPROTO_UDP:
+		uh = l4;
+		t->sport = uh->source;
+		t->dport = uh->dest;
+		break;
+	case IPPROTO_ICMP:
+		icmph = l4;
+		if (!ICMP_TYPE_ERROR(icmph->type)) {
+			t->sport = icmph->body[0].echo.id;
+			t->dport = icmph->type;
+		}
+		break;
+	}
+}
+
+static struct nf_ct_tuple_hash *nf_ct_find(const struct nf_ct_tuple *t,
+		clock_t now) {
+	struct nf_ct_tuple_hash *h;
+
+	dlist_foreach_entry(h, &nf_conn_hash[nf_ct_hash(t)], lnk) {
+		if (nf_ct_tuple_equal(&h->tuple, t)
+				&& !nf_ct_expired(nf_ct_tuplehash_to_conn(h), now)) {
+			return h;
+		}
+	}
+
+	return NULL;
+}
+
+static void nf_ct_free(struct nf_conn *ct) {
+	dlist_del_init(&ct->lnk);
+	dlist_del_init(&ct->tuplehash[NF_CT_DIR_ORIGINAL].lnk);
+	dlist_del_init(&ct->tuplehash[NF_CT_DIR_REPLY].lnk);
+	pool_free(&nf_conn_pool, ct);
+}
+
+static struct nf_conn *nf_ct_alloc(const struct nf_ct_tuple *t) {
+	struct nf_conn *ct;
+	int dir;
+
+	ct = pool_alloc(&nf_conn_pool);
+	if (ct == NULL) {
+		return NULL;
+	}
+
+	memset(ct, 0, sizeof *ct);
+	memcpy(&ct->tuplehash[NF_CT_DIR_ORIGINAL].tuple, t, sizeof *t);
+	nf_ct_tuple_invert(&ct->tuplehash[NF_CT_DIR_REPLY].tuple, t);
+
+	dlist_head_init(&ct->lnk);
+	dlist_add_prev(&ct->lnk, &nf_conn_list);
+
+	for (dir = 0; dir < NF_CT_DIR_MAX; ++dir) {
+		ct->tuplehash[dir].dir = dir;
+		dlist_head_init(&ct->tuplehash[dir].lnk);
+		dlist_add_prev(&ct->tuplehash[dir].lnk,
+				&nf_conn_hash[nf_ct_hash(&ct->tuplehash[dir].tuple)]);
+	}
+
+	return ct;
+}
+
+/**
+ * Checks whether a packet may start a connection
+ */
+static int nf_ct_new_allowed(const struct nf_ct_tuple *t, const void *l4) {
+	const struct tcphdr *th;
+
+	switch (t->proto) {
+	case IPPROTO_TCP:
+		th = l4;
+		return th->syn && !th->ack && !th->rst;
+	case IPPROTO_ICMP:
+		return nf_ct_icmp_reply_type(t->dport) != 0xff;
+	default:
+		return 1;
+	}
+}
+
+/**
+ * Advances protocol state of a connection
+ *
+ * @return new timeout of the connection in msec
+ */
+static uint32_t nf_ct_update(struct nf_conn *ct, enum nf_ct_dir dir,
+		const void *l4) {
+	const struct tcphdr *th;
+
+	switch (ct->tuplehash[NF_CT_DIR_ORIGINAL].tuple.proto) {
+	case IPPROTO_TCP:
+		th = l4;
+		if (th->rst) {
+			ct->tcp_state = NF_CT_TCP_CLOSE;
+		}
+		else if ((ct->tcp_state == NF_CT_TCP_SYN_SENT)
+				&& (dir == NF_CT_DIR_REPLY) && th->syn && th->ack) {
+			ct->tcp_state = NF_CT_TCP_SYN_RECV;
+		}
+		else if ((ct->tcp_state == NF_CT_TCP_SYN_RECV)
+				&& (dir == NF_CT_DIR_ORIGINAL) && th->ack && !th->syn) {
+			ct->tcp_state = NF_CT_TCP_ESTABLISHED;
+		}
+		else if (((ct->tcp_state == NF_CT_TCP_ESTABLISHED)
+					|| (ct->tcp_state == NF_CT_TCP_FIN_WAIT))
+				&& th->fin) {
+			ct->fin_seen |= 1 << dir;
+			ct->tcp_state = ct->fin_seen == 0x3 ? NF_CT_TCP_TIME_WAIT
+				: NF_CT_TCP_FIN_WAIT;
+		}
+
+		switch (ct->tcp_state) {
+		case NF_CT_TCP_SYN_SENT:
+		case NF_CT_TCP_SYN_RECV:
+			return MODOPS_TCP_SYN_TMO;
+		case NF_CT_TCP_ESTABLISHED:
+			return MODOPS_TCP_EST_TMO;
+		default:
+			return MODOPS_TCP_CLOSE_TMO;
+		}
+	case IPPROTO_ICMP:
+		return MODOPS_ICMP_TMO;
+	default:
+		return ct->seen_reply ? MODOPS_UDP_STREAM_TMO : MODOPS_UDP_TMO;
+	}
+}
+
+/**
+ * ICMP error is related to a connection if it carries a header of
+ * a packet of that connection
+ */
+static unsigned int nf_ct_icmp_error(const struct sk_buff *skb,
+		clock_t now) {
+	const iphdr_t *inner;
+	const uint8_t *end;
+	struct nf_ct_tuple t;
+
+	end = skb->nh.raw + ntohs(skb->nh.iph->tot_len);
+	inner = (const iphdr_t *)skb->h.icmph->body[0].time_exceed.msg;
+	if (((const uint8_t *)inner + IP_MIN_HEADER_SIZE > end)
+			|| ((const uint8_t *)inner + IP_HEADER_SIZE(inner) + 8 > end)) {
+		return NF_CT_INVALID;
+	}
+
+	nf_ct_tuple_fill(&t, inner, (const uint8_t *)inner + IP_HEADER_SIZE(inner));
+
+	return nf_ct_find(&t, now) != NULL ? NF_CT_RELATED : NF_CT_INVALID;
+}
+
+unsigned int nf_conntrack_in(const struct sk_buff *skb) {
+	const iphdr_t *iph;
+	struct nf_ct_tuple t;
+	struct nf_ct_tuple_hash *h;
+	struct nf_conn *ct;
+	enum nf_ct_dir dir;
+	unsigned int state;
+	clock_t now;
+	ipl_t ipl;
+
+	iph = skb->nh.iph;
+	if (ntohs(iph->frag_off) & IP_OFFSET) {
+		return NF_CT_INVALID; /* no transport header to track */
+	}
+
+	now = clock_sys_ticks();
+
+	ipl = spin_lock_ipl(&nf_conn_lock);
+	{
+		if ((iph->proto == IPPROTO_ICMP)
+				&& ICMP_TYPE_ERROR(skb->h.icmph->type)) {
+			state = nf_ct_icmp_error(skb, now);
+			goto out;
+		}
+
+		nf_ct_tuple_fill(&t, iph, skb->h.raw);
+
+		h = nf_ct_find(&t, now);
+		if ((h != NULL) && (h->dir == NF_CT_DIR_ORIGINAL)
+				&& (t.proto == IPPROTO_TCP)
+				&& nf_ct_new_allowed(&t, skb->h.raw)
+				&& (nf_ct_tuplehash_to_conn(h)->tcp_state
+					>= NF_CT_TCP_TIME_WAIT)) {
+			/* new SYN reopens a closed connection */
+			nf_ct_free(nf_ct_tuplehash_to_conn(h));
+			h = NULL;
+		}
+
+		if (h != NULL) {
+			ct = nf_ct_tuplehash_to_conn(h);
+			dir = h->dir;
+		}
+		else {
+			if (!nf_ct_new_allowed(&t, skb->h.raw)) {
+				state = (t.proto == IPPROTO_ICMP)
+					&& (t.dport != ICMP_ECHO_REPLY)
+					&& (t.dport != ICMP_TIMESTAMP_REPLY)
+					&& (t.dport != ICMP_INFO_REPLY)
+					? NF_CT_NEW /* untracked ICMP message */
+					: NF_CT_INVALID;
+				goto out;
+			}
+			ct = nf_ct_alloc(&t);
+			if (ct == NULL) {
+				state = NF_CT_INVALID; /* table is full */
+				goto out;
+			}
+			dir = NF_CT_DIR_ORIGINAL;
+		}
+
+		if (dir == NF_CT_DIR_REPLY) {
+			ct->seen_reply = 1;
+		}
+		ct->expires = now + ms2jiffies(nf_ct_update(ct, dir, skb->h.raw));
+
+		state = ct->seen_reply ? NF_CT_ESTABLISHED : NF_CT_NEW;
+	}
+out:
+	spin_unlock_ipl(&nf_conn_lock, ipl);
+
+	return state;
+}
+
+static void nf_conntrack_gc(struct sys_timer *timer, void *param) {
+	struct nf_conn *ct;
+	clock_t now;
+	ipl_t ipl;
+
+	now = clock_sys_ticks();
+
+	ipl = spin_lock_ipl(&nf_conn_lock);
+	{
+		dlist_foreach_entry(ct, &nf_conn_list, lnk) {
+			if (nf_ct_expired(ct, now)) {
+				nf_ct_free(ct);
+			}
+		}
+	}
+	spin_unlock_ipl(&nf_conn_lock, ipl);
+}
+
+static int nf_conntrack_init(void) {
+	size_t i;
+
+	for (i = 0; i < MODOPS_HASH_SIZE; ++i) {
+		dlist_init(&nf_conn_hash[i]);
+	}
+
+	return timer_init_start_msec(&nf_conn_gc_timer, TIMER_PERIODIC,
+			MODOPS_GC_INTERVAL, nf_conntrack_gc, NULL);
+}
@@ -11,6 +11,7 @@
 #include <assert.h>
 #include <string.h>
 #include <stdint.h>
+#include <errno.h>
 #include <sys/uio.h>
 
 #include <util/math.h>
@@ -19,6 +20,8 @@
 #include <util/binalign.h>
 
 #include <hal/ipl.h>
+#include <hal/cpu.h>
+#include <kernel/cpu/cpudata.h>
 
 #include <mem/misc/pool.h>
 
@@ -29,7 +32,13 @@
 #include <framework/mod/options.h>
 
 #define MODOPS_AMOUNT_SKB       OPTION_GET(NUMBER, amount_skb)
+#define SKB_CACHE_SIZE          OPTION_GET(NUMBER, cpu_cache_size)
+
+#include "skb_cache.h"
+
 POOL_DEF(skb_pool, struct sk_buff, MODOPS_AMOUNT_SKB);
+static spinlock_t skb_pool_lock = SPIN_STATIC_UNLOCKED;
+static struct skb_cache skb_cpu_cache __cpudata__;
 
 struct sk_buff * skb_wrap(size_t size, struct sk_buff_data *skb_data) {
 	return skb_wrap_local(size, skb_data, &skb_pool);
@@ -52,7 +61,13 @@ struct sk_buff * skb_wrap_local(size_t size, struct sk_buff_data *skb_data,
 
 	sp = ipl_save();
 	{
-		skb = pool_alloc(pl);
+		if (pl == &skb_pool) {
+			skb = skb_cache_alloc(cpudata_ptr(&skb_cpu_cache),
+					&skb_pool, &skb_pool_lock);
+		}
+		else {
+			skb = pool_alloc(pl);
+		}
 	}
 	ipl_restore(sp);
 
@@ -61,9 +76,10 @@ struct sk_buff * skb_wrap_local(size_t size, struct sk_buff_data *skb_data,
 		return NULL; /* error: no memory */
 	}
 
-	gettimeofday(&skb->tstamp, NULL);
+	timerclear(&skb->tstamp);
 
 	INIT_LIST_HEAD((struct list_head * )skb);
+	skb->cpu = cpu_get_id();
 	skb->dev = NULL;
 	skb->len = size;
 	skb->nh.raw = skb->h.raw = NULL;
@@ -102,6 +118,21 @@ struct sk_buff * skb_realloc(size_t size, struct sk_buff *skb) {
 		return skb_alloc(size);
 	}
 
+	if (size > skb_data_size(skb->data)) {
+		struct sk_buff_data *skb_data;
+
+		/* data of smaller size class, move to the fitting one */
+		skb_data = skb_data_alloc(size);
+		if (skb_data == NULL) {
+			skb_free(skb);
+			return NULL; /* error: no memory */
+		}
+		memcpy(skb_get_data_pointner(skb_data),
+				skb_get_data_pointner(skb->data), skb->len);
+		skb_data_free(skb->data);
+		skb->data = skb_data;
+	}
+
 	list_del_init((struct list_head *) skb);
 	skb->dev = NULL;
 	skb->len = size;
@@ -124,11 +155,35 @@ void skb_free(struct sk_buff *skb) {
 	{
 		assert((skb->lnk.prev != NULL) && (skb->lnk.next != NULL));
 		list_del((struct list_head *) skb);
-		pool_free(skb->pl, skb);
+		if (skb->pl == &skb_pool) {
+			skb_cache_free(cpudata_ptr(&skb_cpu_cache), &skb_pool,
+					&skb_pool_lock, skb, skb->cpu != cpu_get_id());
+		}
+		else {
+			pool_free(skb->pl, skb);
+		}
 	}
 	ipl_restore(sp);
 }
 
+void skb_timestamp(struct sk_buff *skb) {
+	assert(skb != NULL);
+
+	if (!timerisset(&skb->tstamp)) {
+		gettimeofday(&skb->tstamp, NULL);
+	}
+}
+
+int skb_alloc_stat_get(unsigned int cpu, struct skb_alloc_stat *stat) {
+	if (cpu >= NCPU) {
+		return -EINVAL;
+	}
+
+	memcpy(stat, &cpudata_cpu_var(cpu, skb_cpu_cache).stat, sizeof *stat);
+
+	return 0;
+}
+
 static void skb_copy_ref(struct sk_buff *to, const struct sk_buff *from) {
 	ptrdiff_t offset;
 
@@ -148,6 +203,7 @@ static void skb_copy_ref(struct sk_buff *to, const struct sk_buff *from) {
 		to->h.raw = from->h.raw + offset;
 	}
 	to->p_data = to->p_data_end = NULL;
+	memcpy(&to->tstamp, &from->tstamp, sizeof to->tstamp);
 }
 
 static void skb_shift_ref(struct sk_buff *skb, ptrdiff_t offset) {
@@ -238,11 +294,11 @@ struct sk_buff * skb_declone(struct sk_buff *skb) {
 void skb_rshift(struct sk_buff *skb, size_t count) {
 	assert(skb != NULL);
 	assert(skb->data != NULL);
-	assert(count < skb_max_size());
+	assert(count < skb_data_size(skb->data));
 	memmove(skb_get_data_pointner(skb->data) + count,
 			skb_get_data_pointner(skb->data),
-			min(skb->len, skb_max_size() - count));
-	skb->len += min(count, skb_max_size() - count);
+			min(skb->len, skb_data_size(skb->data) - count));
+	skb->len += min(count, skb_data_size(skb->data) - count);
 }
 
 size_t skb_read(struct sk_buff *skb, char *buff, size_t buff_sz) {
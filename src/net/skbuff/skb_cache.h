@@ -0,0 +1,99 @@
+/**
+ * @file
+ * @brief Per-CPU magazines in front of sk_buff pools.
+ *
+ * Each CPU keeps a small stack of free objects which is accessed with
+ * local interrupts disabled only. The shared pool is touched (under
+ * spinlock) once per batch when the magazine runs empty or full.
+ *
+ * @date 17.10.2026
+ */
+
+#ifndef NET_SKBUFF_SKB_CACHE_H_
+#define NET_SKBUFF_SKB_CACHE_H_
+
+#include <hal/ipl.h>
+#include <kernel/spinlock.h>
+#include <mem/misc/pool.h>
+#include <net/skbuff.h>
+
+#ifndef SKB_CACHE_SIZE
+#define SKB_CACHE_SIZE 32
+#endif
+
+#define SKB_CACHE_BATCH (SKB_CACHE_SIZE / 2)
+
+struct skb_cache {
+	unsigned int count;
+	void *obj[SKB_CACHE_SIZE];
+	struct skb_alloc_stat stat;
+};
+
+static inline void skb_cache_refill(struct skb_cache *c, struct pool *pl,
+		spinlock_t *lock) {
+	void *obj;
+
+	spin_lock(lock);
+	{
+		while (c->count < SKB_CACHE_BATCH) {
+			obj = pool_alloc(pl);
+			if (obj == NULL) {
+				break;
+			}
+			c->obj[c->count++] = obj;
+		}
+	}
+	spin_unlock(lock);
+
+	++c->stat.refill;
+}
+
+static inline void skb_cache_flush(struct skb_cache *c, struct pool *pl,
+		spinlock_t *lock) {
+	spin_lock(lock);
+	{
+		while (c->count > SKB_CACHE_BATCH) {
+			pool_free(pl, c->obj[--c->count]);
+		}
+	}
+	spin_unlock(lock);
+
+	++c->stat.flush;
+}
+
+/**
+ * Must be called with local interrupts disabled, @a c is the magazine
+ * of the current CPU
+ */
+static inline void * skb_cache_alloc(struct skb_cache *c, struct pool *pl,
+		spinlock_t *lock) {
+	if (c->count == 0) {
+		skb_cache_refill(c, pl, lock);
+		if (c->count == 0) {
+			return NULL;
+		}
+	}
+
+	++c->stat.alloc;
+	return c->obj[--c->count];
+}
+
+/**
+ * Must be called with local interrupts disabled, @a c is the magazine
+ * of the current CPU, @a remote is set if @a obj was allocated on
+ * another CPU
+ */
+static inline void skb_cache_free(struct skb_cache *c, struct pool *pl,
+		spinlock_t *lock, void *obj, int remote) {
+	if (c->count == SKB_CACHE_SIZE) {
+		skb_cache_flush(c, pl, lock);
+	}
+
+	++c->stat.free;
+	if (remote) {
+		++c->stat.remote_free;
+	}
+	c->obj[c->count++] = obj;
+}
+
+#endif /* NET_SKBUFF_SKB_CACHE_H_ */
@@ -11,6 +11,7 @@
 #include <assert.h>
 #include <string.h>
 #include <stdint.h>
+#include <errno.h>
 
 #include <util/math.h>
 #include <util/log.h>
@@ -18,6 +19,8 @@
 #include <util/binalign.h>
 
 #include <hal/ipl.h>
+#include <hal/cpu.h>
+#include <kernel/cpu/cpudata.h>
 
 #include <mem/misc/pool.h>
 
@@ -29,40 +32,95 @@
 #define MODOPS_DATA_SIZE        OPTION_GET(NUMBER, data_size)
 #define MODOPS_DATA_ALIGN       OPTION_GET(NUMBER, data_align)
 #define MODOPS_DATA_PADTO       OPTION_GET(NUMBER, data_padto)
+#define SKB_CACHE_SIZE          OPTION_GET(NUMBER, cpu_cache_size)
+
+#define MODOPS_AMOUNT_SMALL     OPTION_GET(NUMBER, amount_small_skb_data)
+#define MODOPS_SMALL_SIZE       OPTION_GET(NUMBER, small_data_size)
+#define MODOPS_AMOUNT_MEDIUM    OPTION_GET(NUMBER, amount_medium_skb_data)
+#define MODOPS_MEDIUM_SIZE      OPTION_GET(NUMBER, medium_data_size)
+#define MODOPS_AMOUNT_JUMBO     OPTION_GET(NUMBER, amount_jumbo_skb_data)
+#define MODOPS_JUMBO_SIZE       OPTION_GET(NUMBER, jumbo_data_size)
+
+#include "skb_cache.h"
 
 #define IP_ALIGN_SIZE \
 	(OPTION_GET(BOOLEAN, ip_align) ? 2 : 0)
 
-#define DATA_PAD_SIZE \
-	PAD_SIZE(IP_ALIGN_SIZE + MODOPS_DATA_SIZE, MODOPS_DATA_PADTO)
+#define DATA_PAD_SIZE(size) \
+	PAD_SIZE(IP_ALIGN_SIZE + (size), MODOPS_DATA_PADTO)
 #define DATA_ATTR \
 	__attribute__((aligned(MODOPS_DATA_ALIGN)))
 
 #define SKB_DATA_SIZE(size) \
 	IP_ALIGN_SIZE + MODOPS_DATA_SIZE + (size) + sizeof(size_t)
 
-struct sk_buff_data_fixed {
-	size_t links;
-
-	char __ip_align[IP_ALIGN_SIZE];
-	unsigned char data[MODOPS_DATA_SIZE];
-	char __data_pad[DATA_PAD_SIZE];
-};
+/* Layout of a data block of class with @a size bytes of payload */
+#define SKB_DATA_FIXED(size) \
+	struct { \
+		size_t links; \
+		unsigned int cpu; \
+		unsigned int cls; \
+		char __ip_align[IP_ALIGN_SIZE]; \
+		unsigned char data[size]; \
+		char __data_pad[DATA_PAD_SIZE(size)]; \
+	}
 
 struct sk_buff_data {
 	size_t links;
+	unsigned int cpu; /* CPU the data was allocated on */
+	unsigned int cls; /* Size class the data belongs to */
 
 	char __data[];
 } DATA_ATTR;
 
-POOL_DEF(skb_data_pool, struct sk_buff_data_fixed, MODOPS_AMOUNT_SKB_DATA);
+/* Size classes in ascending order, data_size is the MTU-sized one */
+enum {
+	SKB_DATA_SMALL,
+	SKB_DATA_MEDIUM,
+	SKB_DATA_MTU,
+	SKB_DATA_JUMBO,
+	SKB_DATA_CLASSES
+};
+
+POOL_DEF(skb_data_small_pool, SKB_DATA_FIXED(MODOPS_SMALL_SIZE),
+		MODOPS_AMOUNT_SMALL);
+POOL_DEF(skb_data_medium_pool, SKB_DATA_FIXED(MODOPS_MEDIUM_SIZE),
+		MODOPS_AMOUNT_MEDIUM);
+POOL_DEF(skb_data_pool, SKB_DATA_FIXED(MODOPS_DATA_SIZE),
+		MODOPS_AMOUNT_SKB_DATA);
+POOL_DEF(skb_data_jumbo_pool, SKB_DATA_FIXED(MODOPS_JUMBO_SIZE),
+		MODOPS_AMOUNT_JUMBO);
+
+static const struct skb_data_class {
+	struct pool *pl;
+	size_t size;
+	size_t amount;
+} skb_data_classes[SKB_DATA_CLASSES] = {
+	[SKB_DATA_SMALL]  = { &skb_data_small_pool, MODOPS_SMALL_SIZE,
+				MODOPS_AMOUNT_SMALL },
+	[SKB_DATA_MEDIUM] = { &skb_data_medium_pool, MODOPS_MEDIUM_SIZE,
+				MODOPS_AMOUNT_MEDIUM },
+	[SKB_DATA_MTU]    = { &skb_data_pool, MODOPS_DATA_SIZE,
+				MODOPS_AMOUNT_SKB_DATA },
+	[SKB_DATA_JUMBO]  = { &skb_data_jumbo_pool, MODOPS_JUMBO_SIZE,
+				MODOPS_AMOUNT_JUMBO },
+};
+
+static spinlock_t skb_data_pool_lock = SPIN_STATIC_UNLOCKED;
+static struct skb_cache skb_data_cpu_cache[SKB_DATA_CLASSES] __cpudata__;
 
 void *skb_get_data_pointner(struct sk_buff_data *skb_data) {
 	return skb_data->__data + IP_ALIGN_SIZE;
 }
 
 size_t skb_max_size(void) {
-	return MODOPS_DATA_SIZE;
+	return MODOPS_AMOUNT_JUMBO != 0 ? MODOPS_JUMBO_SIZE : MODOPS_DATA_SIZE;
+}
+
+size_t skb_data_size(const struct sk_buff_data *skb_data) {
+	assert(skb_data != NULL);
+	assert(skb_data->cls < SKB_DATA_CLASSES);
+	return skb_data_classes[skb_data->cls].size;
 }
 
 void * skb_data_cast_in(struct sk_buff_data *skb_data) {
@@ -78,13 +136,23 @@ struct sk_buff_data * skb_data_cast_out(void *data) {
 struct sk_buff_data * skb_data_alloc(size_t size) {
 	ipl_t sp;
 	struct sk_buff_data *skb_data;
+	unsigned int cls;
 
 	skb_data = NULL;
 
 	sp = ipl_save();
 	{
-		if (skb_max_size() >= size) {
-			skb_data = pool_alloc(&skb_data_pool);
+		/* smallest class that fits, larger ones if it's exhausted */
+		for (cls = 0; cls < SKB_DATA_CLASSES; ++cls) {
+			if ((skb_data_classes[cls].size < size)
+					|| (skb_data_classes[cls].amount == 0)) {
+				continue;
+			}
+			skb_data = skb_cache_alloc(cpudata_ptr(&skb_data_cpu_cache[cls]),
+					skb_data_classes[cls].pl, &skb_data_pool_lock);
+			if (skb_data != NULL) {
+				break;
+			}
 		}
 	}
 	ipl_restore(sp);
@@ -95,6 +163,8 @@ struct sk_buff_data * skb_data_alloc(size_t size) {
 	}
 
 	skb_data->links = 1;
+	skb_data->cpu = cpu_get_id();
+	skb_data->cls = cls;
 
 	return skb_data;
 }
@@ -125,10 +195,37 @@ void skb_data_free(struct sk_buff_data *skb_data) {
 	sp = ipl_save();
 	{
 		if (--skb_data->links == 0) {
-			assert(pool_belong(&skb_data_pool, skb_data));
+			const struct skb_data_class *c;
+
+			assert(skb_data->cls < SKB_DATA_CLASSES);
+			c = &skb_data_classes[skb_data->cls];
+			assert(pool_belong(c->pl, skb_data));
 
-			pool_free(&skb_data_pool, skb_data);
+			skb_cache_free(cpudata_ptr(&skb_data_cpu_cache[skb_data->cls]),
+					c->pl, &skb_data_pool_lock, skb_data,
+					skb_data->cpu != cpu_get_id());
 		}
 	}
 	ipl_restore(sp);
 }
+
+int skb_data_alloc_stat_get(unsigned int cpu, struct skb_alloc_stat *stat) {
+	const struct skb_alloc_stat *st;
+	unsigned int cls;
+
+	if (cpu >= NCPU) {
+		return -EINVAL;
+	}
+
+	memset(stat, 0, sizeof *stat);
+	for (cls = 0; cls < SKB_DATA_CLASSES; ++cls) {
+		st = &cpudata_cpu_ptr(cpu, &skb_data_cpu_cache[cls])->stat;
+		stat->alloc += st->alloc;
+		stat->free += st->free;
+		stat->remote_free += st->remote_free;
+		stat->refill += st->refill;
+		stat->flush += st->flush;
+	}
+
+	return 0;
+}
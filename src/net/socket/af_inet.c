@@ -59,6 +59,7 @@ static int inet_init(struct sock *sk) {
 	in_sk->sk.dst_addr = (const struct sockaddr *)&in_sk->dst_in;
 	in_sk->sk.addr_len = sizeof(struct sockaddr_in);
 	memset(&in_sk->opt, 0, sizeof in_sk->opt);
+	memset(&in_sk->rt_cache, 0, sizeof in_sk->rt_cache);
 
 	return 0;
 }
@@ -81,6 +82,7 @@ static void __inet_bind(struct inet_sock *in_sk,
 	assert(addr_in != NULL);
 	assert(addr_in->sin_family == AF_INET);
 	memcpy(&in_sk->src_in, addr_in, sizeof *addr_in);
+	sock_rehash(&in_sk->sk);
 }
 
 static int inet_addr_tester(const struct sockaddr *lhs_sa,
@@ -190,6 +192,7 @@ static int __inet_connect(struct inet_sock *in_sk,
 	in_sk->src_in.sin_addr.s_addr = src_ip;
 
 	memcpy(&in_sk->dst_in, addr_in, sizeof *addr_in);
+	sock_rehash(&in_sk->sk);
 
 	return 0;
 }
@@ -239,6 +239,8 @@ void sock_packet_add(struct sk_buff *skb, unsigned short protocol) {
 				|| psk->sll.sll_ifindex == skb->dev->index);
 
 		if (proto_check && iface_check) {
+			/* packet sockets report receive time (SIOCGSTAMP) */
+			skb_timestamp(skb);
 			skb_queue_push(&psk->rx_q, skb_clone(skb));
 			sock_notify(&psk->sk, POLLIN | POLLERR);
 		}
@@ -11,6 +11,7 @@
 #include <hal/ipl.h>
 #include <mem/misc/pool.h>
 #include <net/sock.h>
+#include <net/sock_wait.h>
 
 #include "family.h"
 #include "net_sock.h"
@@ -114,6 +115,9 @@ static void sock_init(struct sock *sk, int family, int type,
 	assert(p_ops != NULL);
 
 	dlist_head_init(&sk->lnk);
+	dlist_head_init(&sk->hash_lnk);
+	dlist_head_init(&sk->notify_lnk);
+	sk->notify_flags = 0;
 	sock_opt_init(&sk->opt, family, type, protocol);
 	skb_queue_init(&sk->rx_queue);
 	skb_queue_init(&sk->tx_queue);
@@ -193,6 +197,7 @@ void sock_release(struct sock *sk) {
 	}
 
 	sock_unhash(sk);
+	sock_notify_cancel(sk);
 	skb_queue_purge(&sk->rx_queue);
 	skb_queue_purge(&sk->tx_queue);
 	sock_free(sk);
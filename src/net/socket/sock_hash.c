@@ -5,19 +5,147 @@
  * @author: Anton Bondarev
  */
 #include <net/sock.h>
+#include <net/socket/sock_hash.h>
+#include <net/socket/inet_sock.h>
+#include <net/socket/inet6_sock.h>
 #include <util/dlist.h>
+#include <hal/ipl.h>
+
+static_assert((SOCK_HASH_SIZE & (SOCK_HASH_SIZE - 1)) == 0);
+
+static void sock_hashtable_init(struct sock_hashtable *table) {
+	int i;
+
+	for (i = 0; i < SOCK_HASH_SIZE; i++) {
+		dlist_init(&table->established[i]);
+		dlist_init(&table->bound[i]);
+	}
+	table->inited = 1;
+}
+
+static struct dlist_head * sock_bucket(struct sock *sk) {
+	struct sock_hashtable *table = sk->p_ops->sock_table;
+	const struct inet_sock *in_sk;
+	const struct inet6_sock *in6_sk;
+
+	if (!table->inited) {
+		sock_hashtable_init(table);
+	}
+
+	if (sock_inet_get_dst_port(sk) == 0) {
+		return &table->bound[sock_hash_port(sock_inet_get_src_port(sk))];
+	}
+
+	if (sk->opt.so_domain == AF_INET) {
+		in_sk = to_const_inet_sock(sk);
+		return &table->established[sock_hash_tuple(in_sk->src_in.sin_port,
+				in_sk->dst_in.sin_addr.s_addr, in_sk->dst_in.sin_port)];
+	}
+
+	in6_sk = to_const_inet6_sock(sk);
+	return &table->established[sock_hash_tuple(in6_sk->src_in6.sin6_port,
+			sock_hash_in6_addr(&in6_sk->dst_in6.sin6_addr),
+			in6_sk->dst_in6.sin6_port)];
+}
 
 void sock_hash(struct sock *sk) {
+	ipl_t ipl;
+
 	assert(sk != NULL);
 	assert(sk->p_ops != NULL);
 	assert(dlist_empty_entry(sk, lnk));
 
-	dlist_add_prev_entry(sk, sk->p_ops->sock_list, lnk);
+	ipl = ipl_save();
+	{
+		dlist_add_prev_entry(sk, sk->p_ops->sock_list, lnk);
+		if (sk->p_ops->sock_table != NULL) {
+			dlist_add_prev_entry(sk, sock_bucket(sk), hash_lnk);
+		}
+	}
+	ipl_restore(ipl);
+}
+
+void sock_rehash(struct sock *sk) {
+	ipl_t ipl;
+
+	assert(sk != NULL);
+	assert(sk->p_ops != NULL);
+
+	if (sk->p_ops->sock_table == NULL) {
+		return;
+	}
+
+	ipl = ipl_save();
+	{
+		if (!dlist_empty_entry(sk, hash_lnk)) {
+			dlist_del_init_entry(sk, hash_lnk);
+			dlist_add_prev_entry(sk, sock_bucket(sk), hash_lnk);
+		}
+	}
+	ipl_restore(ipl);
 }
 
 void sock_unhash(struct sock *sk) {
+	ipl_t ipl;
+
 	assert(sk != NULL);
 	assert(!dlist_empty_entry(sk, lnk));
 
-	dlist_del_init_entry(sk, lnk);
+	ipl = ipl_save();
+	{
+		dlist_del_init_entry(sk, lnk);
+		if (!dlist_empty_entry(sk, hash_lnk)) {
+			dlist_del_init_entry(sk, hash_lnk);
+		}
+	}
+	ipl_restore(ipl);
+}
+
+static struct sock * sock_lookup_bucket(struct dlist_head *bucket,
+		sock_lookup_tester_ft tester, const struct sk_buff *skb) {
+	struct sock *sk;
+	ipl_t ipl;
+
+	ipl = ipl_save();
+	{
+		dlist_foreach_entry(sk, bucket, hash_lnk) {
+			if (tester(sk, skb)) {
+				ipl_restore(ipl);
+				return sk;
+			}
+		}
+	}
+	ipl_restore(ipl);
+
+	return NULL; /* error: no such entity */
+}
+
+struct sock * sock_lookup_established(const struct sock_proto_ops *p_ops,
+		sock_lookup_tester_ft tester, const struct sk_buff *skb,
+		unsigned int hash) {
+	assert(p_ops != NULL);
+	assert(p_ops->sock_table != NULL);
+	assert(tester != NULL);
+
+	if (!p_ops->sock_table->inited) {
+		return NULL; /* no sockets yet */
+	}
+
+	return sock_lookup_bucket(&p_ops->sock_table->established[hash],
+			tester, skb);
+}
+
+struct sock * sock_lookup_bound(const struct sock_proto_ops *p_ops,
+		sock_lookup_tester_ft tester, const struct sk_buff *skb,
+		unsigned int hash) {
+	assert(p_ops != NULL);
+	assert(p_ops->sock_table != NULL);
+	assert(tester != NULL);
+
+	if (!p_ops->sock_table->inited) {
+		return NULL; /* no sockets yet */
+	}
+
+	return sock_lookup_bucket(&p_ops->sock_table->bound[hash],
+			tester, skb);
 }
@@ -5,6 +5,8 @@
  * @author: Anton Bondarev
  */
 
+#include <hal/ipl.h>
+#include <util/dlist.h>
 #include <fs/idesc.h>
 #include <fs/idesc_event.h>
 #include <kernel/time/time.h>
@@ -13,6 +15,10 @@
 #include <net/sock.h>
 #include <net/sock_wait.h>
 #include <kernel/thread/thread_sched_wait.h>
+#include <assert.h>
+
+static DLIST_DEFINE(sock_notify_pending);
+static int sock_notify_batch;
 
 int sock_wait(struct sock *sk, int flags, int timeout) {
 	struct idesc_wait_link wl;
@@ -27,5 +33,67 @@ int sock_wait(struct sock *sk, int flags, int timeout) {
 }
 
 void sock_notify(struct sock *sk, int flags) {
+	ipl_t ipl;
+
+	if (sock_notify_batch) {
+		ipl = ipl_save();
+		{
+			sk->notify_flags |= flags;
+			if (dlist_empty(&sk->notify_lnk)) {
+				dlist_add_prev(&sk->notify_lnk, &sock_notify_pending);
+			}
+		}
+		ipl_restore(ipl);
+		return;
+	}
+
 	idesc_notify(&sk->idesc, flags);
 }
+
+void sock_notify_batch_begin(void) {
+	++sock_notify_batch;
+}
+
+void sock_notify_batch_end(void) {
+	struct sock *sk;
+	int flags;
+	ipl_t ipl;
+
+	assert(sock_notify_batch > 0);
+	if (--sock_notify_batch != 0) {
+		return;
+	}
+
+	while (1) {
+		ipl = ipl_save();
+		{
+			sk = dlist_first_entry_or_null(&sock_notify_pending, struct sock,
+					notify_lnk);
+			if (sk != NULL) {
+				dlist_del_init(&sk->notify_lnk);
+				flags = sk->notify_flags;
+				sk->notify_flags = 0;
+			}
+		}
+		ipl_restore(ipl);
+
+		if (sk == NULL) {
+			break;
+		}
+
+		idesc_notify(&sk->idesc, flags);
+	}
+}
+
+void sock_notify_cancel(struct sock *sk) {
+	ipl_t ipl;
+
+	ipl = ipl_save();
+	{
+		if (!dlist_empty(&sk->notify_lnk)) {
+			dlist_del_init(&sk->notify_lnk);
+		}
+		sk->notify_flags = 0;
+	}
+	ipl_restore(ipl);
+}
@@ -19,6 +19,7 @@
 #include <net/l3/ipv4/ip.h>
 #include <net/l2/ethernet.h>
 #include <net/sock.h>
+#include <net/socket/sock_hash.h>
 
 #include <kernel/time/time.h>
 #include <kernel/sched.h>
@@ -83,8 +84,7 @@ static int tcp_init(struct sock *sk) {
 	tcp_sk->free_wait_queue_len = tcp_sk->free_wait_queue_max = 0;
 	tcp_sk->lock = 0;
 	/* timerclear(&sock.tcp_sk->syn_time); */
-	timerclear(&tcp_sk->ack_time);
-	timerclear(&tcp_sk->rcv_time);
+	tcp_timer_init(tcp_sk);
 	tcp_sk->dup_ack = 0;
 	tcp_sk->rexmit_mode = 0;
 
@@ -375,15 +375,46 @@ static int tcp_accept(struct sock *sk, struct sockaddr *addr,
 	return 0;
 }
 
-static int tcp_write(struct tcp_sock *tcp_sk, void *buff, size_t len) {
-	void *pb;
+/**
+ * Gather @a len bytes from iovec into @a buff starting at position
+ * (@a i_io, @a iov_off) and advance that position
+ */
+static void tcp_iovec_gather(void *buff, size_t len,
+		const struct iovec *iov, int *i_io, size_t *iov_off) {
+	size_t to_copy;
+
+	while (len != 0) {
+		to_copy = min(iov[*i_io].iov_len - *iov_off, len);
+		memcpy(buff, iov[*i_io].iov_base + *iov_off, to_copy);
+		buff += to_copy;
+		len -= to_copy;
+		*iov_off += to_copy;
+		if (*iov_off == iov[*i_io].iov_len) {
+			++*i_io;
+			*iov_off = 0;
+		}
+	}
+}
+
+static int tcp_write(struct tcp_sock *tcp_sk, const struct iovec *iov,
+		int iovlen) {
 	struct sk_buff *skb;
-	int ret;
+	size_t len, sent, iov_off;
+	int ret, i_io;
+
+	len = 0;
+	for (i_io = 0; i_io < iovlen; ++i_io) {
+		len += iov[i_io].iov_len;
+	}
 
-	pb = buff;
+	i_io = 0;
+	iov_off = 0;
+	sent = 0;
 	while (len != 0) {
 		/* Previous comment: try to send wholly msg
-		 * We must pass no more than 64k bytes to underlaying IP level */
+		 * We must pass no more than 64k bytes to underlaying IP level.
+		 * Segments are filled across iovec boundaries, so writev
+		 * doesn't produce a small segment per buffer */
 		size_t bytes = min(len, IP_MAX_PACKET_LEN - MAX_HEADER_SIZE);
 		skb = NULL; /* alloc new pkg */
 
@@ -399,15 +430,15 @@ static int tcp_write(struct tcp_sock *tcp_sk, void *buff, size_t len) {
 				sock_inet_get_src_port(to_sock(tcp_sk)),
 				TCP_MIN_HEADER_SIZE, tcp_sk->self.wind.value);
 
-		memcpy(skb->h.th + 1, pb, bytes);
-		pb += bytes;
+		tcp_iovec_gather(skb->h.th + 1, bytes, iov, &i_io, &iov_off);
+		sent += bytes;
 		len -= bytes;
 		/* Fill TCP header */
 		skb->h.th->psh = (len == 0);
 		tcp_set_ack_field(skb->h.th, tcp_sk->rem.seq);
 		send_seq_from_sock(tcp_sk, skb);
 	}
-	return pb - buff;
+	return sent;
 }
 
 #if MAX_SIMULTANEOUS_TX_PACK > 0
@@ -484,7 +515,7 @@ sendmsg_again:
 		}
 		sched_unlock();
 
-		len = tcp_write(tcp_sk, msg->msg_iov->iov_base, msg->msg_iov->iov_len);
+		len = tcp_write(tcp_sk, msg->msg_iov, msg->msg_iovlen);
 		ret = tcp_wait_tx_ready(sk, timeout);
 		if (0 > ret) {
 			return ret;
@@ -559,6 +590,7 @@ static int tcp_setsockopt(struct sock *sk, int level, int optname,
 
 POOL_DEF(tcp_sock_pool, struct tcp_sock, MODOPS_AMOUNT_TCP_SOCK);
 static DLIST_DEFINE(tcp_sock_list);
+static struct sock_hashtable tcp_sock_table;
 
 static const struct sock_proto_ops tcp_sock_ops_struct = {
 	.init       = tcp_init,
@@ -571,5 +603,6 @@ static const struct sock_proto_ops tcp_sock_ops_struct = {
 	.setsockopt = tcp_setsockopt,
 	.shutdown   = tcp_shutdown,
 	.sock_pool  = &tcp_sock_pool,
-	.sock_list  = &tcp_sock_list
+	.sock_list  = &tcp_sock_list,
+	.sock_table = &tcp_sock_table
 };
@@ -22,6 +22,7 @@
 #include <net/lib/udp.h>
 #include <net/sock.h>
 #include <net/socket/inet_sock.h>
+#include <net/socket/sock_hash.h>
 
 #include <util/dlist.h>
 
@@ -87,6 +88,7 @@ static int udp_sendmsg(struct sock *sk, struct msghdr *msg, int flags) {
 }
 
 static DLIST_DEFINE(udp_sock_list);
+static struct sock_hashtable udp_sock_table;
 
 static int udp_fillmsg(struct sock *sk, struct msghdr *msg,
 		struct sk_buff *skb) {
@@ -105,5 +107,6 @@ static const struct sock_proto_ops udp_sock_ops_struct = {
 	.sendmsg   = udp_sendmsg,
 	.recvmsg   = sock_dgram_recvmsg,
 	.fillmsg   = udp_fillmsg,
-	.sock_list = &udp_sock_list
+	.sock_list = &udp_sock_list,
+	.sock_table = &udp_sock_table
 };
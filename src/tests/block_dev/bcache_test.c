@@ -0,0 +1,61 @@
+/**
+ * @file
+ * @brief Buffer cache test
+ *
+ * @date 17.10.2026
+ */
+
+#include <string.h>
+
+#include <drivers/block_dev.h>
+#include <drivers/block_dev/ramdisk/ramdisk.h>
+#include <embox/test.h>
+#include <fs/bcache.h>
+#include <mem/page.h>
+
+#include <util/err.h>
+
+EMBOX_TEST_SUITE("fs/buffer cache test");
+
+#define FS_DEV    "/dev/ramdisk_bc"
+#define FS_BLOCKS 4
+
+TEST_SETUP_SUITE(setup_suite);
+TEST_TEARDOWN_SUITE(teardown_suite);
+
+static struct ramdisk *ramdisk;
+static char buf[512];
+
+TEST_CASE("Second read of a block is a cache hit") {
+	struct bcache_stat before, after;
+
+	bcache_get_stat(&before);
+	test_assert_equal(sizeof(buf), block_dev_read(ramdisk->bdev, buf, sizeof(buf), 1));
+	test_assert_equal(sizeof(buf), block_dev_read(ramdisk->bdev, buf, sizeof(buf), 1));
+	bcache_get_stat(&after);
+
+	test_assert_equal(before.misses + 1, after.misses);
+	test_assert_equal(before.hits + 1, after.hits);
+}
+
+TEST_CASE("Written block reaches the device after sync") {
+	memset(buf, 0xA5, sizeof(buf));
+	test_assert_equal(sizeof(buf), block_dev_write(ramdisk->bdev, buf, sizeof(buf), 2));
+
+	memset(buf, 0, sizeof(buf));
+	test_assert_equal(sizeof(buf), block_dev_read(ramdisk->bdev, buf, sizeof(buf), 2));
+	test_assert_equal((char) 0xA5, buf[0]);
+
+	test_assert_zero(bcache_sync(ramdisk->bdev));
+	test_assert_zero(memcmp(ramdisk->p_start_addr + 2 * ramdisk->bdev->block_size, buf,
+			sizeof(buf)));
+}
+
+static int setup_suite(void) {
+	ramdisk = ramdisk_create(FS_DEV, FS_BLOCKS * PAGE_SIZE());
+	return err(ramdisk);
+}
+
+static int teardown_suite(void) {
+	return ramdisk_delete(FS_DEV);
+}
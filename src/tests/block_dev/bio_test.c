@@ -0,0 +1,78 @@
+/**
+ * @file
+ * @brief Block I/O requests test
+ *
+ * @date 17.10.2026
+ */
+
+#include <string.h>
+
+#include <drivers/block_dev.h>
+#include <drivers/block_dev/bio.h>
+#include <drivers/block_dev/ramdisk/ramdisk.h>
+#include <embox/test.h>
+#include <mem/page.h>
+
+#include <util/err.h>
+
+EMBOX_TEST_SUITE("block device asynchronous requests test");
+
+#define FS_DEV    "/dev/ramdisk_bio"
+#define FS_BLOCKS 4
+#define NBIO      3
+#define BUF_SIZE  4096
+
+TEST_SETUP_SUITE(setup_suite);
+TEST_TEARDOWN_SUITE(teardown_suite);
+
+static struct ramdisk *ramdisk;
+static char buf[NBIO][BUF_SIZE];
+static int completed;
+
+static void test_end_io(struct bio *bio, int err) {
+	if (err == 0) {
+		completed++;
+	}
+}
+
+TEST_CASE("Plugged adjacent bios are merged and completed") {
+	struct bio_vec vec[NBIO];
+	struct bio bio[NBIO];
+	struct bio_plug plug;
+	size_t blksize;
+	int i;
+
+	blksize = ramdisk->bdev->block_size;
+	test_assert(blksize <= BUF_SIZE);
+	completed = 0;
+
+	bio_plug_init(&plug);
+	/* Submit in reverse order to merge at both ends */
+	for (i = NBIO - 1; i >= 0; i--) {
+		memset(buf[i], 'a' + i, blksize);
+		vec[i] = (struct bio_vec) { .buf = buf[i], .len = blksize };
+		bio_init(&bio[i], ramdisk->bdev, BIO_WRITE, i, &vec[i], 1,
+				test_end_io, NULL);
+		bio_submit(&bio[i], &plug);
+	}
+	test_assert_zero(completed);
+	test_assert_equal(&bio[1], bio[0].next);
+	test_assert_equal(&bio[2], bio[1].next);
+
+	bio_unplug(&plug);
+	test_assert_equal(NBIO, completed);
+
+	memset(buf[0], 0, blksize);
+	test_assert_zero(block_dev_io(ramdisk->bdev, BIO_READ, buf[0], blksize, 2));
+	test_assert_equal('c', buf[0][0]);
+	test_assert_equal('c', buf[0][blksize - 1]);
+}
+
+static int setup_suite(void) {
+	ramdisk = ramdisk_create(FS_DEV, FS_BLOCKS * PAGE_SIZE());
+	return err(ramdisk);
+}
+
+static int teardown_suite(void) {
+	return ramdisk_delete(FS_DEV);
+}
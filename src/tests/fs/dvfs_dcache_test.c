@@ -0,0 +1,92 @@
+/**
+ * @file
+ * @brief DVFS dentry cache test
+ *
+ * @details Fake file system has a single file, which shows up only
+ * when the test allows it, so the same directory changes contents
+ * between mounts.
+ *
+ * @date 17.10.2026
+ */
+
+#include <string.h>
+#include <sys/stat.h>
+
+#include <embox/test.h>
+#include <fs/dvfs.h>
+#include <util/array.h>
+
+EMBOX_TEST_SUITE("dvfs dentry cache test");
+
+#define TEST_MNT_NAME  "dcache_test"
+#define TEST_MNT_PATH  "/" TEST_MNT_NAME
+#define TEST_FILE_NAME "file"
+#define TEST_FILE_PATH TEST_MNT_PATH "/" TEST_FILE_NAME
+
+static int test_file_present;
+
+static struct inode *test_fs_lookup(char const *name, struct dentry const *dir) {
+	struct inode *node;
+
+	if (!test_file_present || strcmp(name, TEST_FILE_NAME)) {
+		return NULL;
+	}
+
+	if (NULL == (node = dvfs_alloc_inode(dir->d_sb))) {
+		return NULL;
+	}
+	node->flags = S_IFREG;
+
+	return node;
+}
+
+static struct inode_operations test_fs_iops = {
+	.lookup = test_fs_lookup,
+};
+
+static int test_fs_fill_sb(struct super_block *sb, struct file *bdev_file) {
+	sb->sb_iops = &test_fs_iops;
+	sb->bdev = NULL;
+	return 0;
+}
+
+static struct dumb_fs_driver test_fs_driver = {
+	.name    = "dcache_test",
+	.fill_sb = test_fs_fill_sb,
+};
+
+ARRAY_SPREAD_DECLARE(struct dumb_fs_driver *, dumb_drv_tab);
+ARRAY_SPREAD_ADD(dumb_drv_tab, &test_fs_driver);
+
+static struct dentry *test_mount(int file_present) {
+	struct lookup lookup;
+
+	test_file_present = file_present;
+	test_assert_zero(dvfs_mount(NULL, TEST_MNT_PATH, "dcache_test", 0));
+
+	test_assert_zero(dvfs_lookup(TEST_MNT_PATH, &lookup));
+	test_assert_not_null(lookup.item);
+
+	return lookup.item;
+}
+
+TEST_CASE("File missing on previous mount is found on virtual directory") {
+	struct lookup lookup;
+	struct dentry *mpoint;
+
+	dvfs_lookup(TEST_MNT_PATH, &lookup);
+	if (lookup.item == NULL) {
+		test_assert_zero(dvfs_create_new(TEST_MNT_NAME, &lookup,
+					DVFS_DIR_VIRTUAL | S_IFDIR));
+	}
+
+	mpoint = test_mount(0);
+	dvfs_lookup(TEST_FILE_PATH, &lookup);
+	test_assert_null(lookup.item);
+	test_assert_zero(dvfs_umount(mpoint));
+
+	mpoint = test_mount(1);
+	dvfs_lookup(TEST_FILE_PATH, &lookup);
+	test_assert_not_null(lookup.item);
+	test_assert_zero(dvfs_umount(mpoint));
+}
@@ -0,0 +1,108 @@
+/**
+ * @file
+ * @brief Measures context switch latency against the depth of the runq.
+ *
+ * @details Two threads ping-pong with thread_yield() while a number of
+ * lower priority threads stay ready in the runq. Filler threads are spread
+ * over different priority levels, so strategies which walk levels or
+ * entries on extraction show growing latency.
+ *
+ * @date 17.10.2026
+ */
+
+#include <stdio.h>
+
+#include <embox/test.h>
+#include <framework/mod/options.h>
+
+#include <kernel/thread.h>
+#include <kernel/sched.h>
+#include <kernel/sched/sched_lock.h>
+#include <kernel/time/ktime.h>
+#include <util/err.h>
+
+#define ITERATIONS OPTION_GET(NUMBER, iterations)
+#define MAX_DEPTH  OPTION_GET(NUMBER, max_depth)
+
+EMBOX_TEST_SUITE("Scheduler switch latency against runq depth");
+
+static struct thread *fillers[MAX_DEPTH];
+static time64_t ping_ns;
+
+static void *filler_run(void *arg) {
+	return NULL;
+}
+
+static void *ping_run(void *arg) {
+	time64_t start;
+	int i;
+
+	start = ktime_get_ns();
+	for (i = 0; i < ITERATIONS; i++) {
+		thread_yield();
+	}
+
+	if (arg) {
+		ping_ns = ktime_get_ns() - start;
+	}
+
+	return NULL;
+}
+
+static struct thread *bench_thread(void *(*run)(void *), void *arg,
+		int prio) {
+	struct thread *t;
+
+	t = thread_create(THREAD_FLAG_SUSPENDED, run, arg);
+	test_assert_zero(err(t));
+	test_assert_zero(schedee_priority_set(&t->schedee, prio));
+
+	return t;
+}
+
+static time64_t bench_depth(int depth) {
+	const int prio = schedee_priority_get(&thread_self()->schedee);
+	struct thread *ping, *pong;
+	int i;
+
+	test_assert(prio > SCHED_PRIORITY_MIN && prio < SCHED_PRIORITY_MAX);
+
+	for (i = 0; i < depth; i++) {
+		fillers[i] = bench_thread(filler_run, NULL,
+				prio - 1 - i % (prio - SCHED_PRIORITY_MIN));
+	}
+	ping = bench_thread(ping_run, (void *) 1, prio + 1);
+	pong = bench_thread(ping_run, NULL, prio + 1);
+
+	sched_lock();
+	{
+		for (i = 0; i < depth; i++) {
+			test_assert_zero(thread_launch(fillers[i]));
+		}
+		test_assert_zero(thread_launch(ping));
+		test_assert_zero(thread_launch(pong));
+	}
+	sched_unlock();
+
+	test_assert_zero(thread_join(ping, NULL));
+	test_assert_zero(thread_join(pong, NULL));
+
+	for (i = 0; i < depth; i++) {
+		test_assert_zero(thread_join(fillers[i], NULL));
+	}
+
+	/* Each iteration of each thread is a switch to the other one. */
+	return ping_ns / (2 * ITERATIONS);
+}
+
+TEST_CASE("Switch latency with different number of ready threads") {
+	int depth;
+
+	printf("\n%8s %12s\n", "depth", "switch, ns");
+
+	depth = 0;
+	while (depth <= MAX_DEPTH) {
+		printf("%8d %12lld\n", depth, (long long) bench_depth(depth));
+		depth = depth ? depth * 2 : 1;
+	}
+}
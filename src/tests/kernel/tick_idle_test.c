@@ -0,0 +1,89 @@
+/**
+ * @file
+ * @brief Tickless idle test
+ *
+ * @details The event device of jiffies is replaced by a fake one, which
+ * reports how much time passed in idle.
+ *
+ * @date 17.10.2026
+ */
+
+#include <embox/test.h>
+#include <hal/ipl.h>
+#include <kernel/time/clock_source.h>
+#include <kernel/time/tick_idle.h>
+#include <kernel/time/timer.h>
+
+EMBOX_TEST_SUITE("tickless idle");
+
+#define TEST_TIMER_TICKS 100
+
+extern struct clock_source *cs_jiffies;
+
+static int fake_oneshots;
+static int fake_elapsed;
+static unsigned int fake_frac;
+
+static int fake_config(struct time_dev_conf *conf) {
+	if (conf->period_type == HW_TIMER_ONESHOOT) {
+		fake_oneshots++;
+	}
+	return 0;
+}
+
+static int fake_oneshot_elapsed(unsigned int *frac) {
+	*frac = fake_frac;
+	return fake_elapsed;
+}
+
+static struct time_event_device fake_event_device = {
+	.config = fake_config,
+	.oneshot_elapsed = fake_oneshot_elapsed,
+};
+
+static void test_timer_handler(sys_timer_t *timer, void *param) {
+}
+
+/* Returns number of jiffies accounted by a wake up from idle */
+static clock_t idle_pass(int elapsed, unsigned int frac) {
+	clock_t jiffies;
+
+	fake_elapsed = elapsed;
+	fake_frac = frac;
+
+	jiffies = cs_jiffies->jiffies;
+	tick_idle_enter();
+	tick_idle_exit();
+
+	return cs_jiffies->jiffies - jiffies;
+}
+
+TEST_CASE("Parts of periods passed in idle are accounted in jiffies") {
+	struct time_event_device *saved;
+	struct sys_timer timer;
+	clock_t passed;
+	ipl_t ipl;
+
+	/* Far deadline lets idle stop the tick */
+	test_assert_zero(timer_init_start(&timer, TIMER_ONESHOT, TEST_TIMER_TICKS,
+			test_timer_handler, NULL));
+
+	ipl = ipl_save();
+	{
+		saved = cs_jiffies->event_device;
+		cs_jiffies->event_device = &fake_event_device;
+		fake_oneshots = 0;
+
+		/* Two halves make one more tick whatever was left by earlier idle */
+		passed = idle_pass(3, TIME_EVENT_FRAC_ONE / 2);
+		passed += idle_pass(3, TIME_EVENT_FRAC_ONE / 2);
+
+		cs_jiffies->event_device = saved;
+	}
+	ipl_restore(ipl);
+
+	timer_close(&timer);
+
+	test_assert_equal(fake_oneshots, 2);
+	test_assert_equal(passed, 7);
+}
@@ -0,0 +1,73 @@
+/**
+ * @file
+ * @brief Measures cost of timer strategy operations with many armed timers.
+ *
+ * @details Arms a lot of timers spread over a wide range of expiration
+ * times, then drives timer_strat_sched() by hand with the scheduler locked
+ * so the clock handler doesn't interfere. Note that this advances all other
+ * system timers by the number of ticks measured as well.
+ *
+ * @date 17.10.2026
+ */
+
+#include <stdio.h>
+
+#include <embox/test.h>
+#include <framework/mod/options.h>
+
+#include <kernel/sched/sched_lock.h>
+#include <kernel/time/ktime.h>
+#include <kernel/time/timer.h>
+#include <util/macro.h>
+
+#define TIMERS_QUANTITY OPTION_GET(NUMBER, timers_quantity)
+#define TICKS           OPTION_GET(NUMBER, ticks)
+
+EMBOX_TEST_SUITE("Timer strategy per-tick cost");
+
+static struct sys_timer timers[TIMERS_QUANTITY];
+static int fired;
+
+static void bench_handler(struct sys_timer *tmr, void *param) {
+	fired++;
+}
+
+TEST_CASE("Start, tick and stop with " MACRO_STRING(TIMERS_QUANTITY)
+		" timers armed") {
+	time64_t start, t_start, t_tick, t_stop;
+	int i;
+
+	fired = 0;
+
+	sched_lock();
+	{
+		start = ktime_get_ns();
+		for (i = 0; i < TIMERS_QUANTITY; i++) {
+			/* Spread over 1..~64k ticks, some expiring while measuring. */
+			timer_init_start(&timers[i], TIMER_ONESHOT,
+					1 + (i * 7919) % 0xffff, bench_handler, NULL);
+		}
+		t_start = ktime_get_ns() - start;
+
+		start = ktime_get_ns();
+		for (i = 0; i < TICKS; i++) {
+			timer_strat_sched();
+		}
+		t_tick = ktime_get_ns() - start;
+
+		start = ktime_get_ns();
+		for (i = 0; i < TIMERS_QUANTITY; i++) {
+			timer_close(&timers[i]);
+		}
+		t_stop = ktime_get_ns() - start;
+	}
+	sched_unlock();
+
+	printf("\n%d timers: start %lld ns, tick %lld ns, stop %lld ns "
+			"(%d fired)\n", TIMERS_QUANTITY,
+			(long long) (t_start / TIMERS_QUANTITY),
+			(long long) (t_tick / TICKS),
+			(long long) (t_stop / TIMERS_QUANTITY), fired);
+
+	test_assert(fired > 0);
+}
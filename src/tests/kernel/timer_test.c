@@ -8,7 +8,9 @@
 #include <unistd.h>
 #include <embox/test.h>
 #include <kernel/time/timer.h>
+#include <kernel/time/timer_strat.h>
 #include <kernel/time/time.h>
+#include <kernel/sched/sched_lock.h>
 #include <kernel/thread/sync/mutex.h>
 #include <kernel/sched/sync/mutex.h>
 
@@ -116,6 +118,117 @@ TEST_CASE("Timer could be started many times") {
 	timer_close(&tmr);
 }
 
+/* More than the 256 ticks of the root level of the timer wheel */
+#define TEST_FAR_TICKS 600
+
+TEST_CASE("Next event is never reported later than a far timer expires") {
+	struct sys_timer tmr;
+	volatile int fired = 0;
+	clock_t next;
+	int i;
+
+	/* Ticks are driven by hand, so the clock handler doesn't interfere. */
+	sched_lock();
+	{
+		test_assert_zero(timer_init_start(&tmr, TIMER_ONESHOT, TEST_FAR_TICKS,
+				test_timer_handler, (void *) &fired));
+
+		/* Expires on the call number TEST_FAR_TICKS + 1 */
+		for (i = 0; i <= TEST_FAR_TICKS && !fired; i++) {
+			next = timer_strat_get_next_event();
+			test_assert(next <= TEST_FAR_TICKS + 1 - i);
+
+			timer_strat_sched();
+		}
+
+		timer_close(&tmr);
+	}
+	sched_unlock();
+
+	test_assert(fired);
+}
+
+#define TEST_RACE_TICKS 10
+
+/* Two timers expiring at the same tick, each handler touches the other one */
+struct test_race {
+	struct sys_timer tmr[2];
+	struct sys_timer ref;
+	int fired[2];
+	int fired_at[2];
+	int ref_at;
+	int ticks;
+};
+
+static void test_race_stop(sys_timer_t *tmr, void *param) {
+	struct test_race *race = param;
+	int i = (tmr == &race->tmr[1]);
+
+	race->fired[i]++;
+	timer_close(&race->tmr[!i]);
+}
+
+static void test_race_ref(sys_timer_t *tmr, void *param) {
+	struct test_race *race = param;
+
+	race->ref_at = race->ticks;
+}
+
+static void test_race_restart(sys_timer_t *tmr, void *param) {
+	struct test_race *race = param;
+	int i = (tmr == &race->tmr[1]);
+
+	race->fired[i]++;
+	race->fired_at[i] = race->ticks;
+
+	if (race->fired[i] == 1 && !race->fired[!i]) {
+		/* Both must fire together with a just started timer */
+		timer_start(&race->tmr[!i], TEST_RACE_TICKS);
+		timer_start(tmr, TEST_RACE_TICKS);
+		timer_init_start(&race->ref, TIMER_ONESHOT, TEST_RACE_TICKS,
+				test_race_ref, race);
+	}
+}
+
+static void test_race_run(struct test_race *race, sys_timer_handler_t handler) {
+	/* Ticks are driven by hand, so the clock handler doesn't interfere. */
+	sched_lock();
+	{
+		test_assert_zero(timer_init_start(&race->tmr[0], TIMER_ONESHOT,
+				TEST_RACE_TICKS, handler, race));
+		test_assert_zero(timer_init_start(&race->tmr[1], TIMER_ONESHOT,
+				TEST_RACE_TICKS, handler, race));
+
+		for (race->ticks = 0; race->ticks < 4 * TEST_RACE_TICKS; race->ticks++) {
+			timer_strat_sched();
+		}
+
+		timer_close(&race->tmr[0]);
+		timer_close(&race->tmr[1]);
+		timer_close(&race->ref);
+	}
+	sched_unlock();
+}
+
+TEST_CASE("Timer handler may stop a timer expiring at the same tick") {
+	struct test_race race = { };
+
+	test_race_run(&race, test_race_stop);
+
+	test_assert_equal(race.fired[0] + race.fired[1], 1);
+}
+
+TEST_CASE("Timer handler may restart itself and a timer expiring at the same"
+		" tick") {
+	struct test_race race = { };
+
+	test_race_run(&race, test_race_restart);
+
+	test_assert_equal(race.fired[0] + race.fired[1], 3);
+	test_assert_equal(race.fired_at[0], race.ref_at);
+	test_assert_equal(race.fired_at[1], race.ref_at);
+}
+
 struct timer_mutex {
 	int counter;
 	struct mutex mutex;
@@ -7,9 +7,13 @@
  * @author Anton Bondarev
  */
 #include <embox/test.h>
+#include <stdint.h>
 #include <stdlib.h>
+#include <string.h>
 #include <mem/page.h>
 #include <mem/heap.h>
+#include <kernel/thread.h>
+#include <util/err.h>
 
 #define HEAP_SIZE OPTION_MODULE_GET(embox__mem__heap_api,NUMBER,heap_size)
 
@@ -140,6 +144,58 @@ TEST_CASE("Allocates many objects with different size") {
 	free(arr);
 }
 
+#define XTHREAD_COUNT 64
+
+static void *xthread_alloc(void *arg) {
+	void **arr = arg;
+	int i;
+
+	for (i = 0; i < XTHREAD_COUNT; i++) {
+		arr[i] = malloc(8 + i * 4);
+		if (arr[i] == NULL) {
+			break;
+		}
+		memset(arr[i], i, 8 + i * 4);
+	}
+
+	/* Returns some of blocks itself to leave them in its cache (if any) */
+	while (i > XTHREAD_COUNT / 2) {
+		free(arr[--i]);
+	}
+
+	return (void *) (uintptr_t) i;
+}
+
+TEST_CASE("Frees blocks allocated by another thread") {
+	void *arr[XTHREAD_COUNT];
+	struct thread *t;
+	void *ret;
+	int i, j, cnt;
+
+	t = thread_create(0, xthread_alloc, arr);
+	test_assert_zero(err(t));
+	test_assert_zero(thread_join(t, &ret));
+
+	cnt = (uintptr_t) ret;
+	test_assert_not_zero(cnt);
+
+	for (i = 0; i < cnt; i++) {
+		for (j = 0; j < 8 + i * 4; j++) {
+			test_assert_equal(((unsigned char *) arr[i])[j], i);
+		}
+		free(arr[i]);
+	}
+
+	/* Blocks of these sizes are still available */
+	for (i = 0; i < cnt; i++) {
+		arr[i] = malloc(8 + i * 4);
+		test_assert_not_null(arr[i]);
+	}
+	while (--i >= 0) {
+		free(arr[i]);
+	}
+}
+
 TEST_CASE("malloc fails when trying to allocate a very large"
 		" chunk of memory") {
 	test_assert_null(malloc(4294966160));
@@ -0,0 +1,210 @@
+/**
+ * @file
+ * @brief Compares boundary markers and TLSF segment allocators.
+ *
+ * @details Replays the same pseudo-random allocation trace against both
+ * allocators, checks that live blocks don't overlap, measures average and
+ * worst-case latency of malloc and free and fragmentation of the heap at
+ * the end of the trace. Fragmentation is the part of free memory which
+ * can't be allocated by one request.
+ *
+ * @date 17.10.2026
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <embox/test.h>
+#include <framework/mod/options.h>
+
+#include <kernel/time/ktime.h>
+#include <mem/heap_bm.h>
+#include <mem/heap_tlsf.h>
+#include <util/array.h>
+
+#define HEAP_SIZE  OPTION_GET(NUMBER, heap_size)
+#define TRACE_LEN  OPTION_GET(NUMBER, trace_len)
+
+EMBOX_TEST_SUITE("Segment allocators fragmentation and latency");
+
+struct heap_algo {
+	const char *name;
+	void (*init)(void *segment, size_t size);
+	void *(*memalign)(void *segment, size_t boundary, size_t size);
+	void (*free)(void *segment, void *ptr);
+};
+
+struct heap_result {
+	unsigned long allocs, frees, fails;
+	time64_t alloc_total, alloc_max;
+	time64_t free_total, free_max;
+	size_t free_bytes;
+	size_t largest;
+};
+
+static const struct heap_algo heap_algos[] = {
+	{ "bm",   bm_init,   bm_memalign,   bm_free },
+	{ "tlsf", tlsf_init, tlsf_memalign, tlsf_free },
+};
+
+static char heap_buf[HEAP_SIZE] __attribute__((aligned(8)));
+
+static struct {
+	char *ptr;
+	size_t size;
+} slots[128];
+
+static uint32_t seed;
+
+static uint32_t bench_rand(void) {
+	seed = seed * 1103515245 + 12345;
+	return seed >> 8;
+}
+
+/* Mostly small objects with a tail of large buffers */
+static size_t bench_size(void) {
+	uint32_t r = bench_rand();
+
+	switch (r % 16) {
+	case 0:
+		return 512 + r % (HEAP_SIZE / 16);
+	case 1: case 2: case 3:
+		return 64 + r % 448;
+	default:
+		return 1 + r % 64;
+	}
+}
+
+static int slot_check(int i) {
+	size_t j;
+
+	for (j = 0; j < slots[i].size; j++) {
+		if (slots[i].ptr[j] != (char) i) {
+			return 0;
+		}
+	}
+	return 1;
+}
+
+static void slot_free(const struct heap_algo *algo, int i,
+		struct heap_result *res) {
+	time64_t start, t;
+
+	test_assert(slot_check(i));
+
+	start = ktime_get_ns();
+	algo->free(heap_buf, slots[i].ptr);
+	t = ktime_get_ns() - start;
+
+	res->frees++;
+	res->free_total += t;
+	if (t > res->free_max) {
+		res->free_max = t;
+	}
+
+	slots[i].ptr = NULL;
+}
+
+static size_t heap_largest(const struct heap_algo *algo) {
+	size_t lo = 0, hi = HEAP_SIZE, mid;
+	void *p;
+
+	while (lo < hi) {
+		mid = (lo + hi + 1) / 2;
+		p = algo->memalign(heap_buf, 8, mid);
+		if (p) {
+			algo->free(heap_buf, p);
+			lo = mid;
+		} else {
+			hi = mid - 1;
+		}
+	}
+
+	return lo;
+}
+
+static void heap_replay(const struct heap_algo *algo, struct heap_result *res) {
+	time64_t start, t;
+	size_t size, live;
+	int n, i;
+
+	memset(res, 0, sizeof(*res));
+	memset(slots, 0, sizeof(slots));
+	algo->init(heap_buf, sizeof(heap_buf));
+	seed = 1;
+
+	for (n = 0; n < TRACE_LEN; n++) {
+		i = bench_rand() % ARRAY_SIZE(slots);
+
+		if (slots[i].ptr) {
+			slot_free(algo, i, res);
+			continue;
+		}
+
+		size = bench_size();
+
+		start = ktime_get_ns();
+		slots[i].ptr = algo->memalign(heap_buf, 8, size);
+		t = ktime_get_ns() - start;
+
+		res->allocs++;
+		res->alloc_total += t;
+		if (t > res->alloc_max) {
+			res->alloc_max = t;
+		}
+
+		if (!slots[i].ptr) {
+			res->fails++;
+			continue;
+		}
+
+		test_assert_zero((uintptr_t) slots[i].ptr % 8);
+		test_assert(slots[i].ptr >= heap_buf
+				&& slots[i].ptr + size <= heap_buf + sizeof(heap_buf));
+
+		slots[i].size = size;
+		memset(slots[i].ptr, i, size);
+	}
+
+	live = 0;
+	for (i = 0; i < ARRAY_SIZE(slots); i++) {
+		if (slots[i].ptr) {
+			live += slots[i].size;
+		}
+	}
+	res->free_bytes = sizeof(heap_buf) - live;
+	res->largest = heap_largest(algo);
+
+	for (i = 0; i < ARRAY_SIZE(slots); i++) {
+		if (slots[i].ptr) {
+			slot_free(algo, i, res);
+		}
+	}
+}
+
+TEST_CASE("Replay allocation trace against bm and tlsf") {
+	struct heap_result res;
+	unsigned frag;
+	int i;
+
+	printf("\n%d bytes heap, %d operations\n", HEAP_SIZE, TRACE_LEN);
+
+	for (i = 0; i < ARRAY_SIZE(heap_algos); i++) {
+		heap_replay(&heap_algos[i], &res);
+		test_assert_not_zero(res.allocs);
+		test_assert_not_zero(res.frees);
+
+		frag = res.largest < res.free_bytes
+			? 100 - res.largest * 100 / res.free_bytes : 0;
+
+		printf("%-4s: malloc avg %llu max %llu ns, free avg %llu max %llu ns, "
+				"%lu failed, fragmentation %u%%\n",
+				heap_algos[i].name,
+				(unsigned long long) (res.alloc_total / res.allocs),
+				(unsigned long long) res.alloc_max,
+				(unsigned long long) (res.free_total / res.frees),
+				(unsigned long long) res.free_max,
+				res.fails, frag);
+	}
+}
@@ -7,12 +7,18 @@
  * @author Anton Bondarev
  */
 #include <embox/test.h>
+#include <util/bit.h>
 #include <mem/page.h>
 #include <mem/heap.h>
 #include <mem/phymem.h>
 
 EMBOX_TEST_SUITE("page allocation test");
 
+#define TEST_PAGE_SIZE 256
+
+static char test_pages[TEST_PAGE_SIZE * 64];
+static void *test_chunks[32];
+
 TEST_CASE("single page allocation") {
 	void *page;
 
@@ -54,3 +60,33 @@ TEST_CASE("Try allocate too lot of pages") {
 	/* FIXME */
 	test_assert_null(phymem_alloc(__phymem_allocator->pages_n + 1));
 }
+
+TEST_CASE("Freed pages are coalesced back into a large block") {
+	struct page_allocator *pa;
+	size_t free;
+	void *page;
+	int i, n;
+
+	pa = page_allocator_init(test_pages, sizeof(test_pages), TEST_PAGE_SIZE);
+	test_assert_not_null(pa);
+	free = pa->free;
+
+	for (n = 0; n < 32; n++) {
+		test_chunks[n] = page_alloc(pa, 2);
+		if (!test_chunks[n]) {
+			break;
+		}
+	}
+	test_assert_not_zero(n);
+
+	for (i = 0; i < n; i++) {
+		page_free(pa, test_chunks[i], 2);
+	}
+	test_assert_equal(pa->free, free);
+
+	n = 1 << (bit_fls(pa->pages_n) - 1);
+	page = page_alloc(pa, n);
+	test_assert_not_null(page);
+	page_free(pa, page, n);
+	test_assert_equal(pa->free, free);
+}
@@ -7,7 +7,10 @@
  * @author Alexander Kalmuk
  */
 
+#include <string.h>
+
 #include <embox/test.h>
+#include <mem/kmalloc.h>
 #include <mem/misc/slab.h>
 #include <util/dlist.h>
 #include <mem/page.h>
@@ -148,6 +151,64 @@ TEST_CASE("Cache's growing.") {
 	cache_destroy(cache);
 #endif
 }
+
+static struct cache_stats *test_stats_find(struct cache_stats *stats,
+		int n, const char *name) {
+	int i;
+
+	for (i = 0; i < n; i++) {
+		if (!strcmp(stats[i].name, name)) {
+			return &stats[i];
+		}
+	}
+	return NULL;
+}
+
+TEST_CASE("Freed object is allocated again on the same CPU") {
+	static struct cache_stats stats[32];
+	struct cache_stats *st;
+	cache_t *cache;
+	void *obj, *obj2;
+	int n;
+
+	cache = cache_create("test_mag", 64, 0);
+	test_assert_not_null(cache);
+
+	obj = cache_alloc(cache);
+	test_assert_not_null(obj);
+	cache_free(cache, obj);
+	obj2 = cache_alloc(cache);
+	test_assert_equal(obj, obj2);
+
+	n = cache_stats_get(stats, 32);
+	test_assert(n <= 32);
+	st = test_stats_find(stats, n, "test_mag");
+	test_assert_not_null(st);
+	test_assert_equal(st->objs_active, 1);
+	test_assert_equal(st->allocs, 2);
+	test_assert_equal(st->frees, 1);
+
+	cache_free(cache, obj2);
+	cache_destroy(cache);
+}
+
+TEST_CASE("kmalloc rounds size up to power of two cache") {
+	cache_t *cache;
+	void *ptr;
+
+	test_assert_null(kmalloc(0));
+
+	ptr = kmalloc(100);
+	test_assert_not_null(ptr);
+	cache = cache_of(ptr);
+	test_assert_not_null(cache);
+	test_assert_equal(cache->obj_size, 128);
+	memset(ptr, 0xa5, 100);
+	kfree(ptr);
+
+	kfree(NULL);
+}
+
 #if 0
 static size_t list_length(struct dlist_head *head) {
 	struct dlist_head *pos;
@@ -17,6 +17,9 @@
 
 #include <net/inetdevice.h>
 #include <net/netdevice.h>
+#include <net/skbuff.h>
+#include <net/l2/ethernet.h>
+#include <net/l3/arp.h>
 #include <net/l3/route.h>
 
 EMBOX_TEST_SUITE("inet dgram socket test");
@@ -33,6 +36,9 @@ TEST_TEARDOWN(case_teardown);
 #define OTHER_PORT 2
 #define BAD_PORT   3
 
+#define OWN_ADDR 0x0A000301 /* 10.0.3.1 on the test interface */
+#define OWN_MASK 0xFFFFFF00
+
 static int b, c;
 static struct sockaddr_in addr;
 static socklen_t addrlen;
@@ -42,6 +48,26 @@ static inline struct sockaddr * to_sa(struct sockaddr_in *sa_in) {
 	return (struct sockaddr *)sa_in;
 }
 
+static int own_xmit(struct net_device *dev, struct sk_buff *skb) {
+	skb_free(skb);
+	return 0;
+}
+
+static const struct net_driver own_ops = {
+	.xmit = own_xmit
+};
+
+static int own_setup(struct net_device *dev) {
+	dev->mtu      = 1500;
+	dev->hdr_len  = ETH_HEADER_SIZE;
+	dev->addr_len = ETH_ALEN;
+	dev->type     = ARP_HRD_ETHERNET;
+	dev->flags    = IFF_RUNNING;
+	dev->drv_ops  = &own_ops;
+	dev->ops      = &ethernet_ops;
+	return 0;
+}
+
 TEST_CASE("connect() works fine on right arguments") {
 	test_assert_zero(connect(c, to_sa(&addr), addrlen));
 }
@@ -191,6 +217,38 @@ TEST_CASE("getpeername() returns address of peer") {
 	test_assert_mem_equal(&addr, &tmp, addrlen);
 }
 
+TEST_CASE("connected socket sends to own interface address from"
+		" that address") {
+	struct net_device *dev;
+	struct sockaddr_in tmp;
+
+	dev = netdev_alloc("dgram0", &own_setup, 0);
+	test_assert_not_null(dev);
+	test_assert_zero(inetdev_register_dev(dev));
+	test_assert_zero(inetdev_set_addr(inetdev_get_by_dev(dev),
+				htonl(OWN_ADDR)));
+	test_assert_zero(netdev_flag_up(dev, IFF_UP));
+	test_assert_zero(rt_add_route(dev, htonl(OWN_ADDR & OWN_MASK),
+				htonl(OWN_MASK), 0, RTF_UP));
+
+	/* the packet goes out through loopback, not through dgram0 */
+	addr.sin_addr.s_addr = htonl(OWN_ADDR);
+	test_assert_zero(connect(c, to_sa(&addr), addrlen));
+	test_assert_equal(1, send(c, "a", 1, 0));
+	test_assert_equal(1, send(c, "b", 1, 0));
+
+	test_assert_equal(1, recvfrom(b, buf, 2, 0, to_sa(&tmp), &addrlen));
+	test_assert_equal(htonl(OWN_ADDR), tmp.sin_addr.s_addr);
+	test_assert_equal(1, recvfrom(b, buf, 2, 0, to_sa(&tmp), &addrlen));
+	test_assert_equal(htonl(OWN_ADDR), tmp.sin_addr.s_addr);
+
+	test_assert_zero(rt_del_route(dev, htonl(OWN_ADDR & OWN_MASK),
+				htonl(OWN_MASK), 0));
+	test_assert_zero(netdev_flag_down(dev, IFF_UP));
+	test_assert_zero(inetdev_unregister_dev(dev));
+	netdev_free(dev);
+}
+
 static int suite_setup(void) {
 	int ret;
 	struct in_device *in_dev;
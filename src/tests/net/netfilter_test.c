@@ -0,0 +1,201 @@
+/**
+ * @file
+ * @brief Tests for compiled netfilter chains
+ *
+ * @date 17.10.2026
+ */
+
+#include <arpa/inet.h>
+#include <string.h>
+#include <net/l3/ipv4/ip.h>
+#include <net/l3/ipv4/ip_fragment.h>
+#include <net/l4/udp.h>
+#include <net/netfilter.h>
+#include <embox/test.h>
+
+EMBOX_TEST_SUITE("netfilter rule classification");
+
+TEST_TEARDOWN(case_teardown);
+
+static void packet_init(struct nf_rule *p, const char *saddr,
+		const char *daddr, in_port_t dport) {
+	struct in_addr addr;
+
+	nf_rule_init(p);
+	p->target = NF_TARGET_ACCEPT;
+	inet_aton(saddr, &addr);
+	NF_SET_NOT_FIELD(p, saddr, 0, addr);
+	inet_aton(daddr, &addr);
+	NF_SET_NOT_FIELD(p, daddr, 0, addr);
+	NF_SET_NOT_FIELD(p, proto, 0, NF_PROTO_TCP);
+	NF_SET_NOT_FIELD(p, sport, 0, htons(1024));
+	NF_SET_NOT_FIELD(p, dport, 0, htons(dport));
+}
+
+static struct sk_buff *ip_packet(const char *saddr, const char *daddr,
+		uint16_t id, uint16_t frag_off, size_t data_len) {
+	struct sk_buff *skb;
+	struct in_addr addr;
+
+	skb = skb_alloc(ETH_HEADER_SIZE + IP_MIN_HEADER_SIZE + data_len);
+	if (skb == NULL) {
+		return NULL;
+	}
+
+	skb->nh.raw = skb->mac.raw + ETH_HEADER_SIZE;
+	skb->h.raw = skb->nh.raw + IP_MIN_HEADER_SIZE;
+	memset(skb->nh.raw, 0, IP_MIN_HEADER_SIZE + data_len);
+
+	ip_hdr(skb)->version = 4;
+	ip_hdr(skb)->ihl = IP_MIN_HEADER_SIZE >> 2;
+	ip_hdr(skb)->tot_len = htons(IP_MIN_HEADER_SIZE + data_len);
+	ip_hdr(skb)->id = htons(id);
+	ip_hdr(skb)->frag_off = htons(frag_off);
+	ip_hdr(skb)->ttl = 64;
+	ip_hdr(skb)->proto = IPPROTO_UDP;
+	inet_aton(saddr, &addr);
+	ip_hdr(skb)->saddr = addr.s_addr;
+	inet_aton(daddr, &addr);
+	ip_hdr(skb)->daddr = addr.s_addr;
+
+	return skb;
+}
+
+static unsigned int udp_track(const char *saddr, in_port_t sport,
+		const char *daddr, in_port_t dport) {
+	struct sk_buff *skb;
+	unsigned int state;
+
+	skb = ip_packet(saddr, daddr, 0, 0, UDP_HEADER_SIZE);
+	test_assert_not_null(skb);
+	udp_hdr(skb)->source = htons(sport);
+	udp_hdr(skb)->dest = htons(dport);
+
+	state = nf_conntrack_in(skb);
+	skb_free(skb);
+
+	return state;
+}
+
+static int accepted(const char *saddr, const char *daddr,
+		in_port_t dport) {
+	struct nf_rule p;
+
+	packet_init(&p, saddr, daddr, dport);
+	return 0 == nf_test_rule(NF_CHAIN_INPUT, &p);
+}
+
+TEST_CASE("the first matching rule wins across hashed and generic rules") {
+	struct nf_rule r;
+	struct in_addr addr;
+
+	/* accept 10.0.0.1, drop the rest of port 80, accept not 10.0.0.2 */
+	nf_rule_init(&r);
+	r.target = NF_TARGET_ACCEPT;
+	inet_aton("10.0.0.1", &addr);
+	NF_SET_NOT_FIELD(&r, saddr, 0, addr);
+	test_assert_zero(nf_add_rule(NF_CHAIN_INPUT, &r));
+
+	nf_rule_init(&r);
+	r.target = NF_TARGET_DROP;
+	NF_SET_NOT_FIELD(&r, proto, 0, NF_PROTO_TCP);
+	NF_SET_NOT_FIELD(&r, dport, 0, htons(80));
+	test_assert_zero(nf_add_rule(NF_CHAIN_INPUT, &r));
+
+	nf_rule_init(&r);
+	r.target = NF_TARGET_ACCEPT;
+	inet_aton("10.0.0.2", &addr);
+	NF_SET_NOT_FIELD(&r, daddr, 1, addr);
+	test_assert_zero(nf_add_rule(NF_CHAIN_INPUT, &r));
+
+	test_assert_zero(nf_set_chain_target(NF_CHAIN_INPUT, NF_TARGET_DROP));
+
+	test_assert_true(accepted("10.0.0.1", "10.0.0.2", 80));
+	test_assert_false(accepted("10.0.0.3", "10.0.0.2", 80));
+	test_assert_true(accepted("10.0.0.3", "10.0.0.4", 22));
+	test_assert_false(accepted("10.0.0.3", "10.0.0.2", 22));
+
+	test_assert_equal(nf_get_rule_by_num(NF_CHAIN_INPUT, 0)->pkts, 1);
+	test_assert_equal(nf_get_rule_by_num(NF_CHAIN_INPUT, 1)->pkts, 1);
+	test_assert_equal(nf_get_rule_by_num(NF_CHAIN_INPUT, 2)->pkts, 1);
+}
+
+TEST_CASE("deleted rule doesn't match anymore") {
+	struct nf_rule r;
+
+	nf_rule_init(&r);
+	r.target = NF_TARGET_DROP;
+	NF_SET_NOT_FIELD(&r, proto, 0, NF_PROTO_TCP);
+	NF_SET_NOT_FIELD(&r, dport, 0, htons(80));
+	test_assert_zero(nf_add_rule(NF_CHAIN_INPUT, &r));
+
+	test_assert_false(accepted("10.0.0.1", "10.0.0.2", 80));
+	test_assert_zero(nf_del_rule(NF_CHAIN_INPUT, 0));
+	test_assert_true(accepted("10.0.0.1", "10.0.0.2", 80));
+}
+
+TEST_CASE("connection state rule is checked first") {
+	struct nf_rule r, p;
+
+	nf_rule_init(&r);
+	r.target = NF_TARGET_ACCEPT;
+	NF_SET_NOT_FIELD(&r, ctstate, 0, NF_CT_ESTABLISHED | NF_CT_RELATED);
+	test_assert_zero(nf_add_rule(NF_CHAIN_INPUT, &r));
+	test_assert_zero(nf_set_chain_target(NF_CHAIN_INPUT, NF_TARGET_DROP));
+
+	packet_init(&p, "10.0.0.1", "10.0.0.2", 80);
+	NF_SET_NOT_FIELD(&p, ctstate, 0, NF_CT_NEW);
+	test_assert_not_zero(nf_test_rule(NF_CHAIN_INPUT, &p));
+
+	NF_SET_NOT_FIELD(&p, ctstate, 0, NF_CT_RELATED);
+	test_assert_zero(nf_test_rule(NF_CHAIN_INPUT, &p));
+	test_assert_equal(nf_get_rule_by_num(NF_CHAIN_INPUT, 0)->pkts, 1);
+}
+
+TEST_CASE("UDP flow becomes established by the reply") {
+	test_assert_equal(NF_CT_NEW, udp_track("10.0.1.1", 1024, "10.0.1.2", 53));
+	test_assert_equal(NF_CT_NEW, udp_track("10.0.1.1", 1024, "10.0.1.2", 53));
+	test_assert_equal(NF_CT_ESTABLISHED,
+			udp_track("10.0.1.2", 53, "10.0.1.1", 1024));
+	test_assert_equal(NF_CT_ESTABLISHED,
+			udp_track("10.0.1.1", 1024, "10.0.1.2", 53));
+	test_assert_equal(NF_CT_NEW, udp_track("10.0.1.1", 1025, "10.0.1.2", 53));
+}
+
+TEST_CASE("fragmented reply is tracked after reassembly") {
+	struct sk_buff *first, *last, *complete;
+	struct nf_rule r;
+
+	test_assert_equal(NF_CT_NEW, udp_track("10.0.2.1", 1024, "10.0.2.2", 53));
+
+	/* 16 bytes with UDP header in the first fragment, 8 bytes in the last */
+	first = ip_packet("10.0.2.2", "10.0.2.1", 77, IP_MF, 16);
+	test_assert_not_null(first);
+	udp_hdr(first)->source = htons(53);
+	udp_hdr(first)->dest = htons(1024);
+	udp_hdr(first)->len = htons(24);
+	last = ip_packet("10.0.2.2", "10.0.2.1", 77, 16 >> 3, 8);
+	test_assert_not_null(last);
+
+	/* fragment which isn't reassembled has no state and isn't invalid */
+	nf_rule_init(&r);
+	r.target = NF_TARGET_DROP;
+	NF_SET_NOT_FIELD(&r, ctstate, 0, NF_CT_INVALID);
+	test_assert_zero(nf_add_rule(NF_CHAIN_INPUT, &r));
+	test_assert_zero(nf_test_skb(NF_CHAIN_INPUT, NF_TARGET_ACCEPT, last));
+
+	test_assert_null(ip_defrag(first));
+	complete = ip_defrag(last);
+	test_assert_not_null(complete);
+	test_assert_equal(24 + IP_MIN_HEADER_SIZE, ntohs(ip_hdr(complete)->tot_len));
+
+	test_assert_equal(NF_CT_ESTABLISHED, nf_conntrack_in(complete));
+	test_assert_zero(nf_test_skb(NF_CHAIN_INPUT, NF_TARGET_ACCEPT, complete));
+	skb_free(complete);
+}
+
+static int case_teardown(void) {
+	nf_clear(NF_CHAIN_INPUT);
+	nf_set_chain_target(NF_CHAIN_INPUT, NF_TARGET_ACCEPT);
+	return 0;
+}
@@ -0,0 +1,109 @@
+/**
+ * @file
+ * @brief Measures IPv4 route lookup rate on a synthetic routing table.
+ *
+ * @details Fills the table with pseudo-random prefixes of various length,
+ * verifies the best match against an exhaustive search over the table and
+ * measures lookups per second. Number of routes is limited by
+ * route_table_size option of embox.net.route.
+ *
+ * @date 17.10.2026
+ */
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <arpa/inet.h>
+
+#include <embox/test.h>
+#include <framework/mod/options.h>
+
+#include <kernel/time/ktime.h>
+#include <net/inetdevice.h>
+#include <net/l3/route.h>
+#include <util/array.h>
+
+#define ROUTES_QUANTITY OPTION_GET(NUMBER, routes_quantity)
+#define LOOKUPS         OPTION_GET(NUMBER, lookups)
+
+EMBOX_TEST_SUITE("IPv4 route lookup rate");
+
+/* Test routes use 10.0.0.0/8 to keep away from the real ones */
+#define BENCH_NET  0x0a000000
+#define BENCH_MASK 0xff000000
+
+static uint32_t seed = 1;
+
+static uint32_t bench_rand(void) {
+	seed = seed * 1103515245 + 12345;
+	return seed;
+}
+
+static uint32_t bench_addr(void) {
+	return BENCH_NET | (bench_rand() & ~BENCH_MASK);
+}
+
+static struct rt_entry * bench_best_exhaustive(in_addr_t dst) {
+	struct rt_entry *rte, *best;
+
+	best = NULL;
+	for (rte = rt_fib_get_first(); rte != NULL; rte = rt_fib_get_next(rte)) {
+		if (((dst & rte->rt_mask) == rte->rt_dst)
+				&& ((best == NULL)
+					|| (ntohl(rte->rt_mask) > ntohl(best->rt_mask)))) {
+			best = rte;
+		}
+	}
+
+	return best;
+}
+
+TEST_CASE("Lookups per second with a synthetic routing table") {
+	struct net_device *dev;
+	struct rt_entry *rte;
+	in_addr_t dst[64];
+	in_addr_t mask;
+	time64_t start, t;
+	int i, len, added;
+
+	dev = inetdev_get_loopback_dev()->dev;
+
+	for (added = 0; added < ROUTES_QUANTITY; added++) {
+		len = 9 + bench_rand() % 24;
+		mask = htonl(~0U << (32 - len));
+		if (-ENOMEM == rt_add_route(dev, htonl(bench_addr()) & mask, mask,
+					INADDR_ANY, 0)) {
+			break;
+		}
+	}
+	test_assert(added > 0);
+
+	for (i = 0; i < ARRAY_SIZE(dst); i++) {
+		dst[i] = htonl(bench_addr());
+		test_assert_equal(bench_best_exhaustive(dst[i]),
+				rt_fib_get_best(dst[i], NULL));
+	}
+
+	start = ktime_get_ns();
+	for (i = 0; i < LOOKUPS; i++) {
+		rte = rt_fib_get_best(dst[i % ARRAY_SIZE(dst)], NULL);
+	}
+	t = ktime_get_ns() - start;
+	(void) rte;
+
+	printf("\n%d routes: %llu lookups/s\n", added, t
+			? (unsigned long long) LOOKUPS * 1000000000 / t : 0ULL);
+
+	/* Deletion may free any entry with the same prefix, so start over */
+	rte = rt_fib_get_first();
+	while (rte != NULL) {
+		if ((rte->rt_dst & htonl(BENCH_MASK)) == htonl(BENCH_NET)
+				&& (rte->rt_mask & htonl(BENCH_MASK)) == htonl(BENCH_MASK)
+				&& rte->dev == dev) {
+			rt_del_route(dev, rte->rt_dst, rte->rt_mask, INADDR_ANY);
+			rte = rt_fib_get_first();
+		} else {
+			rte = rt_fib_get_next(rte);
+		}
+	}
+}
@@ -0,0 +1,122 @@
+/**
+ * @file
+ * @brief Measures receive demultiplexing of UDP sockets against their number.
+ *
+ * @details Binds a growing number of sockets to distinct ports and looks up
+ * a datagram destined to the last of them, both by walking the list of all
+ * sockets and through the hash tables used by the receive path.
+ *
+ * @date 17.10.2026
+ */
+
+#include <stdio.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+
+#include <embox/test.h>
+#include <framework/mod/options.h>
+
+#include <kernel/time/ktime.h>
+#include <net/l2/ethernet.h>
+#include <net/l3/ipv4/ip.h>
+#include <net/l4/udp.h>
+#include <net/skbuff.h>
+#include <net/sock.h>
+#include <net/socket/sock_hash.h>
+
+#define SOCKETS_QUANTITY OPTION_GET(NUMBER, sockets_quantity)
+#define LOOKUPS          OPTION_GET(NUMBER, lookups)
+
+#define BASE_PORT 20000
+
+EMBOX_TEST_SUITE("Socket receive lookup rate");
+
+static int fds[SOCKETS_QUANTITY];
+
+static int bench_tester(const struct sock *sk, const struct sk_buff *skb) {
+	return (sk->opt.so_domain == AF_INET)
+			&& (sock_inet_get_src_port(sk) == udp_hdr(skb)->dest)
+			&& ((sock_inet_get_dst_port(sk) == 0)
+				|| (sock_inet_get_dst_port(sk) == udp_hdr(skb)->source));
+}
+
+static struct sk_buff * bench_skb(in_port_t dest) {
+	struct sk_buff *skb;
+
+	skb = skb_alloc(ETH_HEADER_SIZE + IP_MIN_HEADER_SIZE + UDP_HEADER_SIZE);
+	if (skb == NULL) {
+		return NULL;
+	}
+
+	skb->nh.raw = skb->mac.raw + ETH_HEADER_SIZE;
+	skb->h.raw = skb->nh.raw + IP_MIN_HEADER_SIZE;
+
+	ip_hdr(skb)->version = 4;
+	ip_hdr(skb)->saddr = htonl(INADDR_LOOPBACK);
+	ip_hdr(skb)->daddr = htonl(INADDR_LOOPBACK);
+	udp_hdr(skb)->source = htons(BASE_PORT - 1);
+	udp_hdr(skb)->dest = dest;
+
+	return skb;
+}
+
+static uint64_t rate(time64_t ns) {
+	return ns ? (uint64_t) LOOKUPS * 1000000000 / ns : 0;
+}
+
+TEST_CASE("Lookups per second for growing number of bound sockets") {
+	struct sockaddr_in addr;
+	struct sk_buff *skb;
+	struct sock *sk;
+	time64_t start, t_list, t_hash;
+	int n, i, step;
+
+	addr.sin_family = AF_INET;
+	addr.sin_addr.s_addr = htonl(INADDR_ANY);
+
+	printf("\n%8s %16s %16s\n", "sockets", "list lookup/s", "hash lookup/s");
+
+	for (n = 0, step = 1; n < SOCKETS_QUANTITY; step *= 2) {
+		for (; n < step && n < SOCKETS_QUANTITY; n++) {
+			fds[n] = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+			test_assert(fds[n] >= 0);
+			addr.sin_port = htons(BASE_PORT + n);
+			test_assert_zero(bind(fds[n], (struct sockaddr *)&addr,
+					sizeof addr));
+		}
+
+		skb = bench_skb(htons(BASE_PORT + n - 1));
+		test_assert_not_null(skb);
+
+		start = ktime_get_ns();
+		for (i = 0; i < LOOKUPS; i++) {
+			sk = sock_lookup(NULL, udp_sock_ops, bench_tester, skb);
+		}
+		t_list = ktime_get_ns() - start;
+		test_assert_not_null(sk);
+
+		start = ktime_get_ns();
+		for (i = 0; i < LOOKUPS; i++) {
+			sk = sock_lookup_established(udp_sock_ops, bench_tester, skb,
+					sock_hash_tuple(udp_hdr(skb)->dest, ip_hdr(skb)->saddr,
+						udp_hdr(skb)->source));
+			if (sk == NULL) {
+				sk = sock_lookup_bound(udp_sock_ops, bench_tester, skb,
+						sock_hash_port(udp_hdr(skb)->dest));
+			}
+		}
+		t_hash = ktime_get_ns() - start;
+		test_assert_not_null(sk);
+
+		skb_free(skb);
+
+		printf("%8d %16llu %16llu\n", n, (unsigned long long) rate(t_list),
+				(unsigned long long) rate(t_hash));
+	}
+
+	for (i = 0; i < SOCKETS_QUANTITY; i++) {
+		close(fds[i]);
+	}
+}
@@ -11,6 +11,22 @@
 
 #include <assert.h>
 
+#if defined(__GNUC__) && (defined(__i386__) || defined(__x86_64__))
+
+/* There are always BSF/BSR instructions on x86, let compiler use them. */
+
+static inline int bit_ctz(unsigned long x) {
+	assert(x);
+	return __builtin_ctzl(x);
+}
+
+static inline int bit_clz(unsigned long x) {
+	assert(x);
+	return __builtin_clzl(x);
+}
+
+#else
+
 #define __bit_lsb_mask(n) ((0x1ul << (n)) - 1) /* n rightmost bits. */
 #define __bit_msb_mask(n) (~(~0x0ul >> (n)))   /* n leftmost bits. */
 
@@ -59,4 +75,6 @@ static inline int bit_clz(unsigned long x) {
 	return nr;
 }
 
+#endif /* __GNUC__ && x86 */
+
 #endif /* UTIL_BIT_IMPL_H_ */